@@ -117,7 +117,7 @@ VulkanSamples::VulkanSamples()
 	    R"(Vulkan Samples.
 	Usage:
 		vulkan_samples <sample>
-		vulkan_samples (--sample <arg> | --test <arg> | --batch <arg> [<tags>...]) [--benchmark <frames>] [--width <arg>] [--height <arg>] [--headless] 
+		vulkan_samples (--sample <arg> | --test <arg> | --batch <arg> [<tags>...]) [--benchmark <frames>] [--width <arg>] [--height <arg>] [--headless] [--cmaa-quality <arg>] [--prebuild-shaders] [--async-pipelines] [--stream-textures] [--bake-scenes]
 		vulkan_samples --help
 
 	Options:
@@ -126,7 +126,12 @@ VulkanSamples::VulkanSamples()
 		--test TEST_ID            Run test.
 		--batch CATEGORY          Run all samples within a certain category, specify 'all' to run all.
 		--benchmark FRAMES        Run app under benchmark mode for n amount of frames.
-		--headless                Run the app with headless rendering.)"
+		--headless                Run the app with headless rendering.
+		--cmaa-quality QUALITY    Start the cmaa sample with CMAA at the given quality preset: low, medium, high or ultra.
+		--prebuild-shaders        Compile the shaders of the sample, and all the variants it supports, into the SPIR-V cache and exit.
+		--async-pipelines         Compile graphics pipelines on worker threads, skipping the draws that use them until they are ready.
+		--stream-textures         Load the scene images while rendering, sampling a placeholder until their smallest mip levels are uploaded.
+		--bake-scenes             Bake the glTF scenes loaded by the sample into the cache directory, from which later runs load them, and exit.)"
 #ifndef VK_USE_PLATFORM_DISPLAY_KHR
 	    R"(
 		--width WIDTH             The width of the screen if visible [default: 1280].
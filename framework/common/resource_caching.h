@@ -597,6 +597,13 @@ inline void hash_param<std::vector<ShaderModule *>>(
 	for (auto &shader_module : value)
 	{
 		hash_combine(seed, shader_module->get_id());
+
+		// Subpasses set the modes of the resources of shared shader modules,
+		// which changes the layouts built from the same modules
+		for (auto &resource : shader_module->get_resources())
+		{
+			hash_combine(seed, resource.mode);
+		}
 	}
 }
 
@@ -721,24 +728,70 @@ struct RecordHelper<GraphicsPipeline, A...>
 		recorder.set_graphics_pipeline(index, graphics_pipeline);
 	}
 };
+
+template <class... A>
+struct RecordHelper<DescriptorSetLayout, A...>
+{
+	size_t record(ResourceRecord &recorder, A &... args)
+	{
+		return recorder.register_descriptor_set_layout(args...);
+	}
+
+	void index(ResourceRecord &recorder, size_t index, DescriptorSetLayout &descriptor_set_layout)
+	{
+		recorder.set_descriptor_set_layout(index, descriptor_set_layout);
+	}
+};
+
+template <class... A>
+struct RecordHelper<ComputePipeline, A...>
+{
+	size_t record(ResourceRecord &recorder, A &... args)
+	{
+		return recorder.register_compute_pipeline(args...);
+	}
+
+	void index(ResourceRecord &recorder, size_t index, ComputePipeline &compute_pipeline)
+	{
+		recorder.set_compute_pipeline(index, compute_pipeline);
+	}
+};
 }        // namespace
 
+/**
+ * @brief Adds a resource created from the arguments to the cache, and records it
+ * @param hash Hash of the arguments, as computed by hash_param
+ */
 template <class T, class... A>
-T &request_resource(Device &device, ResourceRecord *recorder, std::unordered_map<std::size_t, T> &resources, A &... args)
+T &insert_resource(ResourceRecord *recorder, std::unordered_map<std::size_t, T> &resources, std::size_t hash, T &&resource, A &... args)
 {
 	RecordHelper<T, A...> record_helper;
 
-	std::size_t hash{0U};
-	hash_param(hash, args...);
+	auto res_ins_it = resources.emplace(hash, std::move(resource));
 
-	auto res_it = resources.find(hash);
+	if (!res_ins_it.second)
+	{
+		throw std::runtime_error{std::string{"Insertion error for #"} + std::to_string(resources.size()) + "cache object (" + typeid(T).name() + ")"};
+	}
 
-	if (res_it != resources.end())
+	auto res_it = res_ins_it.first;
+
+	if (recorder)
 	{
-		return res_it->second;
+		size_t index = record_helper.record(*recorder, args...);
+		record_helper.index(*recorder, index, res_it->second);
 	}
 
-	// If we do not have it already, create and cache it
+	return res_it->second;
+}
+
+/**
+ * @brief Creates a resource that is not in the cache yet, and records it
+ * @param hash Hash of the arguments, as computed by hash_param
+ */
+template <class T, class... A>
+T &create_resource(Device &device, ResourceRecord *recorder, std::unordered_map<std::size_t, T> &resources, std::size_t hash, A &... args)
+{
 	const char *res_type = typeid(T).name();
 	size_t      res_id   = resources.size();
 
@@ -751,20 +804,7 @@ T &request_resource(Device &device, ResourceRecord *recorder, std::unordered_map
 #endif
 		T resource(device, args...);
 
-		auto res_ins_it = resources.emplace(hash, std::move(resource));
-
-		if (!res_ins_it.second)
-		{
-			throw std::runtime_error{std::string{"Insertion error for #"} + std::to_string(res_id) + "cache object (" + res_type + ")"};
-		}
-
-		res_it = res_ins_it.first;
-
-		if (recorder)
-		{
-			size_t index = record_helper.record(*recorder, args...);
-			record_helper.index(*recorder, index, res_it->second);
-		}
+		return insert_resource(recorder, resources, hash, std::move(resource), args...);
 #ifndef DEBUG
 	}
 	catch (const std::exception &e)
@@ -773,7 +813,22 @@ T &request_resource(Device &device, ResourceRecord *recorder, std::unordered_map
 		throw e;
 	}
 #endif
+}
 
-	return res_it->second;
+template <class T, class... A>
+T &request_resource(Device &device, ResourceRecord *recorder, std::unordered_map<std::size_t, T> &resources, A &... args)
+{
+	std::size_t hash{0U};
+	hash_param(hash, args...);
+
+	auto res_it = resources.find(hash);
+
+	if (res_it != resources.end())
+	{
+		return res_it->second;
+	}
+
+	// If we do not have it already, create and cache it
+	return create_resource(device, recorder, resources, hash, args...);
 }
 }        // namespace vkb
@@ -17,6 +17,8 @@
 
 #include "command_buffer.h"
 
+#include <cstring>
+
 #include "command_pool.h"
 #include "common/error.h"
 #include "device.h"
@@ -123,10 +125,18 @@ VkResult CommandBuffer::begin(VkCommandBufferUsageFlags flags, const RenderPass
 
 	// Reset state
 	pipeline_state.reset();
+	pending_graphics_pipeline = nullptr;
 	resource_binding_state.reset();
 	descriptor_set_layout_binding_state.clear();
 	stored_push_constants.clear();
 
+	// The descriptors keep their allocation for the next recording
+	for (auto &memo : descriptor_set_memo)
+	{
+		memo.descriptor_set_layout = nullptr;
+		memo.descriptors.clear();
+	}
+
 	VkCommandBufferBeginInfo       begin_info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
 	VkCommandBufferInheritanceInfo inheritance = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO};
 	begin_info.flags                           = flags;
@@ -164,19 +174,25 @@ VkResult CommandBuffer::end()
 	return VK_SUCCESS;
 }
 
-void CommandBuffer::flush(VkPipelineBindPoint pipeline_bind_point)
+bool CommandBuffer::flush(VkPipelineBindPoint pipeline_bind_point)
 {
-	flush_pipeline_state(pipeline_bind_point);
+	if (!flush_pipeline_state(pipeline_bind_point))
+	{
+		return false;
+	}
 
 	flush_push_constants();
 
 	flush_descriptor_state(pipeline_bind_point);
+
+	return true;
 }
 
 void CommandBuffer::begin_render_pass(const RenderTarget &render_target, const std::vector<LoadStoreInfo> &load_store_infos, const std::vector<VkClearValue> &clear_values, const std::vector<std::unique_ptr<Subpass>> &subpasses, VkSubpassContents contents)
 {
 	// Reset state
 	pipeline_state.reset();
+	pending_graphics_pipeline = nullptr;
 	resource_binding_state.reset();
 	descriptor_set_layout_binding_state.clear();
 
@@ -395,21 +411,30 @@ void CommandBuffer::set_depth_bounds(float min_depth_bounds, float max_depth_bou
 
 void CommandBuffer::draw(uint32_t vertex_count, uint32_t instance_count, uint32_t first_vertex, uint32_t first_instance)
 {
-	flush(VK_PIPELINE_BIND_POINT_GRAPHICS);
+	if (!flush(VK_PIPELINE_BIND_POINT_GRAPHICS))
+	{
+		return;
+	}
 
 	vkCmdDraw(get_handle(), vertex_count, instance_count, first_vertex, first_instance);
 }
 
 void CommandBuffer::draw_indexed(uint32_t index_count, uint32_t instance_count, uint32_t first_index, int32_t vertex_offset, uint32_t first_instance)
 {
-	flush(VK_PIPELINE_BIND_POINT_GRAPHICS);
+	if (!flush(VK_PIPELINE_BIND_POINT_GRAPHICS))
+	{
+		return;
+	}
 
 	vkCmdDrawIndexed(get_handle(), index_count, instance_count, first_index, vertex_offset, first_instance);
 }
 
 void CommandBuffer::draw_indexed_indirect(const core::Buffer &buffer, VkDeviceSize offset, uint32_t draw_count, uint32_t stride)
 {
-	flush(VK_PIPELINE_BIND_POINT_GRAPHICS);
+	if (!flush(VK_PIPELINE_BIND_POINT_GRAPHICS))
+	{
+		return;
+	}
 
 	vkCmdDrawIndexedIndirect(get_handle(), buffer.get_handle(), offset, draw_count, stride);
 }
@@ -433,11 +458,16 @@ void CommandBuffer::update_buffer(const core::Buffer &buffer, VkDeviceSize offse
 	vkCmdUpdateBuffer(get_handle(), buffer.get_handle(), offset, data.size(), data.data());
 }
 
-void CommandBuffer::blit_image(const core::Image &src_img, const core::Image &dst_img, const std::vector<VkImageBlit> &regions)
+void CommandBuffer::fill_buffer(const core::Buffer &buffer, VkDeviceSize offset, VkDeviceSize size, uint32_t data)
+{
+	vkCmdFillBuffer(get_handle(), buffer.get_handle(), offset, size, data);
+}
+
+void CommandBuffer::blit_image(const core::Image &src_img, const core::Image &dst_img, const std::vector<VkImageBlit> &regions, VkFilter filter)
 {
 	vkCmdBlitImage(get_handle(), src_img.get_handle(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
 	               dst_img.get_handle(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-	               to_u32(regions.size()), regions.data(), VK_FILTER_NEAREST);
+	               to_u32(regions.size()), regions.data(), filter);
 }
 
 void CommandBuffer::resolve_image(const core::Image &src_img, const core::Image &dst_img, const std::vector<VkImageResolve> &regions)
@@ -454,6 +484,11 @@ void CommandBuffer::copy_buffer(const core::Buffer &src_buffer, const core::Buff
 	vkCmdCopyBuffer(get_handle(), src_buffer.get_handle(), dst_buffer.get_handle(), 1, &copy_region);
 }
 
+void CommandBuffer::copy_buffer(const core::Buffer &src_buffer, const core::Buffer &dst_buffer, const std::vector<VkBufferCopy> &regions)
+{
+	vkCmdCopyBuffer(get_handle(), src_buffer.get_handle(), dst_buffer.get_handle(), to_u32(regions.size()), regions.data());
+}
+
 void CommandBuffer::copy_image(const core::Image &src_img, const core::Image &dst_img, const std::vector<VkImageCopy> &regions)
 {
 	vkCmdCopyImage(get_handle(), src_img.get_handle(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
@@ -483,12 +518,14 @@ void CommandBuffer::image_memory_barrier(const core::ImageView &image_view, cons
 	}
 
 	VkImageMemoryBarrier image_memory_barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
-	image_memory_barrier.oldLayout        = memory_barrier.old_layout;
-	image_memory_barrier.newLayout        = memory_barrier.new_layout;
-	image_memory_barrier.image            = image_view.get_image().get_handle();
-	image_memory_barrier.subresourceRange = subresource_range;
-	image_memory_barrier.srcAccessMask    = memory_barrier.src_access_mask;
-	image_memory_barrier.dstAccessMask    = memory_barrier.dst_access_mask;
+	image_memory_barrier.oldLayout           = memory_barrier.old_layout;
+	image_memory_barrier.newLayout           = memory_barrier.new_layout;
+	image_memory_barrier.image               = image_view.get_image().get_handle();
+	image_memory_barrier.subresourceRange    = subresource_range;
+	image_memory_barrier.srcAccessMask       = memory_barrier.src_access_mask;
+	image_memory_barrier.dstAccessMask       = memory_barrier.dst_access_mask;
+	image_memory_barrier.srcQueueFamilyIndex = memory_barrier.old_queue_family;
+	image_memory_barrier.dstQueueFamilyIndex = memory_barrier.new_queue_family;
 
 	VkPipelineStageFlags src_stage_mask = memory_barrier.src_stage_mask;
 	VkPipelineStageFlags dst_stage_mask = memory_barrier.dst_stage_mask;
@@ -526,25 +563,60 @@ void CommandBuffer::buffer_memory_barrier(const core::Buffer &buffer, VkDeviceSi
 	    0, nullptr);
 }
 
-void CommandBuffer::flush_pipeline_state(VkPipelineBindPoint pipeline_bind_point)
+void CommandBuffer::pipeline_barrier(VkPipelineStageFlags src_stage_mask, VkPipelineStageFlags dst_stage_mask,
+                                     const std::vector<VkBufferMemoryBarrier> &buffer_barriers, const std::vector<VkImageMemoryBarrier> &image_barriers)
+{
+	vkCmdPipelineBarrier(
+	    get_handle(),
+	    src_stage_mask,
+	    dst_stage_mask,
+	    0,
+	    0, nullptr,
+	    to_u32(buffer_barriers.size()), buffer_barriers.data(),
+	    to_u32(image_barriers.size()), image_barriers.data());
+}
+
+bool CommandBuffer::flush_pipeline_state(VkPipelineBindPoint pipeline_bind_point)
 {
-	// Create a new pipeline only if the graphics state changed
-	if (!pipeline_state.is_dirty())
+	// Create a new pipeline only if the state changed, or its graphics pipeline was not ready
+	const bool pending = pipeline_bind_point == VK_PIPELINE_BIND_POINT_GRAPHICS && pending_graphics_pipeline;
+	if (!pipeline_state.is_dirty() && !pending)
 	{
-		return;
+		return true;
 	}
 
-	pipeline_state.clear_dirty();
-
 	// Create and bind pipeline
 	if (pipeline_bind_point == VK_PIPELINE_BIND_POINT_GRAPHICS)
 	{
-		pipeline_state.set_render_pass(*current_render_pass.render_pass);
-		auto &pipeline = get_device().get_resource_cache().request_graphics_pipeline(pipeline_state);
+		auto &resource_cache = get_device().get_resource_cache();
+
+		// The entry of the pending pipeline is destroyed if the pipelines were cleared since it was requested
+		const auto pipeline_generation = resource_cache.get_pipeline_generation();
+
+		GraphicsPipeline *pipeline{nullptr};
+		if (pipeline_state.is_dirty() || pending_graphics_pipeline_generation != pipeline_generation)
+		{
+			pipeline_state.set_render_pass(*current_render_pass.render_pass);
+			pending_graphics_pipeline            = nullptr;
+			pending_graphics_pipeline_generation = pipeline_generation;
+			pipeline                             = resource_cache.request_graphics_pipeline_async(pipeline_state, &pending_graphics_pipeline);
+		}
+		else
+		{
+			// The state did not change since the pipeline was requested, so it is polled without hashing the state
+			pipeline = resource_cache.poll_graphics_pipeline(*pending_graphics_pipeline, pipeline_state);
+		}
+
+		// Draws are skipped until the pipeline is ready
+		if (!pipeline)
+		{
+			pipeline_state.clear_dirty();
+			return false;
+		}
 
 		vkCmdBindPipeline(get_handle(),
 		                  pipeline_bind_point,
-		                  pipeline.get_handle());
+		                  pipeline->get_handle());
 	}
 	else if (pipeline_bind_point == VK_PIPELINE_BIND_POINT_COMPUTE)
 	{
@@ -558,6 +630,11 @@ void CommandBuffer::flush_pipeline_state(VkPipelineBindPoint pipeline_bind_point
 	{
 		throw "Only graphics and compute pipeline bind points are supported now";
 	}
+
+	pipeline_state.clear_dirty();
+	pending_graphics_pipeline = nullptr;
+
+	return true;
 }
 
 void CommandBuffer::flush_descriptor_state(VkPipelineBindPoint pipeline_bind_point)
@@ -629,112 +706,165 @@ void CommandBuffer::flush_descriptor_state(VkPipelineBindPoint pipeline_bind_poi
 			// Make descriptor set layout bound for current set
 			descriptor_set_layout_binding_state[descriptor_set_id] = &descriptor_set_layout;
 
-			BindingMap<VkDescriptorBufferInfo> buffer_infos;
-			BindingMap<VkDescriptorImageInfo>  image_infos;
-
+			// Dynamic offsets are given at bind time, so only the other offsets tell descriptor sets apart
+			size_t                resource_set_hash = resource_set.get_hash();
 			std::vector<uint32_t> dynamic_offsets;
 
-			// The bindings we want to update before binding, if empty we update all bindings
-			std::vector<uint32_t> bindings_to_update;
+			flushed_descriptors.clear();
 
-			// Iterate over all resource bindings
 			for (auto &binding_it : resource_set.get_resource_bindings())
 			{
-				auto  binding_index     = binding_it.first;
-				auto &binding_resources = binding_it.second;
+				auto binding_info   = descriptor_set_layout.get_layout_binding(binding_it.first);
+				bool dynamic_buffer = binding_info && is_dynamic_buffer_descriptor_type(binding_info->descriptorType);
 
-				// Check if binding exists in the pipeline layout
-				if (auto binding_info = descriptor_set_layout.get_layout_binding(binding_index))
+				for (auto &element_it : binding_it.second)
 				{
-					// If update after bind is enabled, we store the binding index of each binding that need to be updated before being bound
-					if (update_after_bind && !(descriptor_set_layout.get_layout_binding_flag(binding_index) & VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT))
+					auto &resource_info = element_it.second;
+
+					flushed_descriptors.push_back({binding_it.first,
+					                               element_it.first,
+					                               reinterpret_cast<uintptr_t>(resource_info.buffer),
+					                               reinterpret_cast<uintptr_t>(resource_info.image_view),
+					                               reinterpret_cast<uintptr_t>(resource_info.sampler),
+					                               dynamic_buffer ? 0 : resource_info.offset,
+					                               resource_info.range});
+
+					if (!binding_info || !is_buffer_descriptor_type(binding_info->descriptorType) || resource_info.buffer == nullptr)
 					{
-						bindings_to_update.push_back(binding_index);
+						continue;
 					}
 
-					// Iterate over all binding resources
-					for (auto &element_it : binding_resources)
+					if (dynamic_buffer)
 					{
-						auto  array_element = element_it.first;
-						auto &resource_info = element_it.second;
+						dynamic_offsets.push_back(to_u32(resource_info.offset));
+					}
+					else
+					{
+						hash_combine(resource_set_hash, resource_info.offset);
+					}
+				}
+			}
+
+			// Identical bindings flushed recently reuse their descriptor set, without building the binding maps.
+			// The hash only narrows the search, a hit is confirmed by comparing the descriptors themselves
+			auto memo_it = std::find_if(descriptor_set_memo.begin(), descriptor_set_memo.end(), [&](const DescriptorSetMemo &memo) {
+				return memo.descriptor_set_layout == &descriptor_set_layout && memo.resource_set_hash == resource_set_hash &&
+				       memo.descriptors.size() == flushed_descriptors.size() &&
+				       std::memcmp(memo.descriptors.data(), flushed_descriptors.data(), flushed_descriptors.size() * sizeof(MemoDescriptor)) == 0;
+			});
+
+			if (memo_it == descriptor_set_memo.end())
+			{
+				BindingMap<VkDescriptorBufferInfo> buffer_infos;
+				BindingMap<VkDescriptorImageInfo>  image_infos;
+
+				// The bindings we want to update before binding, if empty we update all bindings
+				std::vector<uint32_t> bindings_to_update;
 
-						// Pointer references
-						auto &buffer     = resource_info.buffer;
-						auto &sampler    = resource_info.sampler;
-						auto &image_view = resource_info.image_view;
+				// Iterate over all resource bindings
+				for (auto &binding_it : resource_set.get_resource_bindings())
+				{
+					auto  binding_index     = binding_it.first;
+					auto &binding_resources = binding_it.second;
+
+					// Check if binding exists in the pipeline layout
+					if (auto binding_info = descriptor_set_layout.get_layout_binding(binding_index))
+					{
+						// If update after bind is enabled, we store the binding index of each binding that need to be updated before being bound
+						if (update_after_bind && !(descriptor_set_layout.get_layout_binding_flag(binding_index) & VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT))
+						{
+							bindings_to_update.push_back(binding_index);
+						}
 
-						// Get buffer info
-						if (buffer != nullptr && is_buffer_descriptor_type(binding_info->descriptorType))
+						// Iterate over all binding resources
+						for (auto &element_it : binding_resources)
 						{
-							VkDescriptorBufferInfo buffer_info{};
+							auto  array_element = element_it.first;
+							auto &resource_info = element_it.second;
 
-							buffer_info.buffer = resource_info.buffer->get_handle();
-							buffer_info.offset = resource_info.offset;
-							buffer_info.range  = resource_info.range;
+							// Pointer references
+							auto &buffer     = resource_info.buffer;
+							auto &sampler    = resource_info.sampler;
+							auto &image_view = resource_info.image_view;
 
-							if (is_dynamic_buffer_descriptor_type(binding_info->descriptorType))
+							// Get buffer info
+							if (buffer != nullptr && is_buffer_descriptor_type(binding_info->descriptorType))
 							{
-								dynamic_offsets.push_back(to_u32(buffer_info.offset));
+								VkDescriptorBufferInfo buffer_info{};
 
-								buffer_info.offset = 0;
-							}
+								buffer_info.buffer = resource_info.buffer->get_handle();
+								buffer_info.offset = resource_info.offset;
+								buffer_info.range  = resource_info.range;
 
-							buffer_infos[binding_index][array_element] = std::move(buffer_info);
-						}
+								if (is_dynamic_buffer_descriptor_type(binding_info->descriptorType))
+								{
+									buffer_info.offset = 0;
+								}
 
-						// Get image info
-						else if (image_view != nullptr || sampler != VK_NULL_HANDLE)
-						{
-							// Can be null for input attachments
-							VkDescriptorImageInfo image_info{};
-							image_info.sampler   = sampler ? sampler->get_handle() : VK_NULL_HANDLE;
-							image_info.imageView = image_view->get_handle();
+								buffer_infos[binding_index][array_element] = std::move(buffer_info);
+							}
 
-							if (image_view != nullptr)
+							// Get image info
+							else if (image_view != nullptr || sampler != VK_NULL_HANDLE)
 							{
-								// Add image layout info based on descriptor type
-								switch (binding_info->descriptorType)
+								// Can be null for input attachments
+								VkDescriptorImageInfo image_info{};
+								image_info.sampler   = sampler ? sampler->get_handle() : VK_NULL_HANDLE;
+								image_info.imageView = image_view->get_handle();
+
+								if (image_view != nullptr)
 								{
-									case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
-										image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-										break;
-									case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
-										if (is_depth_stencil_format(image_view->get_format()))
-										{
-											image_info.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
-										}
-										else
-										{
+									// Add image layout info based on descriptor type
+									switch (binding_info->descriptorType)
+									{
+										case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
 											image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-										}
-										break;
-									case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
-										image_info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-										break;
-
-									default:
-										continue;
+											break;
+										case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+											if (is_depth_stencil_format(image_view->get_format()))
+											{
+												image_info.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+											}
+											else
+											{
+												image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+											}
+											break;
+										case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+											image_info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+											break;
+
+										default:
+											continue;
+									}
 								}
-							}
 
-							image_infos[binding_index][array_element] = std::move(image_info);
+								image_infos[binding_index][array_element] = std::move(image_info);
+							}
 						}
 					}
 				}
-			}
 
-			// Request a descriptor set from the render frame, and write the buffer infos and image infos of all the specified bindings
-			auto &descriptor_set = command_pool.get_render_frame()->request_descriptor_set(descriptor_set_layout, buffer_infos, image_infos, command_pool.get_thread_index());
-			descriptor_set.update(bindings_to_update);
+				// Request a descriptor set from the render frame, and write the buffer infos and image infos of all the specified bindings
+				auto &descriptor_set = command_pool.get_render_frame()->request_descriptor_set(descriptor_set_layout, buffer_infos, image_infos, command_pool.get_thread_index());
+				descriptor_set.update(bindings_to_update);
 
-			VkDescriptorSet descriptor_set_handle = descriptor_set.get_handle();
+				// Assigning the descriptors reuses the allocation of the memo being replaced
+				memo_it                        = descriptor_set_memo.begin() + next_descriptor_set_memo;
+				memo_it->descriptor_set_layout = &descriptor_set_layout;
+				memo_it->resource_set_hash     = resource_set_hash;
+				memo_it->descriptors.assign(flushed_descriptors.begin(), flushed_descriptors.end());
+				memo_it->handle = descriptor_set.get_handle();
+
+				next_descriptor_set_memo = (next_descriptor_set_memo + 1) % DESCRIPTOR_SET_MEMO_SIZE;
+			}
 
 			// Bind descriptor set
 			vkCmdBindDescriptorSets(get_handle(),
 			                        pipeline_bind_point,
 			                        pipeline_layout.get_handle(),
 			                        descriptor_set_id,
-			                        1, &descriptor_set_handle,
+			                        1, &memo_it->handle,
 			                        to_u32(dynamic_offsets.size()),
 			                        dynamic_offsets.data());
 		}
@@ -814,6 +944,42 @@ void CommandBuffer::write_timestamp(VkPipelineStageFlagBits pipeline_stage,
 	vkCmdWriteTimestamp(get_handle(), pipeline_stage, query_pool.get_handle(), query);
 }
 
+CommandBuffer::ScopedTimer CommandBuffer::time_scope(StatIndex stat)
+{
+	return ScopedTimer(*this, stat);
+}
+
+CommandBuffer::ScopedTimer::ScopedTimer(CommandBuffer &command_buffer, StatIndex stat) :
+    command_buffer{command_buffer}
+{
+	auto render_frame = command_buffer.command_pool.get_render_frame();
+	if (render_frame)
+	{
+		query = render_frame->request_gpu_timer(stat);
+	}
+
+	if (query != ~0U)
+	{
+		// Written before the timed commands start, the end timestamp once they have all completed
+		command_buffer.write_timestamp(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, render_frame->get_timestamp_pool(), query);
+	}
+}
+
+CommandBuffer::ScopedTimer::ScopedTimer(ScopedTimer &&other) :
+    command_buffer{other.command_buffer},
+    query{other.query}
+{
+	other.query = ~0U;
+}
+
+CommandBuffer::ScopedTimer::~ScopedTimer()
+{
+	if (query != ~0U)
+	{
+		command_buffer.write_timestamp(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, command_buffer.command_pool.get_render_frame()->get_timestamp_pool(), query + 1);
+	}
+}
+
 VkResult CommandBuffer::reset(ResetMode reset_mode)
 {
 	VkResult result = VK_SUCCESS;
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <array>
 #include <list>
 
 #include "common/helpers.h"
@@ -29,9 +30,11 @@
 #include "rendering/pipeline_state.h"
 #include "rendering/render_target.h"
 #include "resource_binding_state.h"
+#include "stats/stats_common.h"
 
 namespace vkb
 {
+struct AsyncGraphicsPipeline;
 class CommandPool;
 class DescriptorSet;
 class Framebuffer;
@@ -74,6 +77,31 @@ class CommandBuffer
 		const Framebuffer *framebuffer;
 	};
 
+	/**
+	 * @brief Measures the GPU time of the commands recorded while it is alive, see CommandBuffer::time_scope()
+	 */
+	class ScopedTimer
+	{
+	  public:
+		ScopedTimer(CommandBuffer &command_buffer, StatIndex stat);
+
+		ScopedTimer(const ScopedTimer &) = delete;
+
+		ScopedTimer(ScopedTimer &&other);
+
+		~ScopedTimer();
+
+		ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+		ScopedTimer &operator=(ScopedTimer &&) = delete;
+
+	  private:
+		CommandBuffer &command_buffer;
+
+		/// First of the two timestamp queries of the timer in the render frame, ~0U if not timing
+		uint32_t query{~0U};
+	};
+
 	CommandBuffer(CommandPool &command_pool, VkCommandBufferLevel level);
 
 	CommandBuffer(const CommandBuffer &) = delete;
@@ -95,8 +123,10 @@ class CommandBuffer
 	/**
 	 * @brief Flushes the command buffer, pushing the new changes
 	 * @param pipeline_bind_point The type of pipeline we want to flush
+	 * @return False if the graphics pipeline is still being compiled asynchronously,
+	 *         in which case the draw must be skipped
 	 */
-	void flush(VkPipelineBindPoint pipeline_bind_point);
+	bool flush(VkPipelineBindPoint pipeline_bind_point);
 
 	/**
 	 * @brief Sets the command buffer so that it is ready for recording
@@ -219,12 +249,16 @@ class CommandBuffer
 
 	void update_buffer(const core::Buffer &buffer, VkDeviceSize offset, const std::vector<uint8_t> &data);
 
-	void blit_image(const core::Image &src_img, const core::Image &dst_img, const std::vector<VkImageBlit> &regions);
+	void fill_buffer(const core::Buffer &buffer, VkDeviceSize offset, VkDeviceSize size, uint32_t data);
+
+	void blit_image(const core::Image &src_img, const core::Image &dst_img, const std::vector<VkImageBlit> &regions, VkFilter filter = VK_FILTER_NEAREST);
 
 	void resolve_image(const core::Image &src_img, const core::Image &dst_img, const std::vector<VkImageResolve> &regions);
 
 	void copy_buffer(const core::Buffer &src_buffer, const core::Buffer &dst_buffer, VkDeviceSize size);
 
+	void copy_buffer(const core::Buffer &src_buffer, const core::Buffer &dst_buffer, const std::vector<VkBufferCopy> &regions);
+
 	void copy_image(const core::Image &src_img, const core::Image &dst_img, const std::vector<VkImageCopy> &regions);
 
 	void copy_buffer_to_image(const core::Buffer &buffer, const core::Image &image, const std::vector<VkBufferImageCopy> &regions);
@@ -233,6 +267,12 @@ class CommandBuffer
 
 	void buffer_memory_barrier(const core::Buffer &buffer, VkDeviceSize offset, VkDeviceSize size, const BufferMemoryBarrier &memory_barrier);
 
+	/**
+	 * @brief Records all the given barriers with a single vkCmdPipelineBarrier
+	 */
+	void pipeline_barrier(VkPipelineStageFlags src_stage_mask, VkPipelineStageFlags dst_stage_mask,
+	                      const std::vector<VkBufferMemoryBarrier> &buffer_barriers, const std::vector<VkImageMemoryBarrier> &image_barriers);
+
 	const State get_state() const;
 
 	void set_update_after_bind(bool update_after_bind_);
@@ -245,6 +285,14 @@ class CommandBuffer
 
 	void write_timestamp(VkPipelineStageFlagBits pipeline_stage, const QueryPool &query_pool, uint32_t query);
 
+	/**
+	 * @brief Times the commands recorded until the returned timer is destroyed, adding the
+	 *        GPU time to the given stat of the render frame. Does nothing unless the GPU
+	 *        timers of the frame have been reset, see RenderFrame::reset_gpu_timers().
+	 * @param stat The stat the measured time is added to
+	 */
+	ScopedTimer time_scope(StatIndex stat);
+
 	/**
 	 * @brief Reset the command buffer to a state where it can be recorded to
 	 * @param reset_mode How to reset the buffer, should match the one used by the pool to allocate it
@@ -266,6 +314,12 @@ class CommandBuffer
 
 	PipelineState pipeline_state;
 
+	/// Graphics pipeline of the current state being compiled asynchronously, polled until it is ready
+	AsyncGraphicsPipeline *pending_graphics_pipeline{nullptr};
+
+	/// Pipeline generation of the resource cache when the pending pipeline was requested
+	uint32_t pending_graphics_pipeline_generation{0};
+
 	ResourceBindingState resource_binding_state;
 
 	std::vector<uint8_t> stored_push_constants;
@@ -282,6 +336,55 @@ class CommandBuffer
 
 	std::unordered_map<uint32_t, DescriptorSetLayout *> descriptor_set_layout_binding_state;
 
+	/**
+	 * @brief A descriptor of a resource set, the offset being zero for dynamic buffers.
+	 *        It has no padding, so that the descriptors of two resource sets compare with memcmp.
+	 */
+	struct MemoDescriptor
+	{
+		uint32_t binding;
+
+		uint32_t array_element;
+
+		uint64_t buffer;
+
+		uint64_t image_view;
+
+		uint64_t sampler;
+
+		VkDeviceSize offset;
+
+		VkDeviceSize range;
+	};
+
+	static_assert(sizeof(MemoDescriptor) == 2 * sizeof(uint32_t) + 5 * sizeof(uint64_t), "MemoDescriptor must not have padding");
+
+	/**
+	 * @brief A descriptor set recently flushed by the command buffer, with the hash of
+	 *        the resource set it was created from, including the offsets that are not dynamic,
+	 *        and its descriptors to tell apart resource sets with the same hash
+	 */
+	struct DescriptorSetMemo
+	{
+		const DescriptorSetLayout *descriptor_set_layout{nullptr};
+
+		size_t resource_set_hash{0};
+
+		std::vector<MemoDescriptor> descriptors;
+
+		VkDescriptorSet handle{VK_NULL_HANDLE};
+	};
+
+	static constexpr size_t DESCRIPTOR_SET_MEMO_SIZE{8};
+
+	/// Ring of the last descriptor sets, so that rebinding the same resources skips the descriptor set cache
+	std::array<DescriptorSetMemo, DESCRIPTOR_SET_MEMO_SIZE> descriptor_set_memo;
+
+	size_t next_descriptor_set_memo{0};
+
+	/// Descriptors of the resource set being flushed, kept to reuse its allocation
+	std::vector<MemoDescriptor> flushed_descriptors;
+
 	const RenderPassBinding &get_current_render_pass() const;
 
 	const uint32_t get_current_subpass_index() const;
@@ -293,8 +396,9 @@ class CommandBuffer
 
 	/**
 	 * @brief Flush the piplines state
+	 * @return False if the pipeline is not ready, see ResourceCache::request_graphics_pipeline_async
 	 */
-	void flush_pipeline_state(VkPipelineBindPoint pipeline_bind_point);
+	bool flush_pipeline_state(VkPipelineBindPoint pipeline_bind_point);
 
 	/**
 	 * @brief Flush the descriptor set state
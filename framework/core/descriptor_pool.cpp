@@ -57,6 +57,19 @@ DescriptorPool::DescriptorPool(Device &                   device,
 	pool_max_sets = pool_size;
 }
 
+DescriptorPool::DescriptorPool(DescriptorPool &&other) :
+    device{other.device},
+    descriptor_set_layout{other.descriptor_set_layout},
+    pool_sizes{std::move(other.pool_sizes)},
+    pool_max_sets{other.pool_max_sets},
+    pools{std::move(other.pools)},
+    pool_sets_count{std::move(other.pool_sets_count)},
+    pool_index{other.pool_index},
+    set_pool_mapping{std::move(other.set_pool_mapping)}
+{
+	other.pools.clear();
+}
+
 DescriptorPool::~DescriptorPool()
 {
 	// Destroy all descriptor pools
@@ -68,6 +81,8 @@ DescriptorPool::~DescriptorPool()
 
 void DescriptorPool::reset()
 {
+	std::lock_guard<std::mutex> guard(mutex);
+
 	// Reset all descriptor pools
 	for (auto pool : pools)
 	{
@@ -95,6 +110,8 @@ void DescriptorPool::set_descriptor_set_layout(const DescriptorSetLayout &set_la
 
 VkDescriptorSet DescriptorPool::allocate()
 {
+	std::lock_guard<std::mutex> guard(mutex);
+
 	pool_index = find_available_pool(pool_index);
 
 	// Increment allocated set count for the current pool
@@ -128,6 +145,8 @@ VkDescriptorSet DescriptorPool::allocate()
 
 VkResult DescriptorPool::free(VkDescriptorSet descriptor_set)
 {
+	std::lock_guard<std::mutex> guard(mutex);
+
 	// Get the pool index of the descriptor set
 	auto it = set_pool_mapping.find(descriptor_set);
 
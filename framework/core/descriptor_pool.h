@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <mutex>
 #include <unordered_map>
 
 #include "common/helpers.h"
@@ -41,7 +42,7 @@ class DescriptorPool
 
 	DescriptorPool(const DescriptorPool &) = delete;
 
-	DescriptorPool(DescriptorPool &&) = default;
+	DescriptorPool(DescriptorPool &&other);
 
 	~DescriptorPool();
 
@@ -82,6 +83,9 @@ class DescriptorPool
 	// Map between descriptor set and pool index
 	std::unordered_map<VkDescriptorSet, uint32_t> set_pool_mapping;
 
+	// Guards the allocations, as the resource cache creates descriptor sets from several threads
+	std::mutex mutex;
+
 	// Find next pool index or create new pool
 	uint32_t find_available_pool(uint32_t pool_index);
 };
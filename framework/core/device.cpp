@@ -318,6 +318,18 @@ bool Device::is_image_format_supported(VkFormat format) const
 	return result != VK_ERROR_FORMAT_NOT_SUPPORTED;
 }
 
+bool Device::is_image_format_blittable(VkFormat format) const
+{
+	VkFormatProperties format_properties;
+
+	vkGetPhysicalDeviceFormatProperties(gpu.get_handle(), format, &format_properties);
+
+	VkFormatFeatureFlags features = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+	                                VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+
+	return (format_properties.optimalTilingFeatures & features) == features;
+}
+
 uint32_t Device::get_memory_type(uint32_t bits, VkMemoryPropertyFlags properties, VkBool32 *memory_type_found)
 {
 	for (uint32_t i = 0; i < gpu.get_memory_properties().memoryTypeCount; i++)
@@ -86,6 +86,11 @@ class Device
 	 */
 	bool is_image_format_supported(VkFormat format) const;
 
+	/**
+	 * @return Whether the mip levels of an image format can be generated with linear blits
+	 */
+	bool is_image_format_blittable(VkFormat format) const;
+
 	const Queue &get_queue(uint32_t queue_family_index, uint32_t queue_index);
 
 	const Queue &get_queue_by_flags(VkQueueFlags queue_flags, uint32_t queue_index);
@@ -133,7 +133,8 @@ Instance::Instance(const std::string &                           application_nam
                    const std::unordered_map<const char *, bool> &required_extensions,
                    const std::vector<const char *> &             required_validation_layers,
                    bool                                          headless,
-                   uint32_t                                      api_version)
+                   uint32_t                                      api_version) :
+    api_version{api_version}
 {
 	VkResult result = volkInitialize();
 	if (result)
@@ -411,4 +412,9 @@ const std::vector<const char *> &Instance::get_extensions()
 {
 	return enabled_extensions;
 }
+
+uint32_t Instance::get_api_version() const
+{
+	return api_version;
+}
 }        // namespace vkb
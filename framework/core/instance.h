@@ -91,6 +91,11 @@ class Instance
 
 	const std::vector<const char *> &get_extensions();
 
+	/**
+	 * @brief The Vulkan API version the instance was created with
+	 */
+	uint32_t get_api_version() const;
+
   private:
 	/**
 	 * @brief The Vulkan instance
@@ -102,6 +107,11 @@ class Instance
 	 */
 	std::vector<const char *> enabled_extensions;
 
+	/**
+	 * @brief The requested Vulkan API version
+	 */
+	uint32_t api_version{VK_API_VERSION_1_0};
+
 #if defined(VKB_DEBUG) || defined(VKB_VALIDATION_LAYERS)
 	/**
 	 * @brief Debug utils messenger callback for VK_EXT_Debug_Utils
@@ -27,6 +27,15 @@ PhysicalDevice::PhysicalDevice(Instance &instance, VkPhysicalDevice physical_dev
 	vkGetPhysicalDeviceProperties(physical_device, &properties);
 	vkGetPhysicalDeviceMemoryProperties(physical_device, &memory_properties);
 
+	// Subgroup properties are core in Vulkan 1.1
+	if (instance.get_api_version() >= VK_API_VERSION_1_1 && properties.apiVersion >= VK_API_VERSION_1_1)
+	{
+		VkPhysicalDeviceProperties2 properties2{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2};
+		properties2.pNext = &subgroup_properties;
+		vkGetPhysicalDeviceProperties2(physical_device, &properties2);
+		subgroup_properties.pNext = nullptr;
+	}
+
 	LOGI("Found GPU: {}", properties.deviceName);
 
 	uint32_t queue_family_properties_count = 0;
@@ -81,6 +90,11 @@ const VkPhysicalDeviceMemoryProperties PhysicalDevice::get_memory_properties() c
 	return memory_properties;
 }
 
+const VkPhysicalDeviceSubgroupProperties &PhysicalDevice::get_subgroup_properties() const
+{
+	return subgroup_properties;
+}
+
 const std::vector<VkQueueFamilyProperties> &PhysicalDevice::get_queue_family_properties() const
 {
 	return queue_family_properties;
@@ -55,6 +55,11 @@ class PhysicalDevice
 
 	const VkPhysicalDeviceMemoryProperties get_memory_properties() const;
 
+	/**
+	 * @brief The subgroup properties of the GPU, zeroed if either the instance or the GPU are below Vulkan 1.1
+	 */
+	const VkPhysicalDeviceSubgroupProperties &get_subgroup_properties() const;
+
 	const std::vector<VkQueueFamilyProperties> &get_queue_family_properties() const;
 
 	uint32_t get_queue_family_performance_query_passes(
@@ -144,6 +149,9 @@ class PhysicalDevice
 	// The GPU memory properties
 	VkPhysicalDeviceMemoryProperties memory_properties;
 
+	// The GPU subgroup properties
+	VkPhysicalDeviceSubgroupProperties subgroup_properties{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES};
+
 	// The GPU queue family properties
 	std::vector<VkQueueFamilyProperties> queue_family_properties;
 
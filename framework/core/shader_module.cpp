@@ -256,6 +256,13 @@ void ShaderVariant::set_runtime_array_sizes(const std::unordered_map<std::string
 	this->runtime_array_sizes = sizes;
 }
 
+void ShaderVariant::set_spirv_version(uint32_t version)
+{
+	spirv_version = version;
+
+	update_id();
+}
+
 const std::string &ShaderVariant::get_preamble() const
 {
 	return preamble;
@@ -271,11 +278,17 @@ const std::unordered_map<std::string, size_t> &ShaderVariant::get_runtime_array_
 	return runtime_array_sizes;
 }
 
+uint32_t ShaderVariant::get_spirv_version() const
+{
+	return spirv_version;
+}
+
 void ShaderVariant::clear()
 {
 	preamble.clear();
 	processes.clear();
 	runtime_array_sizes.clear();
+	spirv_version = 0;
 	update_id();
 }
 
@@ -283,6 +296,7 @@ void ShaderVariant::update_id()
 {
 	std::hash<std::string> hasher{};
 	id = hasher(preamble);
+	hash_combine(id, spirv_version);
 }
 
 ShaderSource::ShaderSource(const std::string &filename) :
@@ -136,12 +136,22 @@ class ShaderVariant
 
 	void set_runtime_array_sizes(const std::unordered_map<std::string, size_t> &sizes);
 
+	/**
+	 * @brief Sets the SPIR-V version the shader is compiled to, for example
+	 *        SPIR-V 1.3 for shaders using the Vulkan 1.1 subgroup extensions
+	 * @param version The version, encoded as in the SPIR-V header (0x00010300 for 1.3),
+	 *        or 0 for the glslang default (SPIR-V 1.0)
+	 */
+	void set_spirv_version(uint32_t version);
+
 	const std::string &get_preamble() const;
 
 	const std::vector<std::string> &get_processes() const;
 
 	const std::unordered_map<std::string, size_t> &get_runtime_array_sizes() const;
 
+	uint32_t get_spirv_version() const;
+
 	void clear();
 
   private:
@@ -153,6 +163,8 @@ class ShaderVariant
 
 	std::unordered_map<std::string, size_t> runtime_array_sizes;
 
+	uint32_t spirv_version{0};
+
 	void update_id();
 };
 
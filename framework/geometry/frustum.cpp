@@ -17,8 +17,114 @@
 
 #include "frustum.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	include <emmintrin.h>
+#	define FRUSTUM_SIMD_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#	include <arm_neon.h>
+#	define FRUSTUM_SIMD_NEON
+#endif
+
 namespace vkb
 {
+namespace
+{
+#if defined(FRUSTUM_SIMD_SSE2)
+using Float4 = __m128;
+using Mask4  = __m128;
+
+inline Float4 splat(float value)
+{
+	return _mm_set1_ps(value);
+}
+
+inline Float4 load(const float *values)
+{
+	return _mm_loadu_ps(values);
+}
+
+/**
+ * @brief Returns a + b * c, rounded after the multiplication like the scalar code
+ */
+inline Float4 multiply_add(Float4 a, Float4 b, Float4 c)
+{
+	return _mm_add_ps(a, _mm_mul_ps(b, c));
+}
+
+inline Mask4 all_lanes()
+{
+	return _mm_castsi128_ps(_mm_set1_epi32(-1));
+}
+
+/**
+ * @brief Clears the lanes of the mask whose value is negative
+ */
+inline Mask4 keep_non_negative(Mask4 mask, Float4 values)
+{
+	return _mm_and_ps(mask, _mm_cmpge_ps(values, _mm_setzero_ps()));
+}
+
+/**
+ * @brief Writes each lane of the mask as a 0 or 1 byte
+ */
+inline void store_lanes(Mask4 mask, uint8_t *out)
+{
+	const int bits = _mm_movemask_ps(mask);
+	for (int lane = 0; lane < 4; lane++)
+	{
+		out[lane] = static_cast<uint8_t>((bits >> lane) & 1);
+	}
+}
+#elif defined(FRUSTUM_SIMD_NEON)
+using Float4 = float32x4_t;
+using Mask4  = uint32x4_t;
+
+inline Float4 splat(float value)
+{
+	return vdupq_n_f32(value);
+}
+
+inline Float4 load(const float *values)
+{
+	return vld1q_f32(values);
+}
+
+/**
+ * @brief Returns a + b * c, rounded after the multiplication like the scalar code
+ */
+inline Float4 multiply_add(Float4 a, Float4 b, Float4 c)
+{
+	return vaddq_f32(a, vmulq_f32(b, c));
+}
+
+inline Mask4 all_lanes()
+{
+	return vdupq_n_u32(~0u);
+}
+
+/**
+ * @brief Clears the lanes of the mask whose value is negative
+ */
+inline Mask4 keep_non_negative(Mask4 mask, Float4 values)
+{
+	return vandq_u32(mask, vcgeq_f32(values, vdupq_n_f32(0.0f)));
+}
+
+/**
+ * @brief Writes each lane of the mask as a 0 or 1 byte
+ */
+inline void store_lanes(Mask4 mask, uint8_t *out)
+{
+	uint32_t lanes[4];
+	vst1q_u32(lanes, mask);
+	for (int lane = 0; lane < 4; lane++)
+	{
+		out[lane] = static_cast<uint8_t>(lanes[lane] & 1);
+	}
+}
+#endif
+}        // namespace
+
 void Frustum::update(const glm::mat4 &matrix)
 {
 	planes[LEFT].x = matrix[0].w + matrix[0].x;
@@ -69,6 +175,96 @@ bool Frustum::check_sphere(glm::vec3 pos, float radius)
 	}
 	return true;
 }
+
+void Frustum::check_boxes(const std::array<const float *, 3> &center, const std::array<const float *, 3> &extent, size_t count, uint8_t *visible) const
+{
+	std::array<glm::vec3, 6> abs_normals;
+	for (size_t p = 0; p < planes.size(); p++)
+	{
+		abs_normals[p] = glm::abs(glm::vec3(planes[p]));
+	}
+
+	size_t i = 0;
+
+#if defined(FRUSTUM_SIMD_SSE2) || defined(FRUSTUM_SIMD_NEON)
+	// Each plane component broadcast to all lanes, so that four boxes are tested at once
+	struct PlaneLanes
+	{
+		Float4 normal[3];
+		Float4 distance;
+		Float4 abs_normal[3];
+	};
+
+	std::array<PlaneLanes, 6> plane_lanes;
+	for (size_t p = 0; p < planes.size(); p++)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			plane_lanes[p].normal[axis]     = splat(planes[p][axis]);
+			plane_lanes[p].abs_normal[axis] = splat(abs_normals[p][axis]);
+		}
+		plane_lanes[p].distance = splat(planes[p].w);
+	}
+
+	for (; i + 4 <= count; i += 4)
+	{
+		Float4 box_center[3];
+		Float4 box_extent[3];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			box_center[axis] = load(center[axis] + i);
+			box_extent[axis] = load(extent[axis] + i);
+		}
+
+		Mask4 inside = all_lanes();
+		for (auto &plane : plane_lanes)
+		{
+			// Distance to the plane of the box corner furthest along its normal
+			Float4 distance = plane.distance;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				distance = multiply_add(distance, plane.normal[axis], box_center[axis]);
+			}
+			for (int axis = 0; axis < 3; axis++)
+			{
+				distance = multiply_add(distance, plane.abs_normal[axis], box_extent[axis]);
+			}
+
+			inside = keep_non_negative(inside, distance);
+		}
+
+		store_lanes(inside, visible + i);
+	}
+#endif
+
+	// The boxes left over from the SIMD batches, or all of them without SIMD
+	for (; i < count; i++)
+	{
+		visible[i] = 1;
+
+		for (size_t p = 0; p < planes.size(); p++)
+		{
+			// Summed in the same order as the SIMD batches
+			const glm::vec4 &plane      = planes[p];
+			const glm::vec3 &abs_normal = abs_normals[p];
+
+			float distance = plane.w;
+			distance += plane.x * center[0][i];
+			distance += plane.y * center[1][i];
+			distance += plane.z * center[2][i];
+			distance += abs_normal.x * extent[0][i];
+			distance += abs_normal.y * extent[1][i];
+			distance += abs_normal.z * extent[2][i];
+
+			if (distance < 0.0f)
+			{
+				visible[i] = 0;
+				break;
+			}
+		}
+	}
+}
+
 const std::array<glm::vec4, 6> &Frustum::get_planes() const
 {
 	return planes;
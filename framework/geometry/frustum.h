@@ -55,6 +55,17 @@ class Frustum
 	 */
 	bool check_sphere(glm::vec3 pos, float radius);
 
+	/**
+	 * @brief Checks a batch of axis-aligned boxes against the Frustum. The boxes are
+	 *        given as separate arrays of center and half extent components, so that
+	 *        each plane is tested against several boxes at once.
+	 * @param center Arrays of the x, y and z components of the box centers
+	 * @param extent Arrays of the x, y and z components of the box half extents
+	 * @param count The number of boxes
+	 * @param visible Set to 1 for the boxes which intersect the Frustum, 0 otherwise
+	 */
+	void check_boxes(const std::array<const float *, 3> &center, const std::array<const float *, 3> &extent, size_t count, uint8_t *visible) const;
+
 	const std::array<glm::vec4, 6> &get_planes() const;
 
   private:
@@ -17,6 +17,12 @@
 
 #include "glsl_compiler.h"
 
+#include <array>
+#include <cstring>
+
+#include "common/logging.h"
+#include "platform/filesystem.h"
+
 VKBP_DISABLE_WARNINGS()
 #include <SPIRV/GLSL.std.450.h>
 #include <SPIRV/GlslangToSpv.h>
@@ -65,8 +71,130 @@ inline EShLanguage FindShaderLanguage(VkShaderStageFlagBits stage)
 			return EShLangVertex;
 	}
 }
+
+/**
+ * @brief 64-bit FNV-1a hash, which unlike std::hash is stable across runs and builds
+ */
+uint64_t hash_bytes(const void *data, size_t size, uint64_t hash = 14695981039346656037ULL)
+{
+	auto bytes = static_cast<const uint8_t *>(data);
+	for (size_t i = 0; i < size; i++)
+	{
+		hash = (hash ^ bytes[i]) * 1099511628211ULL;
+	}
+	return hash;
+}
+
+uint64_t hash_string(const std::string &str, uint64_t hash)
+{
+	// The length separates consecutive strings
+	uint64_t size = str.size();
+	hash          = hash_bytes(&size, sizeof(size), hash);
+	return hash_bytes(str.data(), str.size(), hash);
+}
+
+/**
+ * @brief Name of the SPIR-V cache file of a shader, which changes with anything that affects the compilation
+ */
+std::string get_spirv_cache_filename(VkShaderStageFlagBits       stage,
+                                     const std::vector<uint8_t> &glsl_source,
+                                     const std::string &         entry_point,
+                                     const ShaderVariant &       shader_variant)
+{
+	const std::array<uint32_t, 3> settings{static_cast<uint32_t>(stage),
+	                                       shader_variant.get_spirv_version(),
+	                                       GLSLANG_PATCH_LEVEL};
+
+	uint64_t hash = hash_bytes(settings.data(), sizeof(settings));
+	hash          = hash_bytes(glsl_source.data(), glsl_source.size(), hash);
+	hash          = hash_string(entry_point, hash);
+	hash          = hash_string(shader_variant.get_preamble(), hash);
+	for (auto &process : shader_variant.get_processes())
+	{
+		hash = hash_string(process, hash);
+	}
+
+	return fmt::format("{:016x}.spv", hash);
+}
+
+/**
+ * @brief Precedes the SPIR-V code in a cache file, so that truncated or corrupted files are detected
+ */
+struct SpirvCacheHeader
+{
+	/// Identifies SPIR-V cache files, and their version
+	uint32_t magic;
+
+	/// Size of the SPIR-V code in bytes
+	uint32_t size;
+
+	/// Hash of the SPIR-V code
+	uint64_t hash;
+};
+
+const uint32_t spirv_cache_magic = 0x31505356;        // "VSP1"
+
+bool load_cached_spirv(const std::string &filename, std::vector<std::uint32_t> &spirv)
+{
+	if (!fs::is_file(fs::path::get(fs::path::Type::Cache, filename)))
+	{
+		return false;
+	}
+
+	auto data = fs::read_cache(filename);
+
+	SpirvCacheHeader header{};
+	if (data.size() >= sizeof(header) + sizeof(uint32_t))
+	{
+		std::memcpy(&header, data.data(), sizeof(header));
+	}
+
+	// Reject truncated, corrupted and outdated files
+	const uint8_t *code        = data.data() + sizeof(header);
+	const uint32_t spirv_magic = 0x07230203;
+	if (header.magic != spirv_cache_magic || header.size != data.size() - sizeof(header) || header.size % sizeof(uint32_t) != 0 ||
+	    header.hash != hash_bytes(code, header.size) || *reinterpret_cast<const uint32_t *>(code) != spirv_magic)
+	{
+		LOGW("Ignoring invalid SPIR-V cache file {}", filename);
+		return false;
+	}
+
+	spirv.resize(header.size / sizeof(uint32_t));
+	std::memcpy(spirv.data(), code, header.size);
+
+	return true;
+}
+
+void store_cached_spirv(const std::string &filename, const std::vector<std::uint32_t> &spirv)
+{
+	auto bytes = reinterpret_cast<const uint8_t *>(spirv.data());
+	auto size  = spirv.size() * sizeof(uint32_t);
+
+	const SpirvCacheHeader header{spirv_cache_magic, to_u32(size), hash_bytes(bytes, size)};
+
+	std::vector<uint8_t> data(sizeof(header) + size);
+	std::memcpy(data.data(), &header, sizeof(header));
+	std::memcpy(data.data() + sizeof(header), bytes, size);
+
+	try
+	{
+		fs::write_cache(data, filename);
+	}
+	catch (const std::exception &e)
+	{
+		// The cache is only an optimization
+		LOGW("Failed to write SPIR-V cache file {}: {}", filename, e.what());
+	}
+}
 }        // namespace
 
+bool GLSLCompiler::spirv_cache_enabled = true;
+
+void GLSLCompiler::set_spirv_cache_enabled(bool enabled)
+{
+	GLSLCompiler::spirv_cache_enabled = enabled;
+}
+
 bool GLSLCompiler::compile_to_spirv(VkShaderStageFlagBits       stage,
                                     const std::vector<uint8_t> &glsl_source,
                                     const std::string &         entry_point,
@@ -74,6 +202,17 @@ bool GLSLCompiler::compile_to_spirv(VkShaderStageFlagBits       stage,
                                     std::vector<std::uint32_t> &spirv,
                                     std::string &               info_log)
 {
+	std::string cache_filename;
+	if (GLSLCompiler::spirv_cache_enabled)
+	{
+		cache_filename = get_spirv_cache_filename(stage, glsl_source, entry_point, shader_variant);
+
+		if (load_cached_spirv(cache_filename, spirv))
+		{
+			return true;
+		}
+	}
+
 	// Initialize glslang library.
 	glslang::InitializeProcess();
 
@@ -91,6 +230,11 @@ bool GLSLCompiler::compile_to_spirv(VkShaderStageFlagBits       stage,
 	shader.setSourceEntryPoint(entry_point.c_str());
 	shader.setPreamble(shader_variant.get_preamble().c_str());
 	shader.addProcesses(shader_variant.get_processes());
+	if (shader_variant.get_spirv_version() != 0)
+	{
+		// glslang encodes its SPIR-V versions as in the SPIR-V header
+		shader.setEnvTarget(glslang::EShTargetSpv, static_cast<glslang::EShTargetLanguageVersion>(shader_variant.get_spirv_version()));
+	}
 
 	if (!shader.parse(&glslang::DefaultTBuiltInResource, 100, false, messages))
 	{
@@ -138,6 +282,11 @@ bool GLSLCompiler::compile_to_spirv(VkShaderStageFlagBits       stage,
 	// Shutdown glslang library.
 	glslang::FinalizeProcess();
 
+	if (!cache_filename.empty())
+	{
+		store_cached_spirv(cache_filename, spirv);
+	}
+
 	return true;
 }
 }        // namespace vkb
@@ -35,9 +35,20 @@ namespace vkb
 /// A very simple version of the glslValidator application
 class GLSLCompiler
 {
+  private:
+	static bool spirv_cache_enabled;
+
   public:
 	/**
-	 * @brief Compiles GLSL to SPIRV code
+	 * @brief Enables the persistent SPIR-V cache (enabled by default). Compiled shaders are stored
+	 *        in the cache directory, keyed by a hash of their preprocessed source, variant (including
+	 *        its SPIR-V version), entry point and glslang revision, and loaded from it instead of
+	 *        being compiled again.
+	 */
+	static void set_spirv_cache_enabled(bool enabled);
+
+	/**
+	 * @brief Compiles GLSL to SPIRV code, or loads it from the SPIR-V cache
 	 * @param stage The Vulkan shader stage flag
 	 * @param glsl_source The GLSL source code to be compiled
 	 * @param entry_point The entrypoint function name of the shader stage
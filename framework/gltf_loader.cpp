@@ -19,6 +19,7 @@
 #define TINYGLTF_IMPLEMENTATION
 #include "gltf_loader.h"
 
+#include <algorithm>
 #include <limits>
 #include <queue>
 
@@ -35,12 +36,15 @@ VKBP_ENABLE_WARNINGS()
 #include "common/vk_common.h"
 #include "core/device.h"
 #include "core/image.h"
+#include "image_uploader.h"
+#include "texture_streamer.h"
 #include "platform/filesystem.h"
 #include "scene_graph/components/camera.h"
 #include "scene_graph/components/image.h"
 #include "scene_graph/components/image/astc.h"
 #include "scene_graph/components/light.h"
 #include "scene_graph/components/mesh.h"
+#include "scene_graph/components/mesh_arena.h"
 #include "scene_graph/components/pbr_material.h"
 #include "scene_graph/components/perspective_camera.h"
 #include "scene_graph/components/sampler.h"
@@ -276,55 +280,6 @@ inline std::vector<uint8_t> convert_underlying_data_stride(const std::vector<uin
 
 	return result;
 }
-
-inline void upload_image_to_gpu(CommandBuffer &command_buffer, core::Buffer &staging_buffer, sg::Image &image)
-{
-	// Clean up the image data, as they are copied in the staging buffer
-	image.clear_data();
-
-	{
-		ImageMemoryBarrier memory_barrier{};
-		memory_barrier.old_layout      = VK_IMAGE_LAYOUT_UNDEFINED;
-		memory_barrier.new_layout      = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-		memory_barrier.src_access_mask = 0;
-		memory_barrier.dst_access_mask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_HOST_BIT;
-		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
-
-		command_buffer.image_memory_barrier(image.get_vk_image_view(), memory_barrier);
-	}
-
-	// Create a buffer image copy for every mip level
-	auto &mipmaps = image.get_mipmaps();
-
-	std::vector<VkBufferImageCopy> buffer_copy_regions(mipmaps.size());
-
-	for (size_t i = 0; i < mipmaps.size(); ++i)
-	{
-		auto &mipmap      = mipmaps[i];
-		auto &copy_region = buffer_copy_regions[i];
-
-		copy_region.bufferOffset     = mipmap.offset;
-		copy_region.imageSubresource = image.get_vk_image_view().get_subresource_layers();
-		// Update miplevel
-		copy_region.imageSubresource.mipLevel = mipmap.level;
-		copy_region.imageExtent               = mipmap.extent;
-	}
-
-	command_buffer.copy_buffer_to_image(staging_buffer, image.get_vk_image(), buffer_copy_regions);
-
-	{
-		ImageMemoryBarrier memory_barrier{};
-		memory_barrier.old_layout      = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-		memory_barrier.new_layout      = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		memory_barrier.src_access_mask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		memory_barrier.dst_access_mask = VK_ACCESS_SHADER_READ_BIT;
-		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
-		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-
-		command_buffer.image_memory_barrier(image.get_vk_image_view(), memory_barrier);
-	}
-}
 }        // namespace
 
 std::unordered_map<std::string, bool> GLTFLoader::supported_extensions = {
@@ -335,6 +290,26 @@ GLTFLoader::GLTFLoader(Device &device) :
 {
 }
 
+void GLTFLoader::set_interleaved_vertices(bool interleave)
+{
+	interleaved_vertices = interleave;
+}
+
+void GLTFLoader::set_staging_budget(VkDeviceSize budget)
+{
+	staging_budget = budget;
+}
+
+void GLTFLoader::set_transfer_queue_uploads(bool enable)
+{
+	transfer_queue_uploads = enable;
+}
+
+void GLTFLoader::set_texture_streamer(TextureStreamer *streamer)
+{
+	texture_streamer = streamer;
+}
+
 std::unique_ptr<sg::Scene> GLTFLoader::read_scene_from_file(const std::string &file_name, int scene_index)
 {
 	std::string err;
@@ -469,89 +444,70 @@ sg::Scene GLTFLoader::load_scene(int scene_index)
 
 	scene.set_components(std::move(sampler_components));
 
-	Timer timer;
-	timer.start();
+	auto &queue = device.get_queue_by_flags(VK_QUEUE_GRAPHICS_BIT, 0);
 
-	// Load images
-	auto thread_count = std::thread::hardware_concurrency();
-	thread_count      = thread_count == 0 ? 1 : thread_count;
-	ctpl::thread_pool thread_pool(thread_count);
+	// Textures sample a placeholder until the texture streamer has uploaded their image,
+	// a flat normal for the normal maps and white for the others
+	sg::Image *placeholder_image{nullptr};
+	sg::Image *normal_placeholder_image{nullptr};
 
-	auto image_count = to_u32(model.images.size());
+	std::vector<bool> normal_map_textures(model.textures.size(), false);
 
-	std::vector<std::future<std::unique_ptr<sg::Image>>> image_component_futures;
-	for (size_t image_index = 0; image_index < image_count; image_index++)
+	if (texture_streamer)
 	{
-		auto fut = thread_pool.push(
-		    [this, image_index](size_t) {
-			    auto image = parse_image(model.images.at(image_index));
+		auto placeholder = texture_streamer->create_placeholder();
+		placeholder_image = placeholder.get();
+		scene.add_component(std::move(placeholder));
 
-			    LOGI("Loaded gltf image #{} ({})", image_index, model.images.at(image_index).uri.c_str());
+		for (auto &gltf_material : model.materials)
+		{
+			auto normal_texture = gltf_material.additionalValues.find("normalTexture");
 
-			    return image;
-		    });
+			if (normal_texture != gltf_material.additionalValues.end())
+			{
+				auto texture_index = normal_texture->second.TextureIndex();
 
-		image_component_futures.push_back(std::move(fut));
-	}
+				if (texture_index >= 0 && texture_index < static_cast<int>(normal_map_textures.size()))
+				{
+					normal_map_textures[texture_index] = true;
+				}
+			}
+		}
 
-	std::vector<std::unique_ptr<sg::Image>> image_components;
-	for (auto &fut : image_component_futures)
-	{
-		image_components.push_back(fut.get());
+		if (std::find(normal_map_textures.begin(), normal_map_textures.end(), true) != normal_map_textures.end())
+		{
+			auto normal_placeholder  = texture_streamer->create_placeholder(true);
+			normal_placeholder_image = normal_placeholder.get();
+			scene.add_component(std::move(normal_placeholder));
+		}
 	}
-
-	// Upload images to GPU
-	std::vector<core::Buffer> transient_buffers;
-
-	auto &command_buffer = device.request_command_buffer();
-
-	command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, 0);
-
-	for (size_t image_index = 0; image_index < image_count; image_index++)
+	else
 	{
-		auto &image = image_components.at(image_index);
-
-		core::Buffer stage_buffer{device,
-		                          image->get_data().size(),
-		                          VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		                          VMA_MEMORY_USAGE_CPU_ONLY};
-
-		stage_buffer.update(image->get_data());
-
-		upload_image_to_gpu(command_buffer, stage_buffer, *image);
-
-		transient_buffers.push_back(std::move(stage_buffer));
+		load_images(scene);
 	}
 
-	command_buffer.end();
-
-	auto &queue = device.get_queue_by_flags(VK_QUEUE_GRAPHICS_BIT, 0);
-
-	queue.submit(command_buffer, device.request_fence());
-
-	device.get_fence_pool().wait();
-	device.get_fence_pool().reset();
-	device.get_command_pool().reset_pool();
-	device.wait_idle();
-
-	transient_buffers.clear();
-
-	scene.set_components(std::move(image_components));
-
-	auto elapsed_time = timer.stop();
-
-	LOGI("Time spent loading images: {} seconds across {} threads.", vkb::to_string(elapsed_time), thread_count);
-
 	// Load textures
 	auto images          = scene.get_components<sg::Image>();
 	auto samplers        = scene.get_components<sg::Sampler>();
 	auto default_sampler = create_default_sampler();
 
-	for (auto &gltf_texture : model.textures)
+	std::vector<std::vector<sg::Texture *>> image_textures(model.images.size());
+
+	for (size_t texture_index = 0; texture_index < model.textures.size(); texture_index++)
 	{
+		auto &gltf_texture = model.textures[texture_index];
+
 		auto texture = parse_texture(gltf_texture);
 
-		texture->set_image(*images.at(gltf_texture.source));
+		if (placeholder_image)
+		{
+			texture->set_image(normal_map_textures[texture_index] ? *normal_placeholder_image : *placeholder_image);
+			image_textures.at(gltf_texture.source).push_back(texture.get());
+		}
+		else
+		{
+			texture->set_image(*images.at(gltf_texture.source));
+		}
 
 		if (gltf_texture.sampler >= 0 && gltf_texture.sampler < static_cast<int>(samplers.size()))
 		{
@@ -561,7 +517,7 @@ sg::Scene GLTFLoader::load_scene(int scene_index)
 		{
 			if (gltf_texture.name.empty())
 			{
-				gltf_texture.name = images.at(gltf_texture.source)->get_name();
+				gltf_texture.name = model.images.at(gltf_texture.source).name;
 			}
 
 			texture->set_sampler(*default_sampler);
@@ -572,6 +528,18 @@ sg::Scene GLTFLoader::load_scene(int scene_index)
 
 	scene.add_component(std::move(default_sampler));
 
+	if (texture_streamer)
+	{
+		for (size_t image_index = 0; image_index < model.images.size(); image_index++)
+		{
+			auto decode_image = [this, image_index]() {
+				return parse_image(model.images.at(image_index));
+			};
+
+			texture_streamer->request(decode_image, std::move(image_textures[image_index]));
+		}
+	}
+
 	// Load materials
 	bool                            has_textures = scene.has_component<sg::Texture>();
 	std::vector<vkb::sg::Texture *> textures;
@@ -609,9 +577,11 @@ sg::Scene GLTFLoader::load_scene(int scene_index)
 
 	auto default_material = create_default_material();
 
-	// Load meshes
+	// Load meshes, packing their geometry in device local buffers
 	auto materials = scene.get_components<sg::PBRMaterial>();
 
+	auto mesh_arena = std::make_unique<sg::MeshArena>(device);
+
 	for (auto &gltf_mesh : model.meshes)
 	{
 		auto mesh = parse_mesh(gltf_mesh);
@@ -620,31 +590,29 @@ sg::Scene GLTFLoader::load_scene(int scene_index)
 		{
 			auto submesh = std::make_unique<sg::SubMesh>();
 
-			for (auto &attribute : gltf_primitive.attributes)
-			{
-				std::string attrib_name = attribute.first;
-				std::transform(attrib_name.begin(), attrib_name.end(), attrib_name.begin(), ::tolower);
-
-				auto vertex_data = get_attribute_data(&model, attribute.second);
+			submesh->vertices_count = to_u32(get_attribute_size(&model, gltf_primitive.attributes.at("POSITION")));
 
-				if (attrib_name == "position")
+			if (interleaved_vertices)
+			{
+				load_interleaved_vertices(gltf_primitive, *submesh, *mesh_arena);
+			}
+			else
+			{
+				for (auto &attribute : gltf_primitive.attributes)
 				{
-					submesh->vertices_count = to_u32(model.accessors.at(attribute.second).count);
-				}
-
-				core::Buffer buffer{device,
-				                    vertex_data.size(),
-				                    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-				                    VMA_MEMORY_USAGE_GPU_TO_CPU};
-				buffer.update(vertex_data);
+					std::string attrib_name = attribute.first;
+					std::transform(attrib_name.begin(), attrib_name.end(), attrib_name.begin(), ::tolower);
 
-				submesh->vertex_buffers.insert(std::make_pair(attrib_name, std::move(buffer)));
+					mesh_arena->add(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+					                get_attribute_data(&model, attribute.second),
+					                submesh->packed_vertex_buffers[attrib_name]);
 
-				sg::VertexAttribute attrib;
-				attrib.format = get_attribute_format(&model, attribute.second);
-				attrib.stride = to_u32(get_attribute_stride(&model, attribute.second));
+					sg::VertexAttribute attrib;
+					attrib.format = get_attribute_format(&model, attribute.second);
+					attrib.stride = to_u32(get_attribute_stride(&model, attribute.second));
 
-				submesh->set_attribute(attrib_name, attrib);
+					submesh->set_attribute(attrib_name, attrib);
+				}
 			}
 
 			if (gltf_primitive.indices >= 0)
@@ -653,8 +621,7 @@ sg::Scene GLTFLoader::load_scene(int scene_index)
 
 				auto format = get_attribute_format(&model, gltf_primitive.indices);
 
-				auto vertex_data = get_attribute_data(&model, gltf_primitive.indices);
-				auto index_data  = get_attribute_data(&model, gltf_primitive.indices);
+				auto index_data = get_attribute_data(&model, gltf_primitive.indices);
 
 				switch (format)
 				{
@@ -674,16 +641,7 @@ sg::Scene GLTFLoader::load_scene(int scene_index)
 						break;
 				}
 
-				submesh->index_buffer = std::make_unique<core::Buffer>(device,
-				                                                       index_data.size(),
-				                                                       VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-				                                                       VMA_MEMORY_USAGE_GPU_TO_CPU);
-
-				submesh->index_buffer->update(index_data);
-			}
-			else
-			{
-				submesh->vertices_count = to_u32(get_attribute_size(&model, gltf_primitive.attributes.at("POSITION")));
+				mesh_arena->add(VK_BUFFER_USAGE_INDEX_BUFFER_BIT, std::move(index_data), submesh->packed_index_buffer);
 			}
 
 			if (gltf_primitive.material < 0)
@@ -703,11 +661,25 @@ sg::Scene GLTFLoader::load_scene(int scene_index)
 		scene.add_component(std::move(mesh));
 	}
 
+	LOGI("Packed {} bytes of geometry in device local buffers", mesh_arena->get_size());
+
+	auto &geometry_command_buffer = device.request_command_buffer();
+
+	geometry_command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, 0);
+
+	auto geometry_staging_buffer = mesh_arena->upload(geometry_command_buffer);
+
+	geometry_command_buffer.end();
+
+	queue.submit(geometry_command_buffer, device.request_fence());
+
 	device.get_fence_pool().wait();
 	device.get_fence_pool().reset();
 	device.get_command_pool().reset_pool();
 
-	transient_buffers.clear();
+	geometry_staging_buffer.reset();
+
+	scene.add_component(std::move(mesh_arena));
 
 	scene.add_component(std::move(default_material));
 
@@ -833,6 +805,125 @@ sg::Scene GLTFLoader::load_scene(int scene_index)
 	return scene;
 }
 
+void GLTFLoader::load_images(sg::Scene &scene)
+{
+	Timer timer;
+	timer.start();
+
+	// Load images, uploading each one as soon as it is decoded, while the next ones are decoding
+	auto thread_count = std::thread::hardware_concurrency();
+	thread_count      = thread_count == 0 ? 1 : thread_count;
+	ctpl::thread_pool thread_pool(thread_count);
+
+	auto image_count = to_u32(model.images.size());
+
+	// Bound the number of decoded images waiting for their upload
+	auto max_decoding_images = 2 * thread_count;
+
+	std::vector<std::future<std::unique_ptr<sg::Image>>> image_component_futures(image_count);
+
+	auto decode_image = [this, &thread_pool, &image_component_futures](size_t image_index) {
+		image_component_futures[image_index] = thread_pool.push(
+		    [this, image_index](size_t) {
+			    auto image = parse_image(model.images.at(image_index));
+
+			    LOGI("Loaded gltf image #{} ({})", image_index, model.images.at(image_index).uri.c_str());
+
+			    return image;
+		    });
+	};
+
+	for (size_t image_index = 0; image_index < std::min<size_t>(image_count, max_decoding_images); image_index++)
+	{
+		decode_image(image_index);
+	}
+
+	ImageUploader image_uploader{device, staging_budget, transfer_queue_uploads};
+
+	std::vector<std::unique_ptr<sg::Image>> image_components;
+
+	for (size_t image_index = 0; image_index < image_count; image_index++)
+	{
+		image_components.push_back(image_component_futures[image_index].get());
+
+		if (image_index + max_decoding_images < image_count)
+		{
+			decode_image(image_index + max_decoding_images);
+		}
+
+		image_uploader.upload(*image_components.back());
+	}
+
+	image_uploader.flush();
+
+	scene.set_components(std::move(image_components));
+
+	auto elapsed_time = timer.stop();
+
+	LOGI("Time spent loading images: {} seconds across {} threads.", vkb::to_string(elapsed_time), thread_count);
+}
+
+void GLTFLoader::load_interleaved_vertices(const tinygltf::Primitive &gltf_primitive, sg::SubMesh &submesh, sg::MeshArena &mesh_arena)
+{
+	struct InterleavedAttribute
+	{
+		std::string name;
+
+		std::vector<uint8_t> data;
+
+		size_t stride;
+
+		size_t size;
+	};
+
+	std::vector<InterleavedAttribute> attributes;
+
+	// Each attribute starts at a 4-byte boundary of the vertex
+	uint32_t vertex_stride = 0;
+
+	for (auto &attribute : gltf_primitive.attributes)
+	{
+		auto &accessor = model.accessors.at(attribute.second);
+
+		InterleavedAttribute interleaved;
+		interleaved.name = attribute.first;
+		std::transform(interleaved.name.begin(), interleaved.name.end(), interleaved.name.begin(), ::tolower);
+		interleaved.data   = get_attribute_data(&model, attribute.second);
+		interleaved.stride = get_attribute_stride(&model, attribute.second);
+		interleaved.size   = tinygltf::GetComponentSizeInBytes(accessor.componentType) * tinygltf::GetTypeSizeInBytes(accessor.type);
+
+		sg::VertexAttribute attrib;
+		attrib.format = get_attribute_format(&model, attribute.second);
+		attrib.offset = vertex_stride;
+
+		vertex_stride += to_u32((interleaved.size + 3) & ~size_t(3));
+
+		submesh.set_attribute(interleaved.name, attrib);
+
+		attributes.push_back(std::move(interleaved));
+	}
+
+	std::vector<uint8_t> vertex_data(static_cast<size_t>(submesh.vertices_count) * vertex_stride);
+
+	for (auto &interleaved : attributes)
+	{
+		sg::VertexAttribute attrib;
+		submesh.get_attribute(interleaved.name, attrib);
+
+		attrib.stride = vertex_stride;
+		submesh.set_attribute(interleaved.name, attrib);
+
+		size_t count = std::min<size_t>(submesh.vertices_count, interleaved.data.size() / interleaved.stride);
+
+		for (size_t v = 0; v < count; v++)
+		{
+			std::copy_n(interleaved.data.data() + v * interleaved.stride, interleaved.size, vertex_data.data() + v * vertex_stride + attrib.offset);
+		}
+	}
+
+	mesh_arena.add(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, std::move(vertex_data), submesh.interleaved_vertex_buffer);
+}
+
 std::unique_ptr<sg::SubMesh> GLTFLoader::load_model(uint32_t index)
 {
 	auto submesh = std::make_unique<sg::SubMesh>();
@@ -1147,10 +1238,15 @@ std::unique_ptr<sg::Image> GLTFLoader::parse_image(tinygltf::Image &gltf_image)
 		{
 			LOGW("ASTC not supported: decoding {}", image->get_name());
 			image = std::make_unique<sg::Astc>(*image);
-			image->generate_mipmaps();
 		}
 	}
 
+	// Generate the missing mip levels on the GPU, once the image is uploaded
+	if (image->get_mipmaps().size() == 1 && image->get_layers() == 1 && device.is_image_format_blittable(image->get_format()))
+	{
+		image->add_gpu_mipmaps();
+	}
+
 	image->create_vk_image(device);
 
 	return image;
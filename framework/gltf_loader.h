@@ -26,6 +26,7 @@
 #define TINYGLTF_NO_EXTERNAL_IMAGE
 #include <tiny_gltf.h>
 
+#include "image_uploader.h"
 #include "timer.h"
 
 #define KHR_LIGHTS_PUNCTUAL_EXTENSION "KHR_lights_punctual"
@@ -33,6 +34,7 @@
 namespace vkb
 {
 class Device;
+class TextureStreamer;
 
 namespace sg
 {
@@ -40,6 +42,7 @@ class Camera;
 class Image;
 class Light;
 class Mesh;
+class MeshArena;
 class Node;
 class PBRMaterial;
 class Sampler;
@@ -81,6 +84,29 @@ class GLTFLoader
 	 */
 	std::unique_ptr<sg::SubMesh> read_model_from_file(const std::string &file_name, uint32_t index);
 
+	/**
+	 * @brief Sets whether the vertex attributes of each submesh of a scene are interleaved
+	 *        in a single stream, or kept in a stream per attribute. They are interleaved by default.
+	 */
+	void set_interleaved_vertices(bool interleave);
+
+	/**
+	 * @brief Sets the size of the staging ring buffer which streams the images of a scene to the GPU,
+	 *        which bounds the host visible memory used by the uploads
+	 */
+	void set_staging_budget(VkDeviceSize budget);
+
+	/**
+	 * @brief Sets whether the images of a scene are uploaded on a dedicated transfer queue, if the GPU has one
+	 */
+	void set_transfer_queue_uploads(bool enable);
+
+	/**
+	 * @brief Sets a texture streamer to load the images of a scene after read_scene_from_file() returns,
+	 *        its textures sampling a placeholder until then. The loader must outlive the streaming
+	 */
+	void set_texture_streamer(TextureStreamer *streamer);
+
   protected:
 	virtual std::unique_ptr<sg::Node> parse_node(const tinygltf::Node &gltf_node, size_t index) const;
 
@@ -128,12 +154,30 @@ class GLTFLoader
 
 	std::string model_path;
 
+	bool interleaved_vertices{true};
+
+	VkDeviceSize staging_budget{ImageUploader::DEFAULT_RING_SIZE};
+
+	bool transfer_queue_uploads{false};
+
+	TextureStreamer *texture_streamer{nullptr};
+
 	/// The extensions that the GLTFLoader can load mapped to whether they should be enabled or not
 	static std::unordered_map<std::string, bool> supported_extensions;
 
   private:
 	sg::Scene load_scene(int scene_index = -1);
 
+	/**
+	 * @brief Decodes the images of the model and uploads them, adding them to the scene
+	 */
+	void load_images(sg::Scene &scene);
+
 	std::unique_ptr<sg::SubMesh> load_model(uint32_t index);
+
+	/**
+	 * @brief Packs the vertex attributes of a primitive in a single stream, added to the arena
+	 */
+	void load_interleaved_vertices(const tinygltf::Primitive &gltf_primitive, sg::SubMesh &submesh, sg::MeshArena &mesh_arena);
 };
 }        // namespace vkb
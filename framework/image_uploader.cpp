@@ -0,0 +1,630 @@
+/* Copyright (c) 2021, Samsung
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "image_uploader.h"
+
+#include <algorithm>
+
+#include "common/logging.h"
+#include "core/device.h"
+#include "scene_graph/components/image.h"
+
+namespace vkb
+{
+namespace
+{
+/// Number of batches which can be recording or in flight at the same time
+constexpr size_t batch_count = 4;
+
+/// Alignment of the image data in the ring, a multiple of the texel block size of the formats we load
+constexpr VkDeviceSize data_alignment = 16;
+
+inline VkDeviceSize align_size(VkDeviceSize size)
+{
+	return (size + data_alignment - 1) & ~(data_alignment - 1);
+}
+}        // namespace
+
+ImageUploader::ImageUploader(Device &device, VkDeviceSize ring_size, bool use_transfer_queue) :
+    device{device},
+    ring{device, align_size(ring_size), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY},
+    batch_budget{ring.get_size() / batch_count}
+{
+	graphics_queue = &device.get_queue_by_flags(VK_QUEUE_GRAPHICS_BIT, 0);
+	queue          = graphics_queue;
+
+	if (use_transfer_queue)
+	{
+		auto transfer_family_index = device.get_queue_family_index(VK_QUEUE_TRANSFER_BIT);
+
+		if (transfer_family_index != graphics_queue->get_family_index())
+		{
+			queue = &device.get_queue(transfer_family_index, 0);
+		}
+		else
+		{
+			LOGW("No dedicated transfer queue, uploading images on the graphics queue");
+		}
+	}
+
+	batches.resize(batch_count);
+
+	for (auto &batch : batches)
+	{
+		batch.command_pool = std::make_unique<CommandPool>(device, queue->get_family_index());
+		batch.fence_pool   = std::make_unique<FencePool>(device);
+	}
+
+	if (uses_transfer_queue())
+	{
+		acquires.resize(batch_count);
+
+		for (auto &graphics_acquire : acquires)
+		{
+			graphics_acquire.command_pool = std::make_unique<CommandPool>(device, graphics_queue->get_family_index());
+			graphics_acquire.fence_pool   = std::make_unique<FencePool>(device);
+		}
+	}
+}
+
+ImageUploader::~ImageUploader()
+{
+	flush();
+}
+
+bool ImageUploader::uses_transfer_queue() const
+{
+	return queue != graphics_queue;
+}
+
+uint64_t ImageUploader::upload(sg::Image &image, uint32_t base_mip_level, uint32_t mip_level_count)
+{
+	auto &data = image.get_data();
+
+	auto serial = upload(image, data.data(), data.size(), base_mip_level, mip_level_count);
+
+	if (base_mip_level == 0)
+	{
+		image.clear_data();
+	}
+
+	return serial;
+}
+
+uint64_t ImageUploader::upload(sg::Image &image, const uint8_t *data, size_t data_size)
+{
+	return upload(image, data, data_size, 0, 0);
+}
+
+uint64_t ImageUploader::upload(sg::Image &image, const uint8_t *data, size_t data_size, uint32_t base_mip_level, uint32_t mip_level_count)
+{
+	auto &mipmaps = image.get_mipmaps();
+
+	if (mip_level_count == 0)
+	{
+		mip_level_count = to_u32(mipmaps.size()) - base_mip_level;
+	}
+
+	assert(base_mip_level + mip_level_count <= mipmaps.size() && "Mip levels out of range");
+
+	// The data of the mip levels follow each other, the smallest last
+	size_t data_begin = mipmaps[base_mip_level].offset;
+	size_t data_end   = base_mip_level + mip_level_count < mipmaps.size() ? mipmaps[base_mip_level + mip_level_count].offset : data_size;
+
+	auto size = align_size(data_end - data_begin);
+
+	uint64_t serial = 0;
+
+	if (size > ring.get_size())
+	{
+		// Too large for the ring: stage the data on its own
+		auto staging_buffer = std::make_unique<core::Buffer>(device,
+		                                                     data_end - data_begin,
+		                                                     VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		                                                     VMA_MEMORY_USAGE_CPU_ONLY);
+
+		staging_buffer->update(data + data_begin, data_end - data_begin);
+
+		auto &batch = get_recording_batch();
+
+		record_copy(*batch.command_buffer, *staging_buffer, 0, image, base_mip_level, mip_level_count);
+
+		batch.dedicated_buffers.push_back(std::move(staging_buffer));
+
+		serial = batch.serial;
+
+		submit_recording_batch();
+	}
+	else
+	{
+		// Allocate first, as making space may submit the recording batch and retire older ones
+		auto allocation = allocate(size);
+
+		ring.update(data + data_begin, data_end - data_begin, allocation.offset);
+
+		auto &batch = get_recording_batch();
+
+		record_copy(*batch.command_buffer, ring, allocation.offset, image, base_mip_level, mip_level_count);
+
+		batch.ring_bytes += allocation.size;
+
+		serial = batch.serial;
+
+		if (batch.ring_bytes >= batch_budget)
+		{
+			submit_recording_batch();
+		}
+	}
+
+	return serial;
+}
+
+void ImageUploader::submit()
+{
+	if (recording_batch >= 0)
+	{
+		submit_recording_batch();
+	}
+}
+
+bool ImageUploader::is_complete(uint64_t serial)
+{
+	while (!in_flight_batches.empty() && completed_serial < serial)
+	{
+		auto &batch = batches[in_flight_batches.front()];
+
+		if (vkGetFenceStatus(device.get_handle(), batch.fence) != VK_SUCCESS)
+		{
+			break;
+		}
+
+		retire_oldest_batch();
+	}
+
+	if (!uses_transfer_queue())
+	{
+		return serial <= completed_serial;
+	}
+
+	while (!in_flight_acquires.empty() && acquired_serial < serial)
+	{
+		if (vkGetFenceStatus(device.get_handle(), acquires[in_flight_acquires.front()].fence) != VK_SUCCESS)
+		{
+			break;
+		}
+
+		retire_oldest_acquire();
+	}
+
+	return serial <= acquired_serial;
+}
+
+void ImageUploader::acquire()
+{
+	if (!uses_transfer_queue())
+	{
+		return;
+	}
+
+	while (!in_flight_batches.empty() && vkGetFenceStatus(device.get_handle(), batches[in_flight_batches.front()].fence) == VK_SUCCESS)
+	{
+		retire_oldest_batch();
+	}
+
+	if (released_images.empty())
+	{
+		if (in_flight_acquires.empty())
+		{
+			acquired_serial = completed_serial;
+		}
+
+		return;
+	}
+
+	if (in_flight_acquires.size() == acquires.size())
+	{
+		retire_oldest_acquire();
+	}
+
+	// Pick an acquire which is not in flight
+	size_t acquire_index = 0;
+
+	while (std::find(in_flight_acquires.begin(), in_flight_acquires.end(), acquire_index) != in_flight_acquires.end())
+	{
+		acquire_index++;
+	}
+
+	auto &graphics_acquire = acquires[acquire_index];
+
+	auto &command_buffer = graphics_acquire.command_pool->request_command_buffer();
+
+	command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+	record_acquire(command_buffer);
+
+	command_buffer.end();
+
+	graphics_acquire.fence  = graphics_acquire.fence_pool->request_fence();
+	graphics_acquire.serial = completed_serial;
+
+	graphics_queue->submit(command_buffer, graphics_acquire.fence);
+
+	in_flight_acquires.push_back(acquire_index);
+}
+
+void ImageUploader::flush()
+{
+	submit();
+
+	while (!in_flight_batches.empty())
+	{
+		retire_oldest_batch();
+	}
+
+	while (!in_flight_acquires.empty())
+	{
+		retire_oldest_acquire();
+	}
+
+	if (!released_images.empty())
+	{
+		auto &command_buffer = device.request_command_buffer();
+
+		command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+		record_acquire(command_buffer);
+
+		command_buffer.end();
+
+		graphics_queue->submit(command_buffer, device.request_fence());
+
+		device.get_fence_pool().wait();
+		device.get_fence_pool().reset();
+		device.get_command_pool().reset_pool();
+	}
+
+	acquired_serial = completed_serial;
+}
+
+void ImageUploader::record_acquire(CommandBuffer &command_buffer)
+{
+	// Acquire the ownership of the images released by the transfer queue
+	std::vector<VkImageMemoryBarrier> image_barriers;
+
+	for (auto &released_image : released_images)
+	{
+		VkImageMemoryBarrier image_barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+		image_barrier.oldLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		image_barrier.newLayout           = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		image_barrier.srcAccessMask       = 0;
+		image_barrier.dstAccessMask       = VK_ACCESS_SHADER_READ_BIT;
+		image_barrier.srcQueueFamilyIndex = queue->get_family_index();
+		image_barrier.dstQueueFamilyIndex = graphics_queue->get_family_index();
+		image_barrier.image               = released_image.image->get_vk_image().get_handle();
+		image_barrier.subresourceRange    = released_image.subresource_range;
+
+		// The mip levels are generated from the copied levels, which stay in transfer layout
+		if (released_image.generate_mipmaps)
+		{
+			image_barrier.newLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			image_barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+		}
+
+		image_barriers.push_back(image_barrier);
+	}
+
+	command_buffer.pipeline_barrier(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, {}, image_barriers);
+
+	for (auto &released_image : released_images)
+	{
+		if (released_image.generate_mipmaps)
+		{
+			record_mipmap_generation(command_buffer, *released_image.image, released_image.subresource_range.baseMipLevel);
+		}
+	}
+
+	released_images.clear();
+}
+
+ImageUploader::Batch &ImageUploader::get_recording_batch()
+{
+	if (recording_batch < 0)
+	{
+		if (in_flight_batches.size() == batches.size())
+		{
+			retire_oldest_batch();
+		}
+
+		// Pick a batch which is not in flight
+		for (size_t i = 0; i < batches.size(); i++)
+		{
+			if (std::find(in_flight_batches.begin(), in_flight_batches.end(), i) == in_flight_batches.end())
+			{
+				recording_batch = static_cast<int>(i);
+				break;
+			}
+		}
+
+		auto &batch = batches[recording_batch];
+
+		batch.serial         = next_serial++;
+		batch.command_buffer = &batch.command_pool->request_command_buffer();
+		batch.command_buffer->begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+	}
+
+	return batches[recording_batch];
+}
+
+ImageUploader::RingAllocation ImageUploader::allocate(VkDeviceSize size)
+{
+	while (true)
+	{
+		if (ring_used == 0)
+		{
+			ring_head = 0;
+		}
+
+		// Skip the end of the ring if the data does not fit there
+		bool wrap     = ring_head + size > ring.get_size();
+		auto required = wrap ? ring.get_size() - ring_head + size : size;
+
+		if (ring_used + required <= ring.get_size())
+		{
+			auto offset = wrap ? 0 : ring_head;
+
+			ring_head = offset + size;
+			ring_used += required;
+
+			return {offset, required};
+		}
+
+		// Make space by retiring batches, oldest first
+		if (recording_batch >= 0 && batches[recording_batch].ring_bytes > 0)
+		{
+			submit_recording_batch();
+		}
+
+		retire_oldest_batch();
+	}
+}
+
+void ImageUploader::submit_recording_batch()
+{
+	assert(recording_batch >= 0 && "No batch is recording");
+
+	auto &batch = batches[recording_batch];
+
+	batch.command_buffer->end();
+
+	batch.fence = batch.fence_pool->request_fence();
+
+	queue->submit(*batch.command_buffer, batch.fence);
+
+	in_flight_batches.push_back(static_cast<size_t>(recording_batch));
+
+	recording_batch = -1;
+}
+
+void ImageUploader::retire_oldest_batch()
+{
+	assert(!in_flight_batches.empty() && "No batch is in flight");
+
+	auto &batch = batches[in_flight_batches.front()];
+
+	batch.fence_pool->wait();
+	batch.fence_pool->reset();
+	batch.command_pool->reset_pool();
+
+	batch.command_buffer = nullptr;
+	batch.fence          = VK_NULL_HANDLE;
+
+	completed_serial = batch.serial;
+
+	ring_used -= batch.ring_bytes;
+	batch.ring_bytes = 0;
+
+	batch.dedicated_buffers.clear();
+
+	released_images.insert(released_images.end(), batch.released_images.begin(), batch.released_images.end());
+	batch.released_images.clear();
+
+	in_flight_batches.pop_front();
+}
+
+void ImageUploader::retire_oldest_acquire()
+{
+	assert(!in_flight_acquires.empty() && "No acquire is in flight");
+
+	auto &graphics_acquire = acquires[in_flight_acquires.front()];
+
+	graphics_acquire.fence_pool->wait();
+	graphics_acquire.fence_pool->reset();
+	graphics_acquire.command_pool->reset_pool();
+
+	graphics_acquire.fence = VK_NULL_HANDLE;
+
+	acquired_serial = graphics_acquire.serial;
+
+	in_flight_acquires.pop_front();
+}
+
+void ImageUploader::record_copy(CommandBuffer &command_buffer, const core::Buffer &staging_buffer, VkDeviceSize staging_offset,
+                                sg::Image &image, uint32_t base_mip_level, uint32_t mip_level_count)
+{
+	auto subresource_range = image.get_vk_image_view().get_subresource_range();
+
+	subresource_range.baseMipLevel = base_mip_level;
+	subresource_range.levelCount   = mip_level_count;
+
+	VkImageMemoryBarrier image_barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+	image_barrier.oldLayout           = VK_IMAGE_LAYOUT_UNDEFINED;
+	image_barrier.newLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	image_barrier.srcAccessMask       = 0;
+	image_barrier.dstAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+	image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	image_barrier.image               = image.get_vk_image().get_handle();
+	image_barrier.subresourceRange    = subresource_range;
+
+	command_buffer.pipeline_barrier(VK_PIPELINE_STAGE_HOST_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, {}, {image_barrier});
+
+	// Create a buffer image copy for every mip level, the data of base_mip_level being at staging_offset
+	auto &mipmaps = image.get_mipmaps();
+
+	std::vector<VkBufferImageCopy> buffer_copy_regions(mip_level_count);
+
+	for (uint32_t i = 0; i < mip_level_count; ++i)
+	{
+		auto &mipmap      = mipmaps[base_mip_level + i];
+		auto &copy_region = buffer_copy_regions[i];
+
+		copy_region.bufferOffset     = staging_offset + mipmap.offset - mipmaps[base_mip_level].offset;
+		copy_region.imageSubresource = image.get_vk_image_view().get_subresource_layers();
+		// Update miplevel
+		copy_region.imageSubresource.mipLevel = mipmap.level;
+		copy_region.imageExtent               = mipmap.extent;
+	}
+
+	command_buffer.copy_buffer_to_image(staging_buffer, image.get_vk_image(), buffer_copy_regions);
+
+	// The levels below the data are blitted once its smallest level is copied
+	bool generate_mipmaps = image.get_gpu_mip_level_count() > 0 && base_mip_level + mip_level_count == mipmaps.size();
+
+	image_barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	image_barrier.newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	image_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+	if (uses_transfer_queue())
+	{
+		// Release the image to the graphics queue, which acquires it in flush().
+		// Blits need a graphics queue, so the mip levels are generated there
+		if (generate_mipmaps)
+		{
+			image_barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		}
+
+		image_barrier.dstAccessMask       = 0;
+		image_barrier.srcQueueFamilyIndex = queue->get_family_index();
+		image_barrier.dstQueueFamilyIndex = graphics_queue->get_family_index();
+
+		command_buffer.pipeline_barrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, {}, {image_barrier});
+
+		batches[recording_batch].released_images.push_back({&image, subresource_range, generate_mipmaps});
+	}
+	else if (generate_mipmaps)
+	{
+		record_mipmap_generation(command_buffer, image, base_mip_level);
+	}
+	else
+	{
+		image_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		command_buffer.pipeline_barrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, {}, {image_barrier});
+	}
+}
+
+void ImageUploader::record_mipmap_generation(CommandBuffer &command_buffer, sg::Image &image, uint32_t base_mip_level)
+{
+	auto &vk_image = image.get_vk_image();
+
+	auto data_level_count = to_u32(image.get_mipmaps().size());
+	auto mip_level_count  = data_level_count + image.get_gpu_mip_level_count();
+
+	VkImageMemoryBarrier image_barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+	image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	image_barrier.image               = vk_image.get_handle();
+	image_barrier.subresourceRange    = image.get_vk_image_view().get_subresource_range();
+
+	auto set_mip_levels = [&image_barrier](uint32_t base, uint32_t count) {
+		image_barrier.subresourceRange.baseMipLevel = base;
+		image_barrier.subresourceRange.levelCount   = count;
+	};
+
+	std::vector<VkImageMemoryBarrier> image_barriers;
+
+	// The copied levels above the smallest one are ready to be sampled
+	if (base_mip_level + 1 < data_level_count)
+	{
+		image_barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		image_barrier.newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		image_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		image_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		set_mip_levels(base_mip_level, data_level_count - 1 - base_mip_level);
+
+		command_buffer.pipeline_barrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, {}, {image_barrier});
+	}
+
+	// The smallest copied level is the source of the first blit
+	image_barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	image_barrier.newLayout     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	image_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	image_barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	set_mip_levels(data_level_count - 1, 1);
+
+	image_barriers.push_back(image_barrier);
+
+	image_barrier.oldLayout     = VK_IMAGE_LAYOUT_UNDEFINED;
+	image_barrier.newLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	image_barrier.srcAccessMask = 0;
+	image_barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	set_mip_levels(data_level_count, mip_level_count - data_level_count);
+
+	image_barriers.push_back(image_barrier);
+
+	command_buffer.pipeline_barrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, {}, image_barriers);
+
+	// Blit each level from the previous one, halving the extent
+	auto subresource_layers = image.get_vk_image_view().get_subresource_layers();
+
+	auto extent = image.get_mipmaps().back().extent;
+
+	for (uint32_t level = data_level_count; level < mip_level_count; level++)
+	{
+		VkImageBlit blit{};
+		blit.srcSubresource          = subresource_layers;
+		blit.srcSubresource.mipLevel = level - 1;
+		blit.srcOffsets[1]           = {static_cast<int32_t>(extent.width), static_cast<int32_t>(extent.height), 1};
+
+		extent.width  = std::max(extent.width / 2, 1u);
+		extent.height = std::max(extent.height / 2, 1u);
+
+		blit.dstSubresource          = subresource_layers;
+		blit.dstSubresource.mipLevel = level;
+		blit.dstOffsets[1]           = {static_cast<int32_t>(extent.width), static_cast<int32_t>(extent.height), 1};
+
+		command_buffer.blit_image(vk_image, vk_image, {blit}, VK_FILTER_LINEAR);
+
+		// The level is the source of the next blit
+		image_barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		image_barrier.newLayout     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		image_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		image_barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		set_mip_levels(level, 1);
+
+		command_buffer.pipeline_barrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, {}, {image_barrier});
+	}
+
+	image_barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	image_barrier.newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	image_barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	image_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	set_mip_levels(data_level_count - 1, mip_level_count - data_level_count + 1);
+
+	command_buffer.pipeline_barrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, {}, {image_barrier});
+}
+}        // namespace vkb
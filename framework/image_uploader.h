@@ -0,0 +1,256 @@
+/* Copyright (c) 2021, Samsung
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "common/helpers.h"
+#include "common/vk_common.h"
+#include "core/buffer.h"
+#include "core/command_pool.h"
+#include "fence_pool.h"
+
+namespace vkb
+{
+class Device;
+class Queue;
+
+namespace sg
+{
+class Image;
+}
+
+/**
+ * @brief Streams image data to the GPU through a fixed size staging ring buffer.
+ *        Copies are recorded in batches, each submitted with its own fence, and the
+ *        ring space of a batch is reused once its fence is signaled. Only the images
+ *        which do not fit in the ring get a staging buffer of their own. The mip levels
+ *        which an image generates on the GPU are blitted once its smallest level is copied.
+ */
+class ImageUploader
+{
+  public:
+	/// Default size of the staging ring buffer
+	static constexpr VkDeviceSize DEFAULT_RING_SIZE = 64 * 1024 * 1024;
+
+	/**
+	 * @brief Creates an image uploader
+	 * @param device A valid Vulkan device
+	 * @param ring_size The size in bytes of the staging ring buffer, which bounds
+	 *        the host visible memory used by the uploads
+	 * @param use_transfer_queue Whether to submit the copies to a dedicated transfer queue,
+	 *        if the GPU has one. The images are then acquired by the graphics queue in flush()
+	 */
+	ImageUploader(Device &device, VkDeviceSize ring_size = DEFAULT_RING_SIZE, bool use_transfer_queue = false);
+
+	ImageUploader(const ImageUploader &) = delete;
+
+	ImageUploader(ImageUploader &&) = delete;
+
+	~ImageUploader();
+
+	ImageUploader &operator=(const ImageUploader &) = delete;
+
+	ImageUploader &operator=(ImageUploader &&) = delete;
+
+	/**
+	 * @brief Copies the data of some mip levels of an image to its Vulkan image. The data is
+	 *        cleared once mip level 0 is copied, so partial uploads go from the smallest level.
+	 *        Waits for older batches only if the ring is full
+	 * @param image An image whose Vulkan image has been created
+	 * @param base_mip_level The first mip level to copy
+	 * @param mip_level_count The number of mip levels to copy, 0 for all the levels from base_mip_level
+	 * @return The serial of the batch recording the copy, to pass to is_complete()
+	 */
+	uint64_t upload(sg::Image &image, uint32_t base_mip_level = 0, uint32_t mip_level_count = 0);
+
+	/**
+	 * @brief Copies all the mip levels of an image from data which the image does not own,
+	 *        e.g. mapped from a file, laid out like the data of the image
+	 * @param image An image whose Vulkan image has been created
+	 * @param data The data of the mip levels, which is only read during the call
+	 * @param data_size The number of bytes of the data
+	 * @return The serial of the batch recording the copy, to pass to is_complete()
+	 */
+	uint64_t upload(sg::Image &image, const uint8_t *data, size_t data_size);
+
+	/**
+	 * @brief Submits the pending copies without waiting for them
+	 */
+	void submit();
+
+	/**
+	 * @brief Retires the batches which have completed, without waiting for the others
+	 * @param serial A serial returned by upload()
+	 * @return Whether the batch with that serial has completed, after which the mip levels it copied
+	 *         can be sampled by the graphics queue. With a dedicated transfer queue, the batch completes
+	 *         once acquire() or flush() has acquired its images on the graphics queue
+	 */
+	bool is_complete(uint64_t serial);
+
+	/**
+	 * @brief Submits the acquire of the images copied by the completed batches to the graphics queue,
+	 *        without waiting for it. It does nothing unless the copies use a dedicated transfer queue
+	 */
+	void acquire();
+
+	/**
+	 * @brief Submits the pending copies and waits for all the batches to complete,
+	 *        after which the uploaded images are ready to be sampled
+	 */
+	void flush();
+
+	/**
+	 * @return Whether the copies are submitted to a dedicated transfer queue
+	 */
+	bool uses_transfer_queue() const;
+
+  private:
+	struct ReleasedImage
+	{
+		sg::Image *image;
+
+		VkImageSubresourceRange subresource_range;
+
+		/// Whether the mip levels below the copied ones are generated after the acquire
+		bool generate_mipmaps;
+	};
+
+	struct Batch
+	{
+		std::unique_ptr<CommandPool> command_pool;
+
+		std::unique_ptr<FencePool> fence_pool;
+
+		CommandBuffer *command_buffer{nullptr};
+
+		VkFence fence{VK_NULL_HANDLE};
+
+		uint64_t serial{0};
+
+		/// Bytes of the ring used by the batch, including the space skipped when wrapping
+		VkDeviceSize ring_bytes{0};
+
+		/// Staging buffers of the images which did not fit in the ring
+		std::vector<std::unique_ptr<core::Buffer>> dedicated_buffers;
+
+		/// Images released by the transfer queue, to acquire on the graphics queue
+		std::vector<ReleasedImage> released_images;
+	};
+
+	/// A submission of the graphics queue acquiring the images released by the transfer queue
+	struct Acquire
+	{
+		std::unique_ptr<CommandPool> command_pool;
+
+		std::unique_ptr<FencePool> fence_pool;
+
+		VkFence fence{VK_NULL_HANDLE};
+
+		/// Serial of the last batch whose images it acquires
+		uint64_t serial{0};
+	};
+
+	uint64_t upload(sg::Image &image, const uint8_t *data, size_t data_size, uint32_t base_mip_level, uint32_t mip_level_count);
+
+	Batch &get_recording_batch();
+
+	/// Space reserved in the ring for the data of a copy
+	struct RingAllocation
+	{
+		VkDeviceSize offset;
+
+		/// Bytes taken from the ring, including the end of the ring skipped when wrapping
+		VkDeviceSize size;
+	};
+
+	/**
+	 * @brief Finds space for size bytes in the ring, waiting for older batches if needed
+	 * @return The space reserved, which the recording batch owns until it retires
+	 */
+	RingAllocation allocate(VkDeviceSize size);
+
+	void submit_recording_batch();
+
+	void retire_oldest_batch();
+
+	void retire_oldest_acquire();
+
+	/**
+	 * @brief Acquires the released images on the graphics queue, and generates their mip levels
+	 * @param command_buffer A command buffer of the graphics queue to record to
+	 */
+	void record_acquire(CommandBuffer &command_buffer);
+
+	void record_copy(CommandBuffer &command_buffer, const core::Buffer &staging_buffer, VkDeviceSize staging_offset,
+	                 sg::Image &image, uint32_t base_mip_level, uint32_t mip_level_count);
+
+	/**
+	 * @brief Blits the mip levels generated on the GPU from the smallest level of the data, on a graphics queue
+	 * @param command_buffer The command buffer to record to
+	 * @param image An image whose data levels from base_mip_level are in transfer destination layout
+	 * @param base_mip_level The first copied mip level, transitioned to shader read layout with the generated levels
+	 */
+	void record_mipmap_generation(CommandBuffer &command_buffer, sg::Image &image, uint32_t base_mip_level);
+
+	Device &device;
+
+	const Queue *queue{nullptr};
+
+	const Queue *graphics_queue{nullptr};
+
+	core::Buffer ring;
+
+	/// Offset of the next allocation in the ring
+	VkDeviceSize ring_head{0};
+
+	/// Bytes of the ring used by the batches which have not retired
+	VkDeviceSize ring_used{0};
+
+	/// Bytes of the ring after which the recording batch is submitted
+	VkDeviceSize batch_budget{0};
+
+	std::vector<Batch> batches;
+
+	/// Index of the batch recording copies, if any
+	int recording_batch{-1};
+
+	/// Indices of the submitted batches, oldest first
+	std::deque<size_t> in_flight_batches;
+
+	/// Serial of the next batch to start recording
+	uint64_t next_serial{1};
+
+	/// Serial of the last retired batch, as batches retire in order
+	uint64_t completed_serial{0};
+
+	/// Images released by the retired batches, to acquire on the graphics queue
+	std::vector<ReleasedImage> released_images;
+
+	/// Submissions acquiring the released images, only used with a dedicated transfer queue
+	std::vector<Acquire> acquires;
+
+	/// Indices of the submitted acquires, oldest first
+	std::deque<size_t> in_flight_acquires;
+
+	/// Serial of the last batch whose images have been acquired by the graphics queue
+	uint64_t acquired_serial{0};
+};
+}        // namespace vkb
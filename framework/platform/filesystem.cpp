@@ -17,6 +17,11 @@
 
 #include "platform/filesystem.h"
 
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <sys/stat.h>
+
 #include "common/error.h"
 
 VKBP_DISABLE_WARNINGS()
@@ -26,6 +31,14 @@ VKBP_ENABLE_WARNINGS()
 
 #include "platform/platform.h"
 
+#ifdef _WIN32
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <unistd.h>
+#endif
+
 namespace vkb
 {
 namespace fs
@@ -37,7 +50,8 @@ const std::unordered_map<Type, std::string> relative_paths = {{Type::Assets, "as
                                                               {Type::Storage, "output/"},
                                                               {Type::Screenshots, "output/images/"},
                                                               {Type::Logs, "output/logs/"},
-                                                              {Type::Graphs, "output/graphs/"}};
+                                                              {Type::Graphs, "output/graphs/"},
+                                                              {Type::Cache, "output/cache/"}};
 
 const std::string get(const Type type, const std::string &file)
 {
@@ -203,6 +217,174 @@ void write_temp(const std::vector<uint8_t> &data, const std::string &filename, c
 	write_binary_file(data, path::get(path::Type::Temp) + filename, count);
 }
 
+std::vector<uint8_t> read_cache(const std::string &filename)
+{
+	return read_binary_file(path::get(path::Type::Cache) + filename, 0);
+}
+
+void write_cache(const std::vector<uint8_t> &data, const std::string &filename)
+{
+	write_file_atomic(path::get(path::Type::Cache) + filename, [&data](std::ostream &file) {
+		file.write(reinterpret_cast<const char *>(data.data()), data.size());
+	});
+}
+
+void write_file_atomic(const std::string &filename, const std::function<void(std::ostream &)> &write)
+{
+	// Unique among the threads of this process, and most likely among concurrent processes
+	static std::atomic<uint32_t> temp_file_count{0};
+
+	auto temp_filename = filename + "." + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) +
+	                     "." + std::to_string(temp_file_count++) + ".tmp";
+
+	{
+		std::ofstream file{temp_filename, std::ios::out | std::ios::binary | std::ios::trunc};
+
+		if (!file.is_open())
+		{
+			throw std::runtime_error("Failed to open file: " + temp_filename);
+		}
+
+		write(file);
+
+		file.close();
+
+		if (!file.good())
+		{
+			std::remove(temp_filename.c_str());
+			throw std::runtime_error("Failed to write file: " + temp_filename);
+		}
+	}
+
+#ifdef _WIN32
+	// rename() does not replace an existing file on Windows
+	bool replaced = MoveFileExA(temp_filename.c_str(), filename.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	bool replaced = std::rename(temp_filename.c_str(), filename.c_str()) == 0;
+#endif
+
+	if (!replaced)
+	{
+		std::remove(temp_filename.c_str());
+		throw std::runtime_error("Failed to replace file: " + filename);
+	}
+}
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string &filename)
+{
+	file_handle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+	if (file_handle == INVALID_HANDLE_VALUE)
+	{
+		file_handle = nullptr;
+		throw std::runtime_error("Failed to open file: " + filename);
+	}
+
+	LARGE_INTEGER file_size;
+	GetFileSizeEx(file_handle, &file_size);
+	size = static_cast<size_t>(file_size.QuadPart);
+
+	if (size == 0)
+	{
+		return;
+	}
+
+	mapping_handle = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	if (mapping_handle)
+	{
+		data = static_cast<const uint8_t *>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+	}
+
+	if (!data)
+	{
+		if (mapping_handle)
+		{
+			CloseHandle(mapping_handle);
+		}
+
+		CloseHandle(file_handle);
+		throw std::runtime_error("Failed to map file: " + filename);
+	}
+}
+
+MappedFile::~MappedFile()
+{
+	if (data)
+	{
+		UnmapViewOfFile(data);
+		data = nullptr;
+	}
+
+	if (mapping_handle)
+	{
+		CloseHandle(mapping_handle);
+		mapping_handle = nullptr;
+	}
+
+	if (file_handle)
+	{
+		CloseHandle(file_handle);
+		file_handle = nullptr;
+	}
+}
+#else
+MappedFile::MappedFile(const std::string &filename)
+{
+	int file = open(filename.c_str(), O_RDONLY);
+
+	if (file < 0)
+	{
+		throw std::runtime_error("Failed to open file: " + filename);
+	}
+
+	struct stat info;
+
+	if (fstat(file, &info) != 0)
+	{
+		close(file);
+		throw std::runtime_error("Failed to open file: " + filename);
+	}
+
+	size = static_cast<size_t>(info.st_size);
+
+	if (size > 0)
+	{
+		void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+
+		if (mapping == MAP_FAILED)
+		{
+			close(file);
+			throw std::runtime_error("Failed to map file: " + filename);
+		}
+
+		data = static_cast<const uint8_t *>(mapping);
+	}
+
+	// The mapping stays valid once the file is closed
+	close(file);
+}
+
+MappedFile::~MappedFile()
+{
+	if (data)
+	{
+		munmap(const_cast<uint8_t *>(data), size);
+	}
+}
+#endif
+
+const uint8_t *MappedFile::get_data() const
+{
+	return data;
+}
+
+size_t MappedFile::get_size() const
+{
+	return size;
+}
+
 void write_image(const uint8_t *data, const std::string &filename, const uint32_t width, const uint32_t height, const uint32_t components, const uint32_t row_stride)
 {
 	stbi_write_png((path::get(path::Type::Screenshots) + filename + ".png").c_str(), width, height, components, data, row_stride);
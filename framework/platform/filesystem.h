@@ -20,6 +20,7 @@
 #include <cstdint>
 #include <cstdlib>
 #include <fstream>
+#include <functional>
 #include <string>
 #include <sys/stat.h>
 #include <unordered_map>
@@ -42,6 +43,7 @@ enum Type
 	Screenshots,
 	Logs,
 	Graphs,
+	Cache,
 	/* NewFolder */
 	TotalRelativePathTypes,
 
@@ -136,6 +138,74 @@ std::vector<uint8_t> read_temp(const std::string &filename, const uint32_t count
  */
 void write_temp(const std::vector<uint8_t> &data, const std::string &filename, const uint32_t count = 0);
 
+/**
+ * @brief Helper to read a file from the persistent cache directory into a byte-array
+ *
+ * @param filename The path to the file (relative to the cache directory)
+ * @return A vector filled with data read from the file
+ */
+std::vector<uint8_t> read_cache(const std::string &filename);
+
+/**
+ * @brief Helper to write to a file in the persistent cache directory, see write_file_atomic()
+ *
+ * @param data A vector filled with data to write
+ * @param filename The path to the file (relative to the cache directory)
+ * @throws std::runtime_error if the file cannot be written
+ */
+void write_cache(const std::vector<uint8_t> &data, const std::string &filename);
+
+/**
+ * @brief Writes a file through a temporary file next to it, which replaces the file once it
+ *        has been written completely, so that readers never see a partially written file
+ *        and an interrupted write leaves the previous file in place
+ *
+ * @param filename The full path of the file
+ * @param write Writes the contents of the file to the given stream
+ * @throws std::runtime_error if the file cannot be written
+ */
+void write_file_atomic(const std::string &filename, const std::function<void(std::ostream &)> &write);
+
+/**
+ * @brief A file mapped read only in memory, so that its data is paged in as it is read
+ *        instead of being copied, unmapped when destroyed
+ */
+class MappedFile
+{
+  public:
+	/**
+	 * @brief Maps a whole file in memory
+	 * @param filename The absolute path to the file
+	 * @throws runtime_error if the file cannot be opened or mapped
+	 */
+	MappedFile(const std::string &filename);
+
+	MappedFile(const MappedFile &) = delete;
+
+	MappedFile(MappedFile &&) = delete;
+
+	~MappedFile();
+
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	MappedFile &operator=(MappedFile &&) = delete;
+
+	const uint8_t *get_data() const;
+
+	size_t get_size() const;
+
+  private:
+	const uint8_t *data{nullptr};
+
+	size_t size{0};
+
+#ifdef _WIN32
+	void *file_handle{nullptr};
+
+	void *mapping_handle{nullptr};
+#endif
+};
+
 /**
  * @brief Helper to write to a png image in permanent storage
  *
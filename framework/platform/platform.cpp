@@ -66,6 +66,16 @@ bool Platform::initialize(std::unique_ptr<Application> &&app)
 		active_app->set_benchmark_mode(true);
 	}
 
+	// Render a single frame, which compiles the shaders of the app into the SPIR-V cache,
+	// or bakes the scenes it loads into the cache directory
+	if (active_app->get_options().contains("--prebuild-shaders") || active_app->get_options().contains("--bake-scenes"))
+	{
+		benchmark_mode             = true;
+		total_benchmark_frames     = 1;
+		remaining_benchmark_frames = total_benchmark_frames;
+		active_app->set_benchmark_mode(true);
+	}
+
 	// Set the app as headless
 	active_app->set_headless(active_app->get_options().contains("--headless"));
 
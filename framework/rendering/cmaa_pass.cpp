@@ -0,0 +1,1066 @@
+/* Copyright (c) 2021, Samsung
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cmaa_pass.h"
+
+#include "glsl_compiler.h"
+#include "postprocessing_computepass.h"
+#include "postprocessing_renderpass.h"
+
+namespace vkb
+{
+namespace
+{
+constexpr VkAccessFlags write_access_mask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+/// Workgroups of the apply blends stage, whose invocations stride over the blended pixels
+constexpr uint32_t apply_blends_workgroup_count{64};
+
+/**
+ * @brief Specialization constants of a vkb::CMAAQuality preset
+ */
+struct QualityPreset
+{
+	/// Luma difference above which the detect stage finds an edge
+	float colour_threshold;
+
+	/// How strongly the refine stage removes edges weaker than their neighbours
+	float non_dominant_edge_removal_amount;
+
+	/// Longest line the process stage follows, must be even
+	uint32_t max_line_length;
+};
+
+/// Indexed by vkb::CMAAQuality, High matches the constants the shaders default to
+const std::array<QualityPreset, 4> quality_presets{{{0.15f, 0.30f, 8},
+                                                   {0.10f, 0.20f, 12},
+                                                   {0.08f, 0.15f, 16},
+                                                   {0.05f, 0.10f, 32}}};
+
+/**
+ * @brief Whether the GPU supports the subgroup operations used to aggregate the edge appends in compute shaders
+ */
+bool supports_subgroup_append(const PhysicalDevice &gpu)
+{
+	const VkSubgroupFeatureFlags required_operations = VK_SUBGROUP_FEATURE_BASIC_BIT | VK_SUBGROUP_FEATURE_BALLOT_BIT | VK_SUBGROUP_FEATURE_ARITHMETIC_BIT;
+
+	const auto &subgroup_properties = gpu.get_subgroup_properties();
+
+	return (subgroup_properties.supportedStages & VK_SHADER_STAGE_COMPUTE_BIT) &&
+	       (subgroup_properties.supportedOperations & required_operations) == required_operations;
+}
+
+/**
+ * @brief Adds the subgroup aggregated appends to a shader variant. The subgroup
+ *        extensions need SPIR-V 1.3, which any Vulkan 1.1 device accepts.
+ */
+void add_subgroup_append(ShaderVariant &variant)
+{
+	variant.add_define("CMAA_SUBGROUP_APPEND");
+	variant.set_spirv_version(glslang::EShTargetSpv_1_3);
+}
+
+/**
+ * @brief Builds a shader variant with the defines whose flag is set, in the given order
+ */
+ShaderVariant make_variant(const std::vector<std::pair<const char *, bool>> &defines)
+{
+	ShaderVariant variant;
+	for (auto &define : defines)
+	{
+		if (!define.second)
+		{
+			continue;
+		}
+
+		if (std::string(define.first) == "CMAA_SUBGROUP_APPEND")
+		{
+			add_subgroup_append(variant);
+		}
+		else
+		{
+			variant.add_define(define.first);
+		}
+	}
+	return variant;
+}
+
+/**
+ * @brief Distance in 16x16 pixel tiles up to which a changed tile can affect the output of the given preset
+ */
+uint32_t get_fresh_distance(const QualityPreset &preset)
+{
+	// Lines are followed up to max_line_length pixels, plus one tile as lines do not start on tile boundaries
+	return (preset.max_line_length + 15) / 16 + 1;
+}
+}        // namespace
+
+CMAAPass::CMAAPass(RenderContext &render_context) :
+    render_context{render_context}
+{
+	ShaderSource cmaa_vs("postprocessing/CMAA.vert");
+
+	detect_pipeline = std::make_unique<PostProcessingPipeline>(render_context, cmaa_vs);
+	detect_pipeline->set_timer_stat(StatIndex::gpu_time_cmaa_detect);
+	detect_pipeline->add_pass()
+	    .add_subpass(ShaderSource("postprocessing/CMAA_Edge_Detect.frag"));
+
+	// Compute passes leave the barriers to barrier()
+	detect_compute_pipeline = std::make_unique<PostProcessingPipeline>(render_context, cmaa_vs);
+	detect_compute_pipeline->set_timer_stat(StatIndex::gpu_time_cmaa_detect);
+	detect_compute_pipeline->add_pass<PostProcessingComputePass>(ShaderSource("postprocessing/CMAA_Edge_Detect.comp"))
+	    .set_automatic_barriers(false);
+
+	first_intermediary_pipeline = std::make_unique<PostProcessingPipeline>(render_context, cmaa_vs);
+	first_intermediary_pipeline->set_timer_stat(StatIndex::gpu_time_cmaa_refine);
+	first_intermediary_pipeline->add_pass<PostProcessingComputePass>(ShaderSource("postprocessing/CMAA_Compute_Dispatch1.comp"))
+	    .set_automatic_barriers(false);
+
+	refine_pipeline = std::make_unique<PostProcessingPipeline>(render_context, cmaa_vs);
+	refine_pipeline->set_timer_stat(StatIndex::gpu_time_cmaa_refine);
+	refine_pipeline->add_pass<PostProcessingComputePass>(ShaderSource("postprocessing/CMAA_Edge_Refine.comp"))
+	    .set_automatic_barriers(false);
+
+	combine_pipeline = std::make_unique<PostProcessingPipeline>(render_context, cmaa_vs);
+	combine_pipeline->set_timer_stat(StatIndex::gpu_time_cmaa_combine);
+	combine_pipeline->add_pass<PostProcessingComputePass>(ShaderSource("postprocessing/CMAA_Edge_Combine.comp"))
+	    .set_automatic_barriers(false);
+
+	second_intermediary_pipeline = std::make_unique<PostProcessingPipeline>(render_context, cmaa_vs);
+	second_intermediary_pipeline->set_timer_stat(StatIndex::gpu_time_cmaa_combine);
+	second_intermediary_pipeline->add_pass<PostProcessingComputePass>(ShaderSource("postprocessing/CMAA_Compute_Dispatch2.comp"))
+	    .set_automatic_barriers(false);
+
+	bin_count_pipeline = std::make_unique<PostProcessingPipeline>(render_context, cmaa_vs);
+	bin_count_pipeline->set_timer_stat(StatIndex::gpu_time_cmaa_refine);
+	bin_count_pipeline->add_pass<PostProcessingComputePass>(ShaderSource("postprocessing/CMAA_Bin_Candidates.comp"))
+	    .set_automatic_barriers(false);
+
+	bin_scan_pipeline = std::make_unique<PostProcessingPipeline>(render_context, cmaa_vs);
+	bin_scan_pipeline->set_timer_stat(StatIndex::gpu_time_cmaa_refine);
+	bin_scan_pipeline->add_pass<PostProcessingComputePass>(ShaderSource("postprocessing/CMAA_Bin_Scan.comp"))
+	    .set_automatic_barriers(false);
+
+	bin_scatter_pipeline = std::make_unique<PostProcessingPipeline>(render_context, cmaa_vs);
+	bin_scatter_pipeline->set_timer_stat(StatIndex::gpu_time_cmaa_refine);
+	bin_scatter_pipeline->add_pass<PostProcessingComputePass>(ShaderSource("postprocessing/CMAA_Bin_Candidates.comp"))
+	    .set_automatic_barriers(false)
+	    .get_cs_variant()
+	    .add_define("CMAA_BIN_SCATTER");
+
+	temporal_hash_pipeline = std::make_unique<PostProcessingPipeline>(render_context, cmaa_vs);
+	temporal_hash_pipeline->set_timer_stat(StatIndex::gpu_time_cmaa_detect);
+	temporal_hash_pipeline->add_pass<PostProcessingComputePass>(ShaderSource("postprocessing/CMAA_Temporal_Hash.comp"))
+	    .set_automatic_barriers(false);
+
+	temporal_resolve_pipeline = std::make_unique<PostProcessingPipeline>(render_context, cmaa_vs);
+	temporal_resolve_pipeline->set_timer_stat(StatIndex::gpu_time_cmaa_process);
+	temporal_resolve_pipeline->add_pass<PostProcessingComputePass>(ShaderSource("postprocessing/CMAA_Temporal_Resolve.comp"))
+	    .set_automatic_barriers(false);
+
+	apply_blends_pipeline = std::make_unique<PostProcessingPipeline>(render_context, cmaa_vs);
+	apply_blends_pipeline->set_timer_stat(StatIndex::gpu_time_cmaa_process);
+	apply_blends_pipeline->add_pass<PostProcessingComputePass>(ShaderSource("postprocessing/CMAA_Apply_Blends.comp"))
+	    .set_automatic_barriers(false);
+
+	process_pipeline = std::make_unique<PostProcessingPipeline>(render_context, std::move(cmaa_vs));
+	process_pipeline->set_timer_stat(StatIndex::gpu_time_cmaa_process);
+	process_pipeline->add_pass<PostProcessingComputePass>(ShaderSource("postprocessing/CMAA_Process.comp"))
+	    .set_automatic_barriers(false);
+
+	subgroup_append = supports_subgroup_append(render_context.get_device().get_gpu());
+	if (subgroup_append)
+	{
+		add_subgroup_append(refine_pipeline->get_pass<PostProcessingComputePass>(0).get_cs_variant());
+	}
+
+	LOGI("CMAA edge appends use {}", subgroup_append ? "subgroup operations" : "per invocation atomics");
+}
+
+std::unique_ptr<CMAAPass::FrameResources> CMAAPass::create_frame_resources(const VkExtent2D &extent)
+{
+	auto &device = render_context.get_device();
+
+	auto resources    = std::make_unique<FrameResources>();
+	resources->extent = extent;
+
+	const VkExtent3D half_extent{extent.width / 2, extent.height / 2, 1};
+
+	// Written as a color attachment by the fragment detect pass or as a storage image by the compute one
+	core::Image potential_edge_image{device,
+	                                 half_extent,
+	                                 VK_FORMAT_R8G8B8A8_UNORM,
+	                                 VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+	                                 VMA_MEMORY_USAGE_GPU_ONLY,
+	                                 VK_SAMPLE_COUNT_1_BIT};
+	// The edge images hold the edge bits in the low byte and the generation that wrote them in the high byte
+	core::Image partial_edge_image{device,
+	                               half_extent,
+	                               VK_FORMAT_R16_UINT,
+	                               VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+	                               VMA_MEMORY_USAGE_GPU_ONLY,
+	                               VK_SAMPLE_COUNT_1_BIT};
+	core::Image full_edge_image{device,
+	                            VkExtent3D{extent.width / 2, extent.height, 1},
+	                            VK_FORMAT_R16_UINT,
+	                            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+	                            VMA_MEMORY_USAGE_GPU_ONLY,
+	                            VK_SAMPLE_COUNT_1_BIT};
+	core::Image colour_image{device,
+	                         VkExtent3D{extent.width, extent.height, 1},
+	                         VK_FORMAT_R8G8B8A8_UNORM,
+	                         VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+	                         VMA_MEMORY_USAGE_GPU_ONLY,
+	                         VK_SAMPLE_COUNT_1_BIT};
+
+	auto make_render_target = [](core::Image &&image) {
+		std::vector<core::Image> images;
+		images.push_back(std::move(image));
+		return std::make_unique<RenderTarget>(std::move(images));
+	};
+
+	resources->potential_edge_render_target = make_render_target(std::move(potential_edge_image));
+	resources->partial_edge_render_target   = make_render_target(std::move(partial_edge_image));
+	resources->full_edge_render_target      = make_render_target(std::move(full_edge_image));
+	resources->colour_render_target         = make_render_target(std::move(colour_image));
+
+	VkDeviceSize pos_buffer_size = sizeof(uint32_t) * (extent.width * extent.height / 4);
+	// numCandidates, numEdges and the number of finished workgroups of the compute detect pass
+	VkDeviceSize count_buffer_size    = sizeof(uint32_t) * 3;
+	VkDeviceSize indirect_buffer_size = sizeof(VkDispatchIndirectCommand);
+	// numBlends and the positions of the pixels blended in place, as many as there are pixels.
+	// Only edge pixels are blended, and those past the end would be left as they are in the scene
+	VkDeviceSize blend_pos_buffer_size = sizeof(uint32_t) * (1 + extent.width * extent.height);
+
+	// Candidates are binned into tiles of 8x8 half resolution texels, which are also the
+	// 16x16 pixel tiles of the temporal reuse and the workgroups of the compute detect
+	resources->tile_grid          = {(extent.width + 15) / 16, (extent.height + 15) / 16};
+	VkDeviceSize tile_buffer_size = sizeof(uint32_t) * resources->tile_grid.x * resources->tile_grid.y;
+
+	resources->candidate_pos_buffer = std::make_unique<core::Buffer>(device, pos_buffer_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+	                                                                 VMA_MEMORY_USAGE_GPU_ONLY, VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT);
+	resources->edge_pos_buffer      = std::make_unique<core::Buffer>(device, pos_buffer_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+	                                                                 VMA_MEMORY_USAGE_GPU_ONLY, VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT);
+	resources->count_buffer         = std::make_unique<core::Buffer>(device, count_buffer_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+	                                                                 VMA_MEMORY_USAGE_GPU_ONLY);
+	resources->indirect_buffer      = std::make_unique<core::Buffer>(device, indirect_buffer_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+	                                                                 VMA_MEMORY_USAGE_GPU_ONLY);
+	resources->binned_pos_buffer    = std::make_unique<core::Buffer>(device, pos_buffer_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+	                                                                 VMA_MEMORY_USAGE_GPU_ONLY, VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT);
+	resources->tile_count_buffer    = std::make_unique<core::Buffer>(device, tile_buffer_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+	                                                                 VMA_MEMORY_USAGE_GPU_ONLY);
+	resources->tile_offset_buffer   = std::make_unique<core::Buffer>(device, tile_buffer_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+	                                                                 VMA_MEMORY_USAGE_GPU_ONLY);
+	resources->tile_change_buffer   = std::make_unique<core::Buffer>(device, tile_buffer_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+	                                                                 VMA_MEMORY_USAGE_GPU_ONLY);
+	resources->tile_fresh_buffer    = std::make_unique<core::Buffer>(device, tile_buffer_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+	                                                                 VMA_MEMORY_USAGE_GPU_ONLY);
+	resources->blend_pos_buffer     = std::make_unique<core::Buffer>(device, blend_pos_buffer_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+	                                                                 VMA_MEMORY_USAGE_GPU_ONLY, VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT);
+
+	resources->candidate_pos_alloc = std::make_unique<BufferAllocation>(*resources->candidate_pos_buffer, pos_buffer_size, 0);
+	resources->edge_pos_alloc      = std::make_unique<BufferAllocation>(*resources->edge_pos_buffer, pos_buffer_size, 0);
+	resources->count_alloc         = std::make_unique<BufferAllocation>(*resources->count_buffer, count_buffer_size, 0);
+	resources->indirect_alloc      = std::make_unique<BufferAllocation>(*resources->indirect_buffer, indirect_buffer_size, 0);
+	resources->binned_pos_alloc    = std::make_unique<BufferAllocation>(*resources->binned_pos_buffer, pos_buffer_size, 0);
+	resources->tile_count_alloc    = std::make_unique<BufferAllocation>(*resources->tile_count_buffer, tile_buffer_size, 0);
+	resources->tile_offset_alloc   = std::make_unique<BufferAllocation>(*resources->tile_offset_buffer, tile_buffer_size, 0);
+	resources->tile_change_alloc   = std::make_unique<BufferAllocation>(*resources->tile_change_buffer, tile_buffer_size, 0);
+	resources->tile_fresh_alloc    = std::make_unique<BufferAllocation>(*resources->tile_fresh_buffer, tile_buffer_size, 0);
+	resources->blend_pos_alloc     = std::make_unique<BufferAllocation>(*resources->blend_pos_buffer, blend_pos_buffer_size, 0);
+
+	return resources;
+}
+
+std::unique_ptr<CMAAPass::HistoryResources> CMAAPass::create_history_resources(const VkExtent2D &extent)
+{
+	auto &device = render_context.get_device();
+
+	auto resources    = std::make_unique<HistoryResources>();
+	resources->extent = extent;
+
+	core::Image history_image{device,
+	                          VkExtent3D{extent.width, extent.height, 1},
+	                          VK_FORMAT_R8G8B8A8_UNORM,
+	                          VK_IMAGE_USAGE_STORAGE_BIT,
+	                          VMA_MEMORY_USAGE_GPU_ONLY,
+	                          VK_SAMPLE_COUNT_1_BIT};
+
+	std::vector<core::Image> images;
+	images.push_back(std::move(history_image));
+	resources->history_render_target = std::make_unique<RenderTarget>(std::move(images));
+
+	VkDeviceSize tile_hash_size = sizeof(uint32_t) * ((extent.width + 15) / 16) * ((extent.height + 15) / 16);
+
+	resources->tile_hash_buffer = std::make_unique<core::Buffer>(device, tile_hash_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+	                                                             VMA_MEMORY_USAGE_GPU_ONLY);
+	resources->tile_hash_alloc  = std::make_unique<BufferAllocation>(*resources->tile_hash_buffer, tile_hash_size, 0);
+
+	return resources;
+}
+
+const BufferAllocation &CMAAPass::get_buffer(Resource resource) const
+{
+	switch (resource)
+	{
+		case CountBuffer:
+			return *frame->count_alloc;
+		case CandidatePosBuffer:
+			return *frame->candidate_pos_alloc;
+		case EdgePosBuffer:
+			return *frame->edge_pos_alloc;
+		case BinnedPosBuffer:
+			return *frame->binned_pos_alloc;
+		case TileCountBuffer:
+			return *frame->tile_count_alloc;
+		case TileOffsetBuffer:
+			return *frame->tile_offset_alloc;
+		case TileChangeBuffer:
+			return *frame->tile_change_alloc;
+		case TileFreshBuffer:
+			return *frame->tile_fresh_alloc;
+		case TileHashBuffer:
+			return *history->tile_hash_alloc;
+		case IndirectBuffer:
+			return *frame->indirect_alloc;
+		case BlendPosBuffer:
+			return *frame->blend_pos_alloc;
+		default:
+			throw std::runtime_error("CMAA resource is not a buffer");
+	}
+}
+
+RenderTarget &CMAAPass::get_image_target(Resource resource) const
+{
+	switch (resource)
+	{
+		case PotentialEdgeImage:
+			return *frame->potential_edge_render_target;
+		case PartialEdgeImage:
+			return *frame->partial_edge_render_target;
+		case FullEdgeImage:
+			return *frame->full_edge_render_target;
+		case ColourImage:
+			return *frame->colour_render_target;
+		case HistoryImage:
+			return *history->history_render_target;
+		case SceneImage:
+		case LumaImage:
+			return *scene_render_target;
+		default:
+			throw std::runtime_error("CMAA resource is not an image");
+	}
+}
+
+uint32_t CMAAPass::get_image_attachment(Resource resource) const
+{
+	switch (resource)
+	{
+		case SceneImage:
+			return scene_attachment;
+		case LumaImage:
+			return scene_luma_attachment;
+		default:
+			return 0;
+	}
+}
+
+CMAAPass::Resource CMAAPass::get_output() const
+{
+	return in_place ? SceneImage : ColourImage;
+}
+
+void CMAAPass::barrier(CommandBuffer &command_buffer, const std::vector<Access> &accesses)
+{
+	VkPipelineStageFlags src_stage_mask = 0;
+	VkPipelineStageFlags dst_stage_mask = 0;
+
+	std::vector<VkBufferMemoryBarrier> buffer_barriers;
+	std::vector<VkImageMemoryBarrier>  image_barriers;
+
+	// Whether each access needed a dependency, states are updated once all barriers are known
+	std::vector<bool> synchronized(accesses.size(), false);
+
+	for (size_t i = 0; i < accesses.size(); i++)
+	{
+		const auto &access = accesses[i];
+		const auto &state  = resource_states[access.resource];
+
+		const bool is_image = access.resource >= PotentialEdgeImage;
+		const bool writes   = (access.access_mask & write_access_mask) != 0;
+
+		VkImageLayout old_layout    = VK_IMAGE_LAYOUT_UNDEFINED;
+		bool          layout_change = false;
+		if (is_image)
+		{
+			old_layout    = get_image_target(access.resource).get_layout(get_image_attachment(access.resource));
+			layout_change = old_layout != access.layout;
+		}
+
+		VkPipelineStageFlags src_stages = 0;
+		VkAccessFlags        src_access = 0;
+
+		// Read or write after write, unless a previous barrier already made the write visible to this access
+		const bool visible = (access.stage_mask & ~state.visible_stages) == 0 && (access.access_mask & ~state.visible_access) == 0;
+		if (state.write_stages != 0 && (!visible || layout_change))
+		{
+			src_stages |= state.write_stages;
+			src_access |= state.write_access;
+		}
+
+		// Write after read (and layout transitions, which are writes) only need an execution dependency
+		if (writes || layout_change)
+		{
+			src_stages |= state.read_stages;
+		}
+
+		if (src_stages == 0 && !layout_change)
+		{
+			// No hazard
+			continue;
+		}
+
+		if (src_stages == 0)
+		{
+			src_stages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		}
+
+		if (is_image)
+		{
+			auto &      render_target = get_image_target(access.resource);
+			const auto &view          = render_target.get_views().at(get_image_attachment(access.resource));
+
+			VkImageMemoryBarrier image_barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+			image_barrier.oldLayout        = access.discard ? VK_IMAGE_LAYOUT_UNDEFINED : old_layout;
+			image_barrier.newLayout        = access.layout;
+			image_barrier.image            = view.get_image().get_handle();
+			image_barrier.subresourceRange = view.get_subresource_range();
+			image_barrier.srcAccessMask    = src_access;
+			image_barrier.dstAccessMask    = access.access_mask;
+			image_barriers.push_back(image_barrier);
+
+			render_target.set_layout(get_image_attachment(access.resource), access.layout);
+		}
+		else if (src_access != 0)
+		{
+			const auto &alloc = get_buffer(access.resource);
+
+			VkBufferMemoryBarrier buffer_barrier{VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER};
+			buffer_barrier.srcAccessMask = src_access;
+			buffer_barrier.dstAccessMask = access.access_mask;
+			buffer_barrier.buffer        = const_cast<BufferAllocation &>(alloc).get_buffer().get_handle();
+			buffer_barrier.offset        = alloc.get_offset();
+			buffer_barrier.size          = alloc.get_size();
+			buffer_barriers.push_back(buffer_barrier);
+		}
+
+		src_stage_mask |= src_stages;
+		dst_stage_mask |= access.stage_mask;
+		synchronized[i] = true;
+	}
+
+	if (src_stage_mask != 0)
+	{
+		command_buffer.pipeline_barrier(src_stage_mask, dst_stage_mask, buffer_barriers, image_barriers);
+	}
+
+	for (size_t i = 0; i < accesses.size(); i++)
+	{
+		const auto &access = accesses[i];
+		auto &      state  = resource_states[access.resource];
+
+		if (synchronized[i])
+		{
+			state.visible_stages |= access.stage_mask;
+			state.visible_access |= access.access_mask;
+		}
+
+		if (access.access_mask & write_access_mask)
+		{
+			state.write_stages   = access.stage_mask;
+			state.write_access   = access.access_mask & write_access_mask;
+			state.read_stages    = 0;
+			state.visible_stages = 0;
+			state.visible_access = 0;
+		}
+		else
+		{
+			state.read_stages |= access.stage_mask;
+		}
+	}
+}
+
+void CMAAPass::reset_edge_images(CommandBuffer &command_buffer)
+{
+	std::vector<Access> accesses{
+	    {PartialEdgeImage, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, true},
+	    {FullEdgeImage, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, true}};
+
+	if (!frame->counters_initialised)
+	{
+		accesses.push_back({CountBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT});
+		accesses.push_back({TileCountBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT});
+	}
+
+	barrier(command_buffer, accesses);
+
+	VkClearColorValue clear_colour = {0, 0, 0, 0};
+	command_buffer.clear_image(frame->partial_edge_render_target->get_views()[0].get_image(), clear_colour);
+	command_buffer.clear_image(frame->full_edge_render_target->get_views()[0].get_image(), clear_colour);
+
+	if (!frame->counters_initialised)
+	{
+		// Counters are reset by the shaders for the next frame, they only need zeroing once
+		command_buffer.update_buffer(frame->count_alloc->get_buffer(), frame->count_alloc->get_offset(), std::vector<uint8_t>(frame->count_alloc->get_size(), 0));
+		command_buffer.fill_buffer(frame->tile_count_alloc->get_buffer(), frame->tile_count_alloc->get_offset(), frame->tile_count_alloc->get_size(), 0);
+		frame->counters_initialised = true;
+	}
+}
+
+void CMAAPass::hash_tiles(CommandBuffer &command_buffer)
+{
+	barrier(command_buffer, {{SceneImage, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+	                         {TileHashBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT},
+	                         {TileChangeBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT}});
+
+	// Without a valid history every tile is flagged as changed, which also fills the history
+	const glm::tvec2<uint32_t> push_constants{frame->tile_grid.x, history->valid ? 1u : 0u};
+	temporal_hash_pipeline->get_pass<PostProcessingComputePass>(0)
+	    .set_dispatch_size({frame->tile_grid.x, frame->tile_grid.y, 1})
+	    .bind_sampled_image("inputSceneTexture", core::SampledImage(scene_attachment, scene_render_target))
+	    .bind_storage_buffer("tileHashBuffer", *history->tile_hash_alloc)
+	    .bind_storage_buffer("tileChangeBuffer", *frame->tile_change_alloc)
+	    .set_push_constants(push_constants);
+	temporal_hash_pipeline->draw(command_buffer, *frame->potential_edge_render_target);
+}
+
+void CMAAPass::detect(CommandBuffer &command_buffer)
+{
+	const VkPipelineStageFlags stage = compute_detect ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+	std::vector<Access> accesses{
+	    {SceneImage, stage, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+	    {CountBuffer, stage, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT},
+	    {CandidatePosBuffer, stage, VK_ACCESS_SHADER_WRITE_BIT}};
+
+	if (!in_place)
+	{
+		accesses.push_back({ColourImage, stage, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, true});
+	}
+
+	const bool luma_input = scene_luma_attachment != VK_ATTACHMENT_UNUSED;
+	if (luma_input)
+	{
+		accesses.push_back({LumaImage, stage, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL});
+	}
+
+	if (compute_detect)
+	{
+		accesses.push_back({PotentialEdgeImage, stage, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, true});
+		accesses.push_back({IndirectBuffer, stage, VK_ACCESS_SHADER_WRITE_BIT});
+		if (temporal_active)
+		{
+			accesses.push_back({TileChangeBuffer, stage, VK_ACCESS_SHADER_READ_BIT});
+			accesses.push_back({TileFreshBuffer, stage, VK_ACCESS_SHADER_WRITE_BIT});
+		}
+		barrier(command_buffer, accesses);
+
+		auto &detect_pass = detect_compute_pipeline->get_pass<PostProcessingComputePass>(0);
+		detect_pass.get_cs_variant().clear();
+		if (in_place)
+		{
+			detect_pass.get_cs_variant().add_define("CMAA_IN_PLACE");
+		}
+		if (luma_input)
+		{
+			detect_pass.get_cs_variant().add_define("CMAA_LUMA_INPUT");
+			detect_pass.bind_sampled_image("inputLumaTexture", core::SampledImage(scene_luma_attachment, scene_render_target));
+		}
+		if (shared_luma_active)
+		{
+			detect_pass.get_cs_variant().add_define("CMAA_SHARED_LUMA");
+		}
+		if (temporal_active)
+		{
+			const glm::tvec3<uint32_t> push_constants{frame->tile_grid, get_fresh_distance(quality_presets[static_cast<uint32_t>(quality)])};
+			detect_pass.get_cs_variant().add_define("CMAA_TEMPORAL");
+			detect_pass
+			    .bind_storage_buffer("tileChangeBuffer", *frame->tile_change_alloc)
+			    .bind_storage_buffer("tileFreshBuffer", *frame->tile_fresh_alloc)
+			    .set_push_constants(push_constants);
+		}
+
+		// One invocation per 2x2 block, in 8x8 workgroups covering a tile each
+		detect_pass
+		    .set_specialization_constant(0, quality_presets[static_cast<uint32_t>(quality)].colour_threshold)
+		    .set_dispatch_size({frame->tile_grid.x, frame->tile_grid.y, 1})
+		    .bind_sampled_image("inputSceneTexture", core::SampledImage(scene_attachment, scene_render_target))
+		    .bind_storage_image("outputSceneImage", core::SampledImage(0, frame->colour_render_target.get()))
+		    .bind_storage_image("candidateImage", core::SampledImage(0, frame->potential_edge_render_target.get()))
+		    .bind_storage_buffer("threadCountBuffer", *frame->count_alloc)
+		    .bind_storage_buffer("candidatePosBuffer", *frame->candidate_pos_alloc)
+		    .bind_storage_buffer("indirectBuffer", *frame->indirect_alloc);
+		detect_compute_pipeline->draw(command_buffer, *frame->potential_edge_render_target);
+
+		// The detect shader writes the indirect arguments of the refine stage itself
+		return;
+	}
+
+	accesses.push_back({PotentialEdgeImage, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true});
+	barrier(command_buffer, accesses);
+
+	auto &detect_subpass = detect_pipeline->get_pass(0).get_subpass(0);
+	detect_subpass.get_fs_variant().clear();
+	if (in_place)
+	{
+		detect_subpass.get_fs_variant().add_define("CMAA_IN_PLACE");
+	}
+	else
+	{
+		detect_subpass.bind_storage_image("outputSceneImage", core::SampledImage(0, frame->colour_render_target.get()));
+	}
+	if (luma_input)
+	{
+		detect_subpass.get_fs_variant().add_define("CMAA_LUMA_INPUT");
+		detect_subpass.bind_sampled_image("inputLumaTexture", core::SampledImage(scene_luma_attachment, scene_render_target));
+	}
+	detect_subpass
+	    .set_specialization_constant(0, quality_presets[static_cast<uint32_t>(quality)].colour_threshold)
+	    .bind_sampled_image("inputSceneTexture", core::SampledImage(scene_attachment, scene_render_target))
+	    .bind_storage_buffer("threadCountBuffer", *frame->count_alloc)
+	    .bind_storage_buffer("candidatePosBuffer", *frame->candidate_pos_alloc);
+	detect_pipeline->draw(command_buffer, *frame->potential_edge_render_target);
+	command_buffer.end_render_pass();
+
+	barrier(command_buffer, {{CountBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT},
+	                         {IndirectBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT}});
+
+	first_intermediary_pipeline->get_pass<PostProcessingComputePass>(0)
+	    .bind_storage_buffer("threadCountBuffer", *frame->count_alloc)
+	    .bind_storage_buffer("indirectBuffer", *frame->indirect_alloc);
+	first_intermediary_pipeline->draw(command_buffer, *frame->potential_edge_render_target);
+}
+
+void CMAAPass::bin_candidates(CommandBuffer &command_buffer)
+{
+	const Resource binned_list = candidate_list == CandidatePosBuffer ? BinnedPosBuffer : CandidatePosBuffer;
+
+	// Count the candidates of each tile
+	barrier(command_buffer, {{IndirectBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT},
+	                         {CountBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT},
+	                         {candidate_list, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT},
+	                         {TileCountBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT}});
+
+	bin_count_pipeline->get_pass<PostProcessingComputePass>(0)
+	    .set_dispatch_size(frame->indirect_alloc.get())
+	    .bind_storage_buffer("threadCountBuffer", *frame->count_alloc)
+	    .bind_storage_buffer("candidatePosBuffer", get_buffer(candidate_list))
+	    .bind_storage_buffer("tileCountBuffer", *frame->tile_count_alloc)
+	    .set_push_constants(frame->tile_grid);
+	bin_count_pipeline->draw(command_buffer, *frame->potential_edge_render_target);
+
+	// Turn the counts into the offsets of each tile in the binned list
+	barrier(command_buffer, {{TileCountBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT},
+	                         {TileOffsetBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT}});
+
+	bin_scan_pipeline->get_pass<PostProcessingComputePass>(0)
+	    .bind_storage_buffer("tileCountBuffer", *frame->tile_count_alloc)
+	    .bind_storage_buffer("tileOffsetBuffer", *frame->tile_offset_alloc)
+	    .set_push_constants(frame->tile_grid);
+	bin_scan_pipeline->draw(command_buffer, *frame->potential_edge_render_target);
+
+	// Scatter the candidates to their tiles
+	barrier(command_buffer, {{IndirectBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT},
+	                         {CountBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT},
+	                         {candidate_list, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT},
+	                         {TileOffsetBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT},
+	                         {binned_list, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT}});
+
+	bin_scatter_pipeline->get_pass<PostProcessingComputePass>(0)
+	    .set_dispatch_size(frame->indirect_alloc.get())
+	    .bind_storage_buffer("threadCountBuffer", *frame->count_alloc)
+	    .bind_storage_buffer("candidatePosBuffer", get_buffer(candidate_list))
+	    .bind_storage_buffer("tileOffsetBuffer", *frame->tile_offset_alloc)
+	    .bind_storage_buffer("binnedPosBuffer", get_buffer(binned_list))
+	    .set_push_constants(frame->tile_grid);
+	bin_scatter_pipeline->draw(command_buffer, *frame->potential_edge_render_target);
+
+	candidate_list = binned_list;
+}
+
+void CMAAPass::refine(CommandBuffer &command_buffer)
+{
+	barrier(command_buffer, {{IndirectBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT},
+	                         {PotentialEdgeImage, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+	                         {PartialEdgeImage, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL},
+	                         {CountBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT},
+	                         {candidate_list, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT}});
+
+	refine_pipeline->get_pass<PostProcessingComputePass>(0)
+	    .set_specialization_constant(0, quality_presets[static_cast<uint32_t>(quality)].non_dominant_edge_removal_amount)
+	    .set_dispatch_size(frame->indirect_alloc.get())
+	    .bind_sampled_image("candidateTexture", core::SampledImage(0, frame->potential_edge_render_target.get()))
+	    .bind_storage_image("partialEdgeImage", core::SampledImage(0, frame->partial_edge_render_target.get()))
+	    .bind_storage_buffer("threadCountBuffer", *frame->count_alloc)
+	    .bind_storage_buffer("candidatePosBuffer", get_buffer(candidate_list))
+	    .set_push_constants(frame->edge_generation);
+	refine_pipeline->draw(command_buffer, *frame->potential_edge_render_target);
+
+	// Refine appends the missing neighbours to the candidates, dispatch them all in the combine stage
+	barrier(command_buffer, {{CountBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT},
+	                         {IndirectBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT}});
+
+	first_intermediary_pipeline->get_pass<PostProcessingComputePass>(0)
+	    .bind_storage_buffer("threadCountBuffer", *frame->count_alloc)
+	    .bind_storage_buffer("indirectBuffer", *frame->indirect_alloc);
+	first_intermediary_pipeline->draw(command_buffer, *frame->potential_edge_render_target);
+}
+
+void CMAAPass::combine(CommandBuffer &command_buffer)
+{
+	std::vector<Access> accesses{
+	    {IndirectBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT},
+	    {PartialEdgeImage, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+	    {FullEdgeImage, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL},
+	    {CountBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT},
+	    {candidate_list, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT},
+	    {EdgePosBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT},
+	    {SceneImage, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL}};
+
+	if (in_place)
+	{
+		// The colour image only stages the blended pixels, which are listed from the start
+		barrier(command_buffer, {{BlendPosBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT}});
+		command_buffer.fill_buffer(frame->blend_pos_alloc->get_buffer(), frame->blend_pos_alloc->get_offset(), sizeof(uint32_t), 0);
+
+		accesses.push_back({ColourImage, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, true});
+		accesses.push_back({BlendPosBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT});
+	}
+	else
+	{
+		accesses.push_back({ColourImage, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL});
+	}
+
+	if (temporal_active)
+	{
+		accesses.push_back({TileFreshBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT});
+	}
+
+	barrier(command_buffer, accesses);
+
+	auto &combine_pass = combine_pipeline->get_pass<PostProcessingComputePass>(0);
+	combine_pass.get_cs_variant().clear();
+	if (in_place)
+	{
+		combine_pass.get_cs_variant().add_define("CMAA_IN_PLACE");
+		combine_pass.bind_storage_buffer("blendPosBuffer", *frame->blend_pos_alloc);
+	}
+	if (subgroup_append)
+	{
+		add_subgroup_append(combine_pass.get_cs_variant());
+	}
+	if (temporal_active)
+	{
+		// Only the fresh tiles are written
+		combine_pass.get_cs_variant().add_define("CMAA_TEMPORAL");
+		combine_pass
+		    .bind_storage_buffer("tileFreshBuffer", *frame->tile_fresh_alloc)
+		    .set_push_constants(glm::tvec2<uint32_t>{frame->edge_generation, frame->tile_grid.x});
+	}
+	else
+	{
+		combine_pass.set_push_constants(frame->edge_generation);
+	}
+
+	combine_pass
+	    .set_dispatch_size(frame->indirect_alloc.get())
+	    .bind_sampled_image("partialEdgeTexture", core::SampledImage(0, frame->partial_edge_render_target.get()))
+	    .bind_sampled_image("inputSceneTexture", core::SampledImage(scene_attachment, scene_render_target))
+	    .bind_storage_image("fullEdgeImage", core::SampledImage(0, frame->full_edge_render_target.get()))
+	    .bind_storage_image("outputSceneImage", core::SampledImage(0, frame->colour_render_target.get()))
+	    .bind_storage_buffer("threadCountBuffer", *frame->count_alloc)
+	    .bind_storage_buffer("candidatePosBuffer", get_buffer(candidate_list))
+	    .bind_storage_buffer("edgePosBuffer", *frame->edge_pos_alloc);
+	combine_pipeline->draw(command_buffer, *frame->potential_edge_render_target);
+
+	barrier(command_buffer, {{CountBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT},
+	                         {IndirectBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT}});
+
+	second_intermediary_pipeline->get_pass<PostProcessingComputePass>(0)
+	    .bind_storage_buffer("threadCountBuffer", *frame->count_alloc)
+	    .bind_storage_buffer("indirectBuffer", *frame->indirect_alloc);
+	second_intermediary_pipeline->draw(command_buffer, *frame->potential_edge_render_target);
+}
+
+void CMAAPass::process(CommandBuffer &command_buffer)
+{
+	std::vector<Access> accesses{
+	    {IndirectBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT},
+	    {FullEdgeImage, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+	    {CountBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT},
+	    {EdgePosBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT},
+	    {SceneImage, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+	    {ColourImage, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL}};
+
+	if (in_place)
+	{
+		accesses.push_back({BlendPosBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT});
+	}
+
+	if (temporal_active)
+	{
+		accesses.push_back({TileFreshBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT});
+	}
+
+	barrier(command_buffer, accesses);
+
+	auto &process_pass = process_pipeline->get_pass<PostProcessingComputePass>(0);
+	process_pass.get_cs_variant().clear();
+	if (in_place)
+	{
+		process_pass.get_cs_variant().add_define("CMAA_IN_PLACE");
+		process_pass.bind_storage_buffer("blendPosBuffer", *frame->blend_pos_alloc);
+	}
+	if (temporal_active)
+	{
+		process_pass.get_cs_variant().add_define("CMAA_TEMPORAL");
+		process_pass
+		    .bind_storage_buffer("tileFreshBuffer", *frame->tile_fresh_alloc)
+		    .set_push_constants(glm::tvec2<uint32_t>{frame->edge_generation, frame->tile_grid.x});
+	}
+	else
+	{
+		process_pass.set_push_constants(frame->edge_generation);
+	}
+
+	glm::vec2 inv_screen = 1.f / glm::vec2(frame->extent.width, frame->extent.height);
+	process_pass
+	    .set_specialization_constant(0, quality_presets[static_cast<uint32_t>(quality)].max_line_length)
+	    .set_dispatch_size(frame->indirect_alloc.get())
+	    .bind_sampled_image("fullEdgeTexture", core::SampledImage(0, frame->full_edge_render_target.get()))
+	    .bind_sampled_image("inputSceneTexture", core::SampledImage(scene_attachment, scene_render_target))
+	    .bind_storage_image("outputSceneImage", core::SampledImage(0, frame->colour_render_target.get()))
+	    .bind_storage_buffer("threadCountBuffer", *frame->count_alloc)
+	    .bind_storage_buffer("edgePosBuffer", *frame->edge_pos_alloc)
+	    .set_uniform_data(inv_screen);
+	process_pipeline->draw(command_buffer, *frame->potential_edge_render_target);
+}
+
+void CMAAPass::apply_blends(CommandBuffer &command_buffer)
+{
+	barrier(command_buffer, {{BlendPosBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT},
+	                         {ColourImage, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL},
+	                         {SceneImage, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL}});
+
+	apply_blends_pipeline->get_pass<PostProcessingComputePass>(0)
+	    .set_dispatch_size({apply_blends_workgroup_count, 1, 1})
+	    .bind_storage_image("stagedSceneImage", core::SampledImage(0, frame->colour_render_target.get()))
+	    .bind_storage_image("outputSceneImage", core::SampledImage(scene_attachment, scene_render_target))
+	    .bind_storage_buffer("blendPosBuffer", *frame->blend_pos_alloc);
+	apply_blends_pipeline->draw(command_buffer, *frame->potential_edge_render_target);
+}
+
+void CMAAPass::resolve_history(CommandBuffer &command_buffer)
+{
+	const Resource output = get_output();
+
+	// Without a valid history every tile is fresh and overwrites it entirely
+	barrier(command_buffer, {{TileFreshBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT},
+	                         {output, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL},
+	                         {HistoryImage, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, !history->valid}});
+
+	temporal_resolve_pipeline->get_pass<PostProcessingComputePass>(0)
+	    .set_dispatch_size({frame->tile_grid.x, frame->tile_grid.y, 1})
+	    .bind_storage_buffer("tileFreshBuffer", *frame->tile_fresh_alloc)
+	    .bind_storage_image("outputSceneImage", core::SampledImage(get_image_attachment(output), &get_image_target(output)))
+	    .bind_storage_image("historyImage", core::SampledImage(0, history->history_render_target.get()))
+	    .set_push_constants(frame->tile_grid.x);
+	temporal_resolve_pipeline->draw(command_buffer, *frame->potential_edge_render_target);
+
+	history->valid = true;
+}
+
+void CMAAPass::prebuild_shader_variants()
+{
+	auto &resource_cache = render_context.get_device().get_resource_cache();
+
+	auto request = [&resource_cache](VkShaderStageFlagBits stage, const std::string &filename, const ShaderVariant &variant) {
+		resource_cache.request_shader_module(stage, ShaderSource(filename), variant);
+	};
+
+	// The defines are added in the same order as the stages do
+	for (bool in_place : {false, true})
+	{
+		for (bool luma_input : {false, true})
+		{
+			request(VK_SHADER_STAGE_FRAGMENT_BIT, "postprocessing/CMAA_Edge_Detect.frag", make_variant({{"CMAA_IN_PLACE", in_place}, {"CMAA_LUMA_INPUT", luma_input}}));
+		}
+
+		for (bool temporal : {false, true})
+		{
+			for (bool luma_input : {false, true})
+			{
+				for (bool shared_luma : {false, true})
+				{
+					request(VK_SHADER_STAGE_COMPUTE_BIT, "postprocessing/CMAA_Edge_Detect.comp",
+					        make_variant({{"CMAA_IN_PLACE", in_place}, {"CMAA_LUMA_INPUT", luma_input}, {"CMAA_SHARED_LUMA", shared_luma}, {"CMAA_TEMPORAL", temporal}}));
+				}
+			}
+
+			request(VK_SHADER_STAGE_COMPUTE_BIT, "postprocessing/CMAA_Edge_Combine.comp",
+			        make_variant({{"CMAA_IN_PLACE", in_place}, {"CMAA_SUBGROUP_APPEND", subgroup_append}, {"CMAA_TEMPORAL", temporal}}));
+			request(VK_SHADER_STAGE_COMPUTE_BIT, "postprocessing/CMAA_Process.comp",
+			        make_variant({{"CMAA_IN_PLACE", in_place}, {"CMAA_TEMPORAL", temporal}}));
+		}
+	}
+
+	request(VK_SHADER_STAGE_VERTEX_BIT, "postprocessing/CMAA.vert", {});
+	request(VK_SHADER_STAGE_COMPUTE_BIT, "postprocessing/CMAA_Edge_Refine.comp", make_variant({{"CMAA_SUBGROUP_APPEND", subgroup_append}}));
+	request(VK_SHADER_STAGE_COMPUTE_BIT, "postprocessing/CMAA_Compute_Dispatch1.comp", {});
+	request(VK_SHADER_STAGE_COMPUTE_BIT, "postprocessing/CMAA_Compute_Dispatch2.comp", {});
+	request(VK_SHADER_STAGE_COMPUTE_BIT, "postprocessing/CMAA_Bin_Candidates.comp", {});
+	request(VK_SHADER_STAGE_COMPUTE_BIT, "postprocessing/CMAA_Bin_Candidates.comp", make_variant({{"CMAA_BIN_SCATTER", true}}));
+	request(VK_SHADER_STAGE_COMPUTE_BIT, "postprocessing/CMAA_Bin_Scan.comp", {});
+	request(VK_SHADER_STAGE_COMPUTE_BIT, "postprocessing/CMAA_Temporal_Hash.comp", {});
+	request(VK_SHADER_STAGE_COMPUTE_BIT, "postprocessing/CMAA_Temporal_Resolve.comp", {});
+	request(VK_SHADER_STAGE_COMPUTE_BIT, "postprocessing/CMAA_Apply_Blends.comp", {});
+}
+
+core::SampledImage CMAAPass::draw(CommandBuffer &command_buffer, RenderTarget &render_target, uint32_t attachment, uint32_t luma_attachment)
+{
+	// Each frame in flight uses its own scratch resources, so frames do not wait on each other
+	const uint32_t frame_index = render_context.get_active_frame_index();
+	if (frame_resources.size() != render_context.get_render_frames().size())
+	{
+		frame_resources.resize(render_context.get_render_frames().size());
+	}
+
+	auto &      resources    = frame_resources.at(frame_index);
+	const auto &scene_extent = render_target.get_extent();
+	if (!resources || resources->extent.width != scene_extent.width || resources->extent.height != scene_extent.height)
+	{
+		resources = create_frame_resources(scene_extent);
+	}
+
+	frame                 = resources.get();
+	scene_render_target   = &render_target;
+	scene_attachment      = attachment;
+	scene_luma_attachment = luma_attachment;
+
+	// The fence of the active frame has been waited on, so previous accesses to
+	// its scratch resources are complete and only their layouts are relevant.
+	// The history is shared by all frames and keeps its states to synchronize with the previous ones.
+	for (size_t i = 0; i < resource_states.size(); i++)
+	{
+		if (i != TileHashBuffer && i != HistoryImage)
+		{
+			resource_states[i] = {};
+		}
+	}
+
+	temporal_active    = temporal && compute_detect;
+	shared_luma_active = shared_luma && compute_detect;
+	if (temporal_active)
+	{
+		if (!history || history->extent.width != scene_extent.width || history->extent.height != scene_extent.height)
+		{
+			if (history)
+			{
+				// Previous frames may still access the old history
+				render_context.get_device().wait_idle();
+			}
+
+			history                         = create_history_resources(scene_extent);
+			resource_states[TileHashBuffer] = {};
+			resource_states[HistoryImage]   = {};
+		}
+
+		// The output of other settings cannot be reused
+		if (history->quality != quality || history->in_place != in_place)
+		{
+			history->valid    = false;
+			history->quality  = quality;
+			history->in_place = in_place;
+		}
+	}
+	else if (history)
+	{
+		// Frames rendered without temporal reuse are not in the history
+		history->valid = false;
+	}
+
+	// The scene image has just been rendered to
+	resource_states[SceneImage].write_stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	resource_states[SceneImage].write_access = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	resource_states[LumaImage].write_stages  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	resource_states[LumaImage].write_access  = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+	// Edge texels tagged with an older generation read as empty, so the edge images
+	// only need clearing when the set is new or the generation tag wraps around
+	frame->edge_generation = frame->edge_generation % 255 + 1;
+	if (frame->edge_generation == 1)
+	{
+		reset_edge_images(command_buffer);
+	}
+
+	if (temporal_active)
+	{
+		hash_tiles(command_buffer);
+	}
+
+	/// First CMAA stage
+	detect(command_buffer);
+
+	// The compute detect appends its candidates per 8x8 workgroup, so they are already binned
+	candidate_list = CandidatePosBuffer;
+	if (tile_binning && !compute_detect)
+	{
+		bin_candidates(command_buffer);
+	}
+
+	/// Second CMAA stage
+	refine(command_buffer);
+
+	// Refine appends the missing neighbours at the end of the list
+	if (tile_binning)
+	{
+		bin_candidates(command_buffer);
+	}
+
+	/// Third CMAA stage
+	combine(command_buffer);
+
+	/// Fourth CMAA stage
+	process(command_buffer);
+
+	if (in_place)
+	{
+		apply_blends(command_buffer);
+	}
+
+	if (temporal_active)
+	{
+		resolve_history(command_buffer);
+	}
+
+	// The anti-aliased image is sampled by the caller
+	const Resource output = get_output();
+	barrier(command_buffer, {{output, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL}});
+
+	return core::SampledImage(get_image_attachment(output), &get_image_target(output));
+}
+}        // namespace vkb
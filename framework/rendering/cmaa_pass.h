@@ -0,0 +1,455 @@
+/* Copyright (c) 2021, Samsung
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+
+#include "buffer_pool.h"
+#include "core/sampled_image.h"
+#include "postprocessing_pipeline.h"
+
+namespace vkb
+{
+/**
+ * @brief Quality presets of vkb::CMAAPass, from the cheapest to the most thorough.
+ *        Lower presets detect fewer edges and blend shorter lines.
+ */
+enum class CMAAQuality : uint32_t
+{
+	Low,
+	Medium,
+	High,
+	Ultra
+};
+
+/**
+ * @brief Conservative Morphological Anti-Aliasing (CMAA) as a self-contained effect.
+ *
+ * draw() detects edge candidates in the scene image, refines them into edges, combines
+ * the edges into lines, and blends the pixels along the lines into a copy of the scene
+ * owned by the pass (or, opt-in, into the scene image itself). The stages after the detect
+ * are dispatched indirectly from the candidate and edge counts written on the GPU.
+ *
+ * Each stage declares the resources it reads and writes, and the barriers between stages
+ * are derived from these declarations, one vkCmdPipelineBarrier per transition point.
+ *
+ * The detect runs as a compute shader by default, or as a fullscreen fragment pass. The
+ * options of the compute detect are temporal reuse, which only anti-aliases again the
+ * 16x16 pixel tiles near a tile that changed since the previous frame, and shared luma.
+ * Either detect reads the luma from an attachment of the scene pass when one is given.
+ * Tile binning sorts the candidate list into screen tiles for the later stages. The
+ * quality preset is compiled into the pipelines as specialization constants.
+ *
+ * Scratch resources are kept per vkb::RenderFrame, so that frames in flight overlap on
+ * the GPU, and recreated when the scene extent changes. The GPU time of each stage is
+ * added to the StatIndex::gpu_time_cmaa_* stats.
+ */
+class CMAAPass
+{
+  public:
+	CMAAPass(RenderContext &render_context);
+
+	CMAAPass(const CMAAPass &) = delete;
+	CMAAPass &operator=(const CMAAPass &) = delete;
+
+	CMAAPass(CMAAPass &&) = delete;
+	CMAAPass &operator=(CMAAPass &&) = delete;
+
+	~CMAAPass() = default;
+
+	/**
+	 * @brief Anti-aliases the scene image, recording commands into the given command buffer.
+	 * @param render_target The render target holding the scene image
+	 * @param attachment The scene image, an RGBA8 attachment with SAMPLED usage
+	 *        (and STORAGE usage when running in place)
+	 * @param luma_attachment Optional R8 attachment with SAMPLED usage holding the luma of the scene
+	 *        image, written by the scene pass alongside it. The detect then reads the luma instead of
+	 *        computing it from the scene image.
+	 * @return The anti-aliased image, in SHADER_READ_ONLY_OPTIMAL layout and visible to fragment shaders
+	 */
+	core::SampledImage draw(CommandBuffer &command_buffer, RenderTarget &render_target, uint32_t attachment, uint32_t luma_attachment = VK_ATTACHMENT_UNUSED);
+
+	/**
+	 * @brief Compiles the shader variants of every combination of options the pass supports
+	 *        on this GPU, so that they are in the SPIR-V cache before they are first drawn
+	 */
+	void prebuild_shader_variants();
+
+	/**
+	 * @brief If true, edges are detected by a compute shader which also writes the
+	 *        indirect arguments of the refine stage, otherwise by a fullscreen fragment pass
+	 */
+	inline CMAAPass &set_compute_detect(bool enabled)
+	{
+		compute_detect = enabled;
+
+		return *this;
+	}
+
+	/**
+	 * @brief If true, the blended edge pixels are written back into the scene image, otherwise
+	 *        into a copy of it owned by the pass. In place, the pass stages the blended pixels
+	 *        and copies only those into the scene once every stage has read it, instead of
+	 *        copying the whole scene.
+	 */
+	inline CMAAPass &set_in_place(bool enabled)
+	{
+		in_place = enabled;
+
+		return *this;
+	}
+
+	/**
+	 * @brief If true, the candidates are sorted into screen tiles before refine and combine
+	 */
+	inline CMAAPass &set_tile_binning(bool enabled)
+	{
+		tile_binning = enabled;
+
+		return *this;
+	}
+
+	/**
+	 * @brief If true, the output of tiles that did not change since the previous frame
+	 *        is reused instead of being anti-aliased again. Requires the compute detect.
+	 */
+	inline CMAAPass &set_temporal(bool enabled)
+	{
+		temporal = enabled;
+
+		return *this;
+	}
+
+	/**
+	 * @brief If true, each workgroup of the compute detect fetches the pixels of its tile once,
+	 *        sharing their luma through shared memory and copying them from the same fetch.
+	 *        Requires the compute detect.
+	 */
+	inline CMAAPass &set_shared_luma(bool enabled)
+	{
+		shared_luma = enabled;
+
+		return *this;
+	}
+
+	inline CMAAPass &set_quality(CMAAQuality new_quality)
+	{
+		quality = new_quality;
+
+		return *this;
+	}
+
+	inline bool is_compute_detect() const
+	{
+		return compute_detect;
+	}
+
+	inline bool is_in_place() const
+	{
+		return in_place;
+	}
+
+	inline bool is_tile_binning() const
+	{
+		return tile_binning;
+	}
+
+	inline bool is_temporal() const
+	{
+		return temporal;
+	}
+
+	inline bool is_shared_luma() const
+	{
+		return shared_luma;
+	}
+
+	inline CMAAQuality get_quality() const
+	{
+		return quality;
+	}
+
+	/**
+	 * @brief Whether the refine and combine stages aggregate their appends per subgroup,
+	 *        which is decided from the subgroup properties of the GPU
+	 */
+	inline bool is_subgroup_append() const
+	{
+		return subgroup_append;
+	}
+
+  private:
+	/**
+	 * @brief Resources that the CMAA stages depend on
+	 */
+	enum Resource : uint32_t
+	{
+		CountBuffer,
+		CandidatePosBuffer,
+		EdgePosBuffer,
+		BinnedPosBuffer,
+		TileCountBuffer,
+		TileOffsetBuffer,
+		TileChangeBuffer,
+		TileFreshBuffer,
+		TileHashBuffer,
+		IndirectBuffer,
+		BlendPosBuffer,
+		PotentialEdgeImage,
+		PartialEdgeImage,
+		FullEdgeImage,
+		ColourImage,
+		HistoryImage,
+		SceneImage,
+		LumaImage,
+		ResourceCount
+	};
+
+	/**
+	 * @brief A read and/or write of a resource by a stage
+	 */
+	struct Access
+	{
+		Resource resource;
+
+		VkPipelineStageFlags stage_mask;
+
+		VkAccessFlags access_mask;
+
+		/// Layout the image has to be in, ignored for buffers
+		VkImageLayout layout{VK_IMAGE_LAYOUT_UNDEFINED};
+
+		/// If true the previous contents of the image are not needed
+		bool discard{false};
+	};
+
+	/**
+	 * @brief Accesses to a resource since its last write
+	 */
+	struct ResourceState
+	{
+		VkPipelineStageFlags write_stages{0};
+
+		VkAccessFlags write_access{0};
+
+		/// Stages that read the resource after the last write
+		VkPipelineStageFlags read_stages{0};
+
+		/// Stages and accesses the last write has already been made visible to
+		VkPipelineStageFlags visible_stages{0};
+
+		VkAccessFlags visible_access{0};
+	};
+
+	RenderContext &render_context;
+
+	bool compute_detect{true};
+
+	bool in_place{false};
+
+	bool tile_binning{false};
+
+	bool temporal{false};
+
+	bool shared_luma{false};
+
+	CMAAQuality quality{CMAAQuality::High};
+
+	/// Refine and combine use one atomic per subgroup instead of one per invocation
+	bool subgroup_append{false};
+
+	std::unique_ptr<PostProcessingPipeline> detect_pipeline{};
+	std::unique_ptr<PostProcessingPipeline> detect_compute_pipeline{};
+	std::unique_ptr<PostProcessingPipeline> refine_pipeline{};
+	std::unique_ptr<PostProcessingPipeline> combine_pipeline{};
+	std::unique_ptr<PostProcessingPipeline> process_pipeline{};
+
+	/// Divide the detected candidates and edges into workgroups for indirect dispatching
+	std::unique_ptr<PostProcessingPipeline> first_intermediary_pipeline{};
+	std::unique_ptr<PostProcessingPipeline> second_intermediary_pipeline{};
+
+	/// Count the candidates per tile, turn the counts into offsets, and scatter the candidates to their tiles
+	std::unique_ptr<PostProcessingPipeline> bin_count_pipeline{};
+	std::unique_ptr<PostProcessingPipeline> bin_scan_pipeline{};
+	std::unique_ptr<PostProcessingPipeline> bin_scatter_pipeline{};
+
+	/// Copy the pixels blended in place from the colour image into the scene image
+	std::unique_ptr<PostProcessingPipeline> apply_blends_pipeline{};
+
+	/// Flag the changed tiles, and store the fresh tiles in (or restore the others from) the history
+	std::unique_ptr<PostProcessingPipeline> temporal_hash_pipeline{};
+	std::unique_ptr<PostProcessingPipeline> temporal_resolve_pipeline{};
+
+	/**
+	 * @brief Scratch resources used by a single frame in flight
+	 */
+	struct FrameResources
+	{
+		VkExtent2D extent{0, 0};
+
+		/// Number of 8x8 candidate tiles in each dimension
+		glm::tvec2<uint32_t> tile_grid{0, 0};
+
+		std::unique_ptr<core::Buffer> candidate_pos_buffer;
+		std::unique_ptr<core::Buffer> edge_pos_buffer;
+		std::unique_ptr<core::Buffer> count_buffer;
+		std::unique_ptr<core::Buffer> indirect_buffer;
+		std::unique_ptr<core::Buffer> binned_pos_buffer;
+		std::unique_ptr<core::Buffer> tile_count_buffer;
+		std::unique_ptr<core::Buffer> tile_offset_buffer;
+		std::unique_ptr<core::Buffer> tile_change_buffer;
+		std::unique_ptr<core::Buffer> tile_fresh_buffer;
+		std::unique_ptr<core::Buffer> blend_pos_buffer;
+
+		std::unique_ptr<BufferAllocation> candidate_pos_alloc;
+		std::unique_ptr<BufferAllocation> edge_pos_alloc;
+		std::unique_ptr<BufferAllocation> count_alloc;
+		std::unique_ptr<BufferAllocation> indirect_alloc;
+		std::unique_ptr<BufferAllocation> binned_pos_alloc;
+		std::unique_ptr<BufferAllocation> tile_count_alloc;
+		std::unique_ptr<BufferAllocation> tile_offset_alloc;
+		std::unique_ptr<BufferAllocation> tile_change_alloc;
+		std::unique_ptr<BufferAllocation> tile_fresh_alloc;
+		std::unique_ptr<BufferAllocation> blend_pos_alloc;
+
+		std::unique_ptr<RenderTarget> potential_edge_render_target;
+		std::unique_ptr<RenderTarget> partial_edge_render_target;
+		std::unique_ptr<RenderTarget> full_edge_render_target;
+		std::unique_ptr<RenderTarget> colour_render_target;
+
+		/// The counters (including the tile counts) are only reset by the CMAA shaders themselves, so they have to be zeroed once after creation
+		bool counters_initialised{false};
+
+		/// Tags the edge texels written by the current draw(), in the range [1, 255]
+		uint32_t edge_generation{0};
+	};
+
+	/// Indexed by the active frame index of the render context
+	std::vector<std::unique_ptr<FrameResources>> frame_resources;
+
+	/// Resources of the current draw()
+	FrameResources *frame{nullptr};
+
+	/**
+	 * @brief Resources of the temporal reuse, shared by all frames as each frame builds on the previous one
+	 */
+	struct HistoryResources
+	{
+		VkExtent2D extent{0, 0};
+
+		/// Hash of each tile as of the last temporal frame
+		std::unique_ptr<core::Buffer>     tile_hash_buffer;
+		std::unique_ptr<BufferAllocation> tile_hash_alloc;
+
+		/// Output of the last temporal frame
+		std::unique_ptr<RenderTarget> history_render_target;
+
+		/// Whether the history holds an output of the current settings
+		bool valid{false};
+
+		CMAAQuality quality{CMAAQuality::High};
+
+		bool in_place{false};
+	};
+
+	std::unique_ptr<HistoryResources> history;
+
+	/// Whether the current draw() reuses the output of unchanged tiles
+	bool temporal_active{false};
+
+	/// Whether the current draw() shares the luma of its tiles between the detect invocations
+	bool shared_luma_active{false};
+
+	/// Accesses to each resource so far in the current draw(), or in previous draws for the history resources
+	std::array<ResourceState, ResourceCount> resource_states{};
+
+	/// Scene image of the current draw()
+	RenderTarget *scene_render_target{nullptr};
+
+	uint32_t scene_attachment{0};
+
+	/// Luma of the scene image in the same render target, VK_ATTACHMENT_UNUSED if the detect computes it
+	uint32_t scene_luma_attachment{VK_ATTACHMENT_UNUSED};
+
+	/// The buffer holding the candidate list of the current draw(), binning moves it to the other position buffer
+	Resource candidate_list{CandidatePosBuffer};
+
+	/**
+	 * @brief Creates the scratch images and buffers of a frame for the given scene extent
+	 */
+	std::unique_ptr<FrameResources> create_frame_resources(const VkExtent2D &extent);
+
+	/**
+	 * @brief Creates the history resources for the given scene extent
+	 */
+	std::unique_ptr<HistoryResources> create_history_resources(const VkExtent2D &extent);
+
+	/**
+	 * @brief Derives the barriers needed before the given accesses and records them
+	 *        as a single pipeline barrier, updating the layouts of the accessed images
+	 */
+	void barrier(CommandBuffer &command_buffer, const std::vector<Access> &accesses);
+
+	const BufferAllocation &get_buffer(Resource resource) const;
+
+	RenderTarget &get_image_target(Resource resource) const;
+
+	uint32_t get_image_attachment(Resource resource) const;
+
+	/**
+	 * @brief The image the anti-aliased edges are blended into
+	 */
+	Resource get_output() const;
+
+	/**
+	 * @brief Resets the edge images of a frame when its edge generation starts over, that is
+	 *        once after they are created and then every 255 frames, as their texels would
+	 *        otherwise be mistaken for edges of the current frame. Also zeroes the counters
+	 *        once after they are created.
+	 */
+	void reset_edge_images(CommandBuffer &command_buffer);
+
+	/**
+	 * @brief Flags the tiles of the scene that changed since the last temporal frame
+	 */
+	void hash_tiles(CommandBuffer &command_buffer);
+
+	void detect(CommandBuffer &command_buffer);
+
+	/**
+	 * @brief Sorts the candidate list into tiles, switching it to the other position buffer
+	 */
+	void bin_candidates(CommandBuffer &command_buffer);
+
+	void refine(CommandBuffer &command_buffer);
+
+	void combine(CommandBuffer &command_buffer);
+
+	void process(CommandBuffer &command_buffer);
+
+	/**
+	 * @brief Copies the pixels blended in place by the combine and process stages into the scene image
+	 */
+	void apply_blends(CommandBuffer &command_buffer);
+
+	/**
+	 * @brief Updates the history from the fresh tiles, and the output of the others from the history
+	 */
+	void resolve_history(CommandBuffer &command_buffer);
+};
+}        // namespace vkb
@@ -0,0 +1,149 @@
+/* Copyright (c) 2021, Samsung
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "draw_list.h"
+
+#include <array>
+#include <cstring>
+
+namespace vkb
+{
+namespace
+{
+/**
+ * @brief Bits of a float, which order the same way as the float itself when it is non-negative
+ */
+inline uint32_t depth_bits(float distance)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &distance, sizeof(bits));
+
+	// Negative distances only come from rounding errors, treat them as zero
+	return (bits & 0x80000000U) ? 0U : bits;
+}
+}        // namespace
+
+uint64_t DrawList::state_then_depth_key(uint32_t state, float distance)
+{
+	return (static_cast<uint64_t>(state) << 32) | depth_bits(distance);
+}
+
+uint64_t DrawList::back_to_front_key(uint32_t state, float distance)
+{
+	return (static_cast<uint64_t>(~depth_bits(distance)) << 32) | state;
+}
+
+void DrawList::clear()
+{
+	keys.clear();
+	draws.clear();
+}
+
+void DrawList::add(uint64_t key, sg::Node &node, sg::SubMesh &sub_mesh)
+{
+	keys.push_back(key);
+	draws.push_back({&node, &sub_mesh});
+}
+
+void DrawList::sort()
+{
+	const size_t count = keys.size();
+
+	if (count < 2)
+	{
+		return;
+	}
+
+	sorted_keys.resize(count);
+	order.resize(count);
+	sorted_order.resize(count);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		order[i] = static_cast<uint32_t>(i);
+	}
+
+	// Count the digits of the eight key bytes in a single pass
+	std::array<std::array<uint32_t, 256>, 8> histograms{};
+
+	for (auto key : keys)
+	{
+		for (size_t byte = 0; byte < 8; byte++)
+		{
+			histograms[byte][(key >> (byte * 8)) & 0xFF]++;
+		}
+	}
+
+	for (size_t byte = 0; byte < 8; byte++)
+	{
+		auto &histogram = histograms[byte];
+
+		const uint32_t shift = static_cast<uint32_t>(byte * 8);
+
+		// Skip the bytes which are the same in every key, such as
+		// the high bytes of the state when few pipelines are used
+		if (histogram[(keys[0] >> shift) & 0xFF] == count)
+		{
+			continue;
+		}
+
+		uint32_t offset = 0;
+		for (auto &digit_count : histogram)
+		{
+			uint32_t digit_offset = offset;
+			offset += digit_count;
+			digit_count = digit_offset;
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			uint32_t position = histogram[(keys[i] >> shift) & 0xFF]++;
+
+			sorted_keys[position]  = keys[i];
+			sorted_order[position] = order[i];
+		}
+
+		keys.swap(sorted_keys);
+		order.swap(sorted_order);
+	}
+
+	sorted_draws.resize(count);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		sorted_draws[i] = draws[order[i]];
+	}
+
+	draws.swap(sorted_draws);
+}
+
+std::vector<DrawList::Draw>::const_iterator DrawList::begin() const
+{
+	return draws.begin();
+}
+
+std::vector<DrawList::Draw>::const_iterator DrawList::end() const
+{
+	return draws.end();
+}
+
+size_t DrawList::size() const
+{
+	return draws.size();
+}
+}        // namespace vkb
@@ -0,0 +1,94 @@
+/* Copyright (c) 2021, Samsung
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vkb
+{
+namespace sg
+{
+class Node;
+class SubMesh;
+}        // namespace sg
+
+/**
+ * @brief A list of draws ordered by 64-bit sort keys, which pack the depth
+ *        and render state of each draw. Its storage is kept when it is cleared,
+ *        so that a list refilled every frame stops allocating once it has grown.
+ */
+class DrawList
+{
+  public:
+	struct Draw
+	{
+		sg::Node *node;
+
+		sg::SubMesh *sub_mesh;
+	};
+
+	/**
+	 * @brief Packs a key which orders draws front-to-back within groups of equal render state
+	 * @param state Identifies the pipeline and material of the draw, see GeometrySubpass
+	 * @param distance Non-negative distance of the draw from the camera
+	 */
+	static uint64_t state_then_depth_key(uint32_t state, float distance);
+
+	/**
+	 * @brief Packs a key which orders draws back-to-front, and by render state at equal depth
+	 * @param state Identifies the pipeline and material of the draw, see GeometrySubpass
+	 * @param distance Non-negative distance of the draw from the camera
+	 */
+	static uint64_t back_to_front_key(uint32_t state, float distance);
+
+	/**
+	 * @brief Removes all the draws, keeping the storage
+	 */
+	void clear();
+
+	void add(uint64_t key, sg::Node &node, sg::SubMesh &sub_mesh);
+
+	/**
+	 * @brief Orders the draws by increasing key, with a stable least significant digit radix sort
+	 */
+	void sort();
+
+	std::vector<Draw>::const_iterator begin() const;
+
+	std::vector<Draw>::const_iterator end() const;
+
+	size_t size() const;
+
+  private:
+	std::vector<uint64_t> keys;
+
+	std::vector<Draw> draws;
+
+	/// Scratch storage of the radix sort passes
+	std::vector<uint64_t> sorted_keys;
+
+	std::vector<uint32_t> order;
+
+	std::vector<uint32_t> sorted_order;
+
+	std::vector<Draw> sorted_draws;
+};
+}        // namespace vkb
@@ -115,8 +115,16 @@ void PostProcessingComputePass::transition_images(CommandBuffer &command_buffer,
 	auto &shader_module   = resource_cache.request_shader_module(VK_SHADER_STAGE_COMPUTE_BIT, cs_source, cs_variant);
 	auto &pipeline_layout = resource_cache.request_pipeline_layout({&shader_module});
 
+	const auto &bindings = pipeline_layout.get_descriptor_set_layout(0);
+
 	for (const auto &sampled : sampled_images)
 	{
+		if (!bindings.get_layout_binding(sampled.first))
+		{
+			// Not used by the current shader variant
+			continue;
+		}
+
 		if (const uint32_t *attachment = sampled.second.get_target_attachment())
 		{
 			auto *sampled_rt = sampled.second.get_render_target();
@@ -144,8 +152,6 @@ void PostProcessingComputePass::transition_images(CommandBuffer &command_buffer,
 		}
 	}
 
-	const auto &bindings = pipeline_layout.get_descriptor_set_layout(0);
-
 	for (const auto &storage : storage_images)
 	{
 		if (const uint32_t *attachment = storage.second.get_target_attachment())
@@ -204,7 +210,10 @@ void PostProcessingComputePass::transition_images(CommandBuffer &command_buffer,
 
 void PostProcessingComputePass::draw(CommandBuffer &command_buffer, RenderTarget &default_render_target)
 {
-	transition_images(command_buffer, default_render_target);
+	if (automatic_barriers)
+	{
+		transition_images(command_buffer, default_render_target);
+	}
 
 	// Get compute shader from cache
 	auto &resource_cache = command_buffer.get_device().get_resource_cache();
@@ -214,6 +223,11 @@ void PostProcessingComputePass::draw(CommandBuffer &command_buffer, RenderTarget
 	auto &pipeline_layout = resource_cache.request_pipeline_layout({&shader_module});
 	command_buffer.bind_pipeline_layout(pipeline_layout);
 
+	for (const auto &it : specialization_constants)
+	{
+		command_buffer.set_specialization_constant(it.first, it.second);
+	}
+
 	const auto &bindings = pipeline_layout.get_descriptor_set_layout(0);
 
 	// Bind samplers to set = 0, binding = <according to name>
@@ -52,6 +52,35 @@ class PostProcessingComputePass : public PostProcessingPass<PostProcessingComput
 	void prepare(CommandBuffer &command_buffer, RenderTarget &default_render_target) override;
 	void draw(CommandBuffer &command_buffer, RenderTarget &default_render_target) override;
 
+	/**
+	 * @brief Returns the shader variant used for this pass' compute shader.
+	 */
+	inline ShaderVariant &get_cs_variant()
+	{
+		return cs_variant;
+	}
+
+	/**
+	 * @brief Sets the shader variant that will be used for this pass' compute shader.
+	 */
+	inline PostProcessingComputePass &set_cs_variant(ShaderVariant &&new_variant)
+	{
+		cs_variant = std::move(new_variant);
+
+		return *this;
+	}
+
+	/**
+	 * @brief If disabled, draw() does not transition the bound images; the caller is then
+	 *        responsible for their layouts and for all memory dependencies of this pass.
+	 */
+	inline PostProcessingComputePass &set_automatic_barriers(bool enabled)
+	{
+		automatic_barriers = enabled;
+
+		return *this;
+	}
+
 	/**
 	 * @brief Sets the number of workgroups to be dispatched each draw().
 	 */
@@ -169,11 +198,24 @@ class PostProcessingComputePass : public PostProcessingPass<PostProcessingComput
 		return *this;
 	}
 
+	/**
+	 * @brief Sets a specialization constant of the compute shader.
+	 *        Each distinct set of constants is compiled into its own pipeline.
+	 */
+	template <typename T>
+	inline PostProcessingComputePass &set_specialization_constant(uint32_t constant_id, const T &data)
+	{
+		specialization_constants[constant_id] = to_bytes(data);
+
+		return *this;
+	}
+
   private:
 	ShaderSource         cs_source;
 	ShaderVariant        cs_variant;
 	glm::tvec3<uint32_t> n_workgroups{1, 1, 1};
 	const BufferAllocation *indirectBuffer = nullptr;
+	bool                 automatic_barriers{true};
 
 	std::shared_ptr<core::Sampler> default_sampler{};
 	SampledImageMap                sampled_images{};
@@ -184,6 +226,8 @@ class PostProcessingComputePass : public PostProcessingPass<PostProcessingComput
 	std::unique_ptr<BufferAllocation> uniform_alloc{};
 	std::vector<uint8_t>              push_constants_data{};
 
+	std::map<uint32_t, std::vector<uint8_t>> specialization_constants{};
+
 	/**
 	 * @brief Transitions sampled_images (to SHADER_READ_ONLY_OPTIMAL)
 	 *        and storage_images (to GENERAL) as appropriate.
@@ -41,7 +41,10 @@ void PostProcessingPipeline::draw(CommandBuffer &command_buffer, RenderTarget &d
 			pass.pre_draw();
 		}
 
-		pass.draw(command_buffer, default_render_target);
+		{
+			auto timer = command_buffer.time_scope(timer_stat);
+			pass.draw(command_buffer, default_render_target);
+		}
 
 		if (pass.post_draw)
 		{
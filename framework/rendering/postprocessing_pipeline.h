@@ -46,6 +46,7 @@ class PostProcessingPipeline
 
 	/**
 	 * @brief Runs all renderpasses in this pipeline, recording commands into the given command buffer.
+	 *        Each pass is timed on the GPU, see CommandBuffer::time_scope().
 	 * @remarks vkb::PostProcessingRenderpass that do not explicitly have a vkb::RenderTarget set will render
 	 *          to default_render_target.
 	 */
@@ -79,6 +80,16 @@ class PostProcessingPipeline
 		return added_pass;
 	}
 
+	/**
+	 * @brief Sets the stat the GPU time of each pass is added to
+	 */
+	inline PostProcessingPipeline &set_timer_stat(StatIndex stat)
+	{
+		timer_stat = stat;
+
+		return *this;
+	}
+
 	/**
 	 * @brief Returns the current render context.
 	 */
@@ -100,6 +111,7 @@ class PostProcessingPipeline
 	ShaderSource                                         triangle_vs;
 	std::vector<std::unique_ptr<PostProcessingPassBase>> passes{};
 	size_t                                               current_pass_index{0};
+	StatIndex                                            timer_stat{StatIndex::gpu_time_postprocessing};
 };
 
 }        // namespace vkb
\ No newline at end of file
@@ -42,7 +42,8 @@ PostProcessingSubpass::PostProcessingSubpass(PostProcessingSubpass &&to_move) :
     parent{std::move(to_move.parent)},
     fs_variant{std::move(to_move.fs_variant)},
     input_attachments{std::move(to_move.input_attachments)},
-    sampled_images{std::move(to_move.sampled_images)}
+    sampled_images{std::move(to_move.sampled_images)},
+    specialization_constants{std::move(to_move.specialization_constants)}
 {}
 
 PostProcessingSubpass &PostProcessingSubpass::bind_input_attachment(const std::string &name, uint32_t new_input_attachment)
@@ -139,6 +140,11 @@ void PostProcessingSubpass::draw(CommandBuffer &command_buffer)
 	auto &pipeline_layout = resource_cache.request_pipeline_layout(shader_modules);
 	command_buffer.bind_pipeline_layout(pipeline_layout);
 
+	for (const auto &it : specialization_constants)
+	{
+		command_buffer.set_specialization_constant(it.first, it.second);
+	}
+
 	// Disable culling
 	RasterizationState rasterization_state;
 	rasterization_state.cull_mode = VK_CULL_MODE_NONE;
@@ -183,6 +183,18 @@ class PostProcessingSubpass : public Subpass
 		return *this;
 	}
 
+	/**
+	 * @brief Sets a specialization constant of the fragment shader.
+	 *        Each distinct set of constants is compiled into its own pipeline.
+	 */
+	template <typename T>
+	inline PostProcessingSubpass &set_specialization_constant(uint32_t constant_id, const T &data)
+	{
+		specialization_constants[constant_id] = to_bytes(data);
+
+		return *this;
+	}
+
 	/**
 	 * @brief A functor used to draw the primitives for a post-processing step.
 	 * @see default_draw_func()
@@ -212,6 +224,8 @@ class PostProcessingSubpass : public Subpass
 
 	std::vector<uint8_t> push_constants_data{};
 
+	std::map<uint32_t, std::vector<uint8_t>> specialization_constants{};
+
 	DrawFunc draw_func{&PostProcessingSubpass::default_draw_func};
 
 	void prepare() override;
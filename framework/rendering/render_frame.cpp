@@ -86,6 +86,98 @@ void RenderFrame::reset()
 	}
 
 	semaphore_pool.reset();
+
+	// The timers of the previous submission stay readable until they are reset
+	gpu_timers_enabled = false;
+}
+
+void RenderFrame::reset_gpu_timers(CommandBuffer &command_buffer)
+{
+	if (!timestamp_pool)
+	{
+		VkQueryPoolCreateInfo pool_create_info{VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+		pool_create_info.queryType  = VK_QUERY_TYPE_TIMESTAMP;
+		pool_create_info.queryCount = MAX_GPU_TIMERS * 2;
+
+		timestamp_pool = std::make_unique<QueryPool>(device, pool_create_info);
+	}
+
+	command_buffer.reset_query_pool(*timestamp_pool, 0, MAX_GPU_TIMERS * 2);
+
+	gpu_timer_stats.clear();
+	gpu_timers_enabled = true;
+}
+
+uint32_t RenderFrame::request_gpu_timer(StatIndex stat)
+{
+	if (!gpu_timers_enabled || gpu_timer_stats.size() == MAX_GPU_TIMERS)
+	{
+		return ~0U;
+	}
+
+	gpu_timer_stats.push_back(stat);
+
+	return to_u32(gpu_timer_stats.size() - 1) * 2;
+}
+
+QueryPool &RenderFrame::get_timestamp_pool()
+{
+	assert(timestamp_pool && "GPU timers have not been reset");
+	return *timestamp_pool;
+}
+
+std::unordered_map<StatIndex, double, StatIndexHash> RenderFrame::collect_gpu_timers(float timestamp_period)
+{
+	std::unordered_map<StatIndex, double, StatIndexHash> times;
+
+	// The timers are recorded into graphics command buffers, whose queue only writes
+	// the low timestampValidBits bits of the timestamps (none if it does not support them)
+	const uint32_t valid_bits = device.get_suitable_graphics_queue().get_properties().timestampValidBits;
+
+	if (gpu_timer_stats.empty() || valid_bits == 0)
+	{
+		return times;
+	}
+
+	const uint64_t timestamp_mask = valid_bits < 64 ? (uint64_t{1} << valid_bits) - 1 : ~uint64_t{0};
+
+	std::vector<uint64_t> timestamps(gpu_timer_stats.size() * 2);
+
+	VkResult result = timestamp_pool->get_results(0, to_u32(timestamps.size()),
+	                                              timestamps.size() * sizeof(uint64_t),
+	                                              timestamps.data(), sizeof(uint64_t),
+	                                              VK_QUERY_RESULT_64_BIT);
+	if (result != VK_SUCCESS)
+	{
+		return times;
+	}
+
+	for (size_t i = 0; i < gpu_timer_stats.size(); i++)
+	{
+		// Masking the difference also handles the counter wrapping around between the two timestamps
+		const uint64_t ticks = ((timestamps[i * 2 + 1] & timestamp_mask) - (timestamps[i * 2] & timestamp_mask)) & timestamp_mask;
+
+		times[gpu_timer_stats[i]] += double(ticks) * timestamp_period * 1e-9;
+	}
+
+	return times;
+}
+
+void RenderFrame::add_to_counter(StatIndex stat, float value)
+{
+	std::lock_guard<std::mutex> guard{counter_mutex};
+
+	counters[stat] += value;
+}
+
+std::unordered_map<StatIndex, float, StatIndexHash> RenderFrame::collect_counters()
+{
+	std::lock_guard<std::mutex> guard{counter_mutex};
+
+	std::unordered_map<StatIndex, float, StatIndexHash> values;
+	values.swap(counters);
+
+	return values;
 }
 
 std::vector<std::unique_ptr<CommandPool>> &RenderFrame::get_command_pools(const Queue &queue, CommandBuffer::ResetMode reset_mode)
@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <mutex>
+
 #include "buffer_pool.h"
 #include "common/helpers.h"
 #include "common/resource_caching.h"
@@ -31,6 +33,7 @@
 #include "fence_pool.h"
 #include "rendering/render_target.h"
 #include "semaphore_pool.h"
+#include "stats/stats_common.h"
 
 namespace vkb
 {
@@ -68,6 +71,11 @@ class RenderFrame
 	    {VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, 1},
 	    {VK_BUFFER_USAGE_INDEX_BUFFER_BIT, 1}};
 
+	/**
+	 * @brief Maximum number of GPU timers recorded in a frame, the following ones are ignored
+	 */
+	static constexpr uint32_t MAX_GPU_TIMERS = 64;
+
 	RenderFrame(Device &device, std::unique_ptr<RenderTarget> &&render_target, size_t thread_count = 1);
 
 	RenderFrame(const RenderFrame &) = delete;
@@ -141,6 +149,42 @@ class RenderFrame
 	 */
 	void update_descriptor_sets(size_t thread_index = 0);
 
+	/**
+	 * @brief Resets the timestamp queries of the frame and enables its GPU timers
+	 *        until the frame is reset. Must be recorded outside of a render pass.
+	 * @param command_buffer The first command buffer of the frame to be submitted
+	 */
+	void reset_gpu_timers(CommandBuffer &command_buffer);
+
+	/**
+	 * @brief Reserves the two timestamp queries of a GPU timer
+	 * @param stat The stat the measured time is added to
+	 * @return The index of the first query, or ~0U if the GPU timers are disabled or all in use
+	 */
+	uint32_t request_gpu_timer(StatIndex stat);
+
+	QueryPool &get_timestamp_pool();
+
+	/**
+	 * @brief Reads the GPU timers recorded in the last submission of the frame, whose fence must have been waited on
+	 * @param timestamp_period Nanoseconds per timestamp tick
+	 * @return The measured time in seconds of each stat, summed over its timers
+	 */
+	std::unordered_map<StatIndex, double, StatIndexHash> collect_gpu_timers(float timestamp_period);
+
+	/**
+	 * @brief Adds to a CPU counter of the frame, such as the number of culled submeshes
+	 * @param stat The stat the value is added to
+	 * @param value The value to add
+	 */
+	void add_to_counter(StatIndex stat, float value);
+
+	/**
+	 * @brief Reads and resets the CPU counters added to since the last call
+	 * @return The value of each counter
+	 */
+	std::unordered_map<StatIndex, float, StatIndexHash> collect_counters();
+
   private:
 	Device &device;
 
@@ -173,5 +217,18 @@ class RenderFrame
 	BufferAllocationStrategy buffer_allocation_strategy{BufferAllocationStrategy::MultipleAllocationsPerBuffer};
 
 	std::map<VkBufferUsageFlags, std::vector<std::pair<BufferPool, BufferBlock *>>> buffer_pools;
+
+	/// Begin and end timestamps of each GPU timer, created on first use
+	std::unique_ptr<QueryPool> timestamp_pool;
+
+	/// Stat of each GPU timer recorded in the frame, timer i uses the queries 2i and 2i + 1
+	std::vector<StatIndex> gpu_timer_stats;
+
+	bool gpu_timers_enabled{false};
+
+	/// Guards the counters, which subpasses may add to from several threads
+	std::mutex counter_mutex;
+
+	std::unordered_map<StatIndex, float, StatIndexHash> counters;
 };
 }        // namespace vkb
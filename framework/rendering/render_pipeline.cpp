@@ -78,10 +78,22 @@ void RenderPipeline::set_clear_value(const std::vector<VkClearValue> &cv)
 	clear_value = cv;
 }
 
+void RenderPipeline::set_timer_stat(StatIndex stat)
+{
+	timer_stat = stat;
+}
+
 void RenderPipeline::draw(CommandBuffer &command_buffer, RenderTarget &render_target, VkSubpassContents contents)
 {
 	assert(!subpasses.empty() && "Render pipeline should contain at least one sub-pass");
 
+	// Timestamps cannot be written in subpasses whose contents are secondary command buffers
+	std::unique_ptr<CommandBuffer::ScopedTimer> timer;
+	if (contents == VK_SUBPASS_CONTENTS_INLINE)
+	{
+		timer = std::make_unique<CommandBuffer::ScopedTimer>(command_buffer, timer_stat);
+	}
+
 	// Pad clear values if they're less than render target attachments
 	while (clear_value.size() < render_target.get_attachments().size())
 	{
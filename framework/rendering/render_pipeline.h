@@ -85,7 +85,12 @@ class RenderPipeline
 	std::vector<std::unique_ptr<Subpass>> &get_subpasses();
 
 	/**
-	 * @brief Record draw commands for each Subpass
+	 * @param stat The stat the GPU time of draw() is added to
+	 */
+	void set_timer_stat(StatIndex stat);
+
+	/**
+	 * @brief Record draw commands for each Subpass, timed on the GPU if the contents are inline
 	 */
 	void draw(CommandBuffer &command_buffer, RenderTarget &render_target, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
 
@@ -105,5 +110,7 @@ class RenderPipeline
 	std::vector<VkClearValue> clear_value = std::vector<VkClearValue>(2);
 
 	size_t active_subpass_index{0};
+
+	StatIndex timer_stat{StatIndex::gpu_time_scene};
 };
 }        // namespace vkb
@@ -18,6 +18,7 @@
 #include "rendering/subpasses/geometry_subpass.h"
 #include "common/utils.h"
 #include "common/vk_common.h"
+#include "geometry/frustum.h"
 #include "rendering/render_context.h"
 #include "scene_graph/components/camera.h"
 #include "scene_graph/components/image.h"
@@ -36,6 +37,9 @@ GeometrySubpass::GeometrySubpass(RenderContext &render_context, ShaderSource &&v
     camera{camera},
     scene{scene_}
 {
+	// The per-node uniform only changes its offset between draws, which
+	// a dynamic uniform buffer takes without a new descriptor set
+	resource_mode_map["GlobalUniform"] = ShaderResourceMode::Dynamic;
 }
 
 void GeometrySubpass::prepare()
@@ -53,56 +57,166 @@ void GeometrySubpass::prepare()
 	}
 }
 
-void GeometrySubpass::get_sorted_nodes(std::multimap<float, std::pair<sg::Node *, sg::SubMesh *>> &opaque_nodes, std::multimap<float, std::pair<sg::Node *, sg::SubMesh *>> &transparent_nodes)
+void GeometrySubpass::set_frustum_culling(bool enable)
 {
-	auto camera_transform = camera.get_node()->get_transform().get_world_matrix();
+	frustum_culling = enable;
+}
 
-	for (auto &mesh : meshes)
+void GeometrySubpass::cull_mesh_instances()
+{
+	if (mesh_instances.empty())
 	{
-		for (auto &node : mesh->get_nodes())
+		// Dense ids, so that draws sharing a pipeline or material get neighbouring sort keys
+		std::unordered_map<size_t, uint32_t>              pipeline_ids;
+		std::unordered_map<const sg::Material *, uint32_t> material_ids;
+
+		for (auto &mesh : meshes)
 		{
-			auto node_transform = node->get_transform().get_world_matrix();
+			uint32_t first_sub_mesh_state = to_u32(sub_mesh_states.size());
 
-			const sg::AABB &mesh_bounds = mesh->get_bounds();
+			for (auto &sub_mesh : mesh->get_submeshes())
+			{
+				auto material = sub_mesh->get_material();
 
-			sg::AABB world_bounds{mesh_bounds.get_min(), mesh_bounds.get_max()};
-			world_bounds.transform(node_transform);
+				size_t pipeline_hash = sub_mesh->get_shader_variant().get_id();
+				hash_combine(pipeline_hash, material->double_sided);
+				hash_combine(pipeline_hash, material->alpha_mode);
 
-			float distance = glm::length(glm::vec3(camera_transform[3]) - world_bounds.get_center());
+				uint32_t pipeline_id = pipeline_ids.emplace(pipeline_hash, to_u32(pipeline_ids.size())).first->second;
+				uint32_t material_id = material_ids.emplace(material, to_u32(material_ids.size())).first->second;
 
-			for (auto &sub_mesh : mesh->get_submeshes())
+				// Bit 16 is left for the front face of the node
+				sub_mesh_states.push_back((pipeline_id << 17) | (material_id & 0xFFFF));
+			}
+
+			for (auto &node : mesh->get_nodes())
 			{
-				if (sub_mesh->get_material()->alpha_mode == sg::AlphaMode::Blend)
-				{
-					transparent_nodes.emplace(distance, std::make_pair(node, sub_mesh));
-				}
-				else
-				{
-					opaque_nodes.emplace(distance, std::make_pair(node, sub_mesh));
-				}
+				// Force the bounds to be computed on the first draw
+				mesh_instances.push_back({mesh, node, ~0U, first_sub_mesh_state});
 			}
 		}
+
+		for (size_t axis = 0; axis < 3; axis++)
+		{
+			bounds_center[axis].resize(mesh_instances.size());
+			bounds_extent[axis].resize(mesh_instances.size());
+		}
+
+		instance_visible.resize(mesh_instances.size());
 	}
+
+	for (size_t i = 0; i < mesh_instances.size(); i++)
+	{
+		auto &instance  = mesh_instances[i];
+		auto &transform = instance.node->get_transform();
+
+		uint32_t version = transform.get_world_matrix_version();
+		if (version == instance.world_matrix_version)
+		{
+			continue;
+		}
+
+		const sg::AABB &mesh_bounds = instance.mesh->get_bounds();
+
+		glm::mat4 world_matrix = transform.get_world_matrix();
+
+		// The world box of a transformed box is centered on the transformed center,
+		// and its half extent is the local half extent scaled by the absolute matrix
+		glm::vec3 center = glm::vec3(world_matrix * glm::vec4(mesh_bounds.get_center(), 1.0f));
+		glm::vec3 extent = glm::mat3(glm::abs(world_matrix[0]), glm::abs(world_matrix[1]), glm::abs(world_matrix[2])) * (mesh_bounds.get_scale() * 0.5f);
+
+		for (size_t axis = 0; axis < 3; axis++)
+		{
+			bounds_center[axis][i] = center[axis];
+			bounds_extent[axis][i] = extent[axis];
+		}
+
+		instance.world_matrix_version = version;
+	}
+
+	if (!frustum_culling)
+	{
+		std::fill(instance_visible.begin(), instance_visible.end(), uint8_t(1));
+		return;
+	}
+
+	Frustum frustum;
+	frustum.update(vkb::vulkan_style_projection(camera.get_projection()) * camera.get_view());
+
+	frustum.check_boxes({bounds_center[0].data(), bounds_center[1].data(), bounds_center[2].data()},
+	                    {bounds_extent[0].data(), bounds_extent[1].data(), bounds_extent[2].data()},
+	                    mesh_instances.size(), instance_visible.data());
 }
 
-void GeometrySubpass::draw(CommandBuffer &command_buffer)
+void GeometrySubpass::get_sorted_nodes(DrawList &opaque_draws, DrawList &transparent_draws)
 {
-	std::multimap<float, std::pair<sg::Node *, sg::SubMesh *>> opaque_nodes;
-	std::multimap<float, std::pair<sg::Node *, sg::SubMesh *>> transparent_nodes;
+	cull_mesh_instances();
+
+	opaque_draws.clear();
+	transparent_draws.clear();
 
-	get_sorted_nodes(opaque_nodes, transparent_nodes);
+	glm::vec3 camera_position = glm::vec3(camera.get_node()->get_transform().get_world_matrix()[3]);
 
-	// Draw opaque objects in front-to-back order
-	for (auto node_it = opaque_nodes.begin(); node_it != opaque_nodes.end(); node_it++)
+	size_t culled_submeshes = 0;
+
+	for (size_t i = 0; i < mesh_instances.size(); i++)
 	{
-		update_uniform(command_buffer, *node_it->second.first, thread_index);
+		auto &instance = mesh_instances[i];
+
+		if (!instance_visible[i])
+		{
+			culled_submeshes += instance.mesh->get_submeshes().size();
+			continue;
+		}
+
+		glm::vec3 center{bounds_center[0][i], bounds_center[1][i], bounds_center[2][i]};
+
+		float distance = glm::length(camera_position - center);
+
+		// Flipped nodes are drawn with the opposite front face, hence another pipeline
+		const auto &scale     = instance.node->get_transform().get_scale();
+		uint32_t    front_bit = scale.x * scale.y * scale.z < 0 ? (1U << 16) : 0U;
+
+		const auto &sub_meshes = instance.mesh->get_submeshes();
+
+		for (size_t j = 0; j < sub_meshes.size(); j++)
+		{
+			auto &sub_mesh = *sub_meshes[j];
+
+			uint32_t state = sub_mesh_states[instance.first_sub_mesh_state + j];
+
+			if (sub_mesh.get_material()->alpha_mode == sg::AlphaMode::Blend)
+			{
+				transparent_draws.add(DrawList::back_to_front_key(state, distance), *instance.node, sub_mesh);
+			}
+			else
+			{
+				opaque_draws.add(DrawList::state_then_depth_key(state | front_bit, distance), *instance.node, sub_mesh);
+			}
+		}
+	}
+
+	opaque_draws.sort();
+	transparent_draws.sort();
+
+	render_context.get_active_frame().add_to_counter(StatIndex::culled_submeshes, static_cast<float>(culled_submeshes));
+}
+
+void GeometrySubpass::draw(CommandBuffer &command_buffer)
+{
+	get_sorted_nodes(opaque_draws, transparent_draws);
+
+	// Draw opaque objects grouped by render state, in front-to-back order within each group
+	for (auto &draw : opaque_draws)
+	{
+		update_uniform(command_buffer, *draw.node, thread_index);
 
 		// Invert the front face if the mesh was flipped
-		const auto &scale      = node_it->second.first->get_transform().get_scale();
+		const auto &scale      = draw.node->get_transform().get_scale();
 		bool        flipped    = scale.x * scale.y * scale.z < 0;
 		VkFrontFace front_face = flipped ? VK_FRONT_FACE_CLOCKWISE : VK_FRONT_FACE_COUNTER_CLOCKWISE;
 
-		draw_submesh(command_buffer, *node_it->second.second, front_face);
+		draw_submesh(command_buffer, *draw.sub_mesh, front_face);
 	}
 
 	// Enable alpha blending
@@ -123,11 +237,11 @@ void GeometrySubpass::draw(CommandBuffer &command_buffer)
 	command_buffer.set_depth_stencil_state(get_depth_stencil_state());
 
 	// Draw transparent objects in back-to-front order
-	for (auto node_it = transparent_nodes.rbegin(); node_it != transparent_nodes.rend(); node_it++)
+	for (auto &draw : transparent_draws)
 	{
-		update_uniform(command_buffer, *node_it->second.first, thread_index);
+		update_uniform(command_buffer, *draw.node, thread_index);
 
-		draw_submesh(command_buffer, *node_it->second.second);
+		draw_submesh(command_buffer, *draw.sub_mesh);
 	}
 }
 
@@ -189,6 +303,8 @@ void GeometrySubpass::draw_submesh(CommandBuffer &command_buffer, sg::SubMesh &s
 
 	VertexInputState vertex_input_state;
 
+	bool interleaved = sub_mesh.interleaved_vertex_buffer.buffer != nullptr;
+
 	for (auto &input_resource : vertex_input_resources)
 	{
 		sg::VertexAttribute attribute;
@@ -198,35 +314,56 @@ void GeometrySubpass::draw_submesh(CommandBuffer &command_buffer, sg::SubMesh &s
 			continue;
 		}
 
+		// Interleaved attributes are all read from binding 0
+		uint32_t binding = interleaved ? 0 : input_resource.location;
+
 		VkVertexInputAttributeDescription vertex_attribute{};
-		vertex_attribute.binding  = input_resource.location;
+		vertex_attribute.binding  = binding;
 		vertex_attribute.format   = attribute.format;
 		vertex_attribute.location = input_resource.location;
 		vertex_attribute.offset   = attribute.offset;
 
 		vertex_input_state.attributes.push_back(vertex_attribute);
 
-		VkVertexInputBindingDescription vertex_binding{};
-		vertex_binding.binding = input_resource.location;
-		vertex_binding.stride  = attribute.stride;
+		if (!interleaved || vertex_input_state.bindings.empty())
+		{
+			VkVertexInputBindingDescription vertex_binding{};
+			vertex_binding.binding = binding;
+			vertex_binding.stride  = attribute.stride;
 
-		vertex_input_state.bindings.push_back(vertex_binding);
+			vertex_input_state.bindings.push_back(vertex_binding);
+		}
 	}
 
 	command_buffer.set_vertex_input_state(vertex_input_state);
 
-	// Find submesh vertex buffers matching the shader input attribute names
-	for (auto &input_resource : vertex_input_resources)
+	if (interleaved)
 	{
-		const auto &buffer_iter = sub_mesh.vertex_buffers.find(input_resource.name);
-
-		if (buffer_iter != sub_mesh.vertex_buffers.end())
+		command_buffer.bind_vertex_buffers(0, {std::ref(*sub_mesh.interleaved_vertex_buffer.buffer)}, {sub_mesh.interleaved_vertex_buffer.offset});
+	}
+	else
+	{
+		// Find submesh vertex buffers matching the shader input attribute names
+		for (auto &input_resource : vertex_input_resources)
 		{
-			std::vector<std::reference_wrapper<const core::Buffer>> buffers;
-			buffers.emplace_back(std::ref(buffer_iter->second));
+			const auto &packed_iter = sub_mesh.packed_vertex_buffers.find(input_resource.name);
+
+			if (packed_iter != sub_mesh.packed_vertex_buffers.end())
+			{
+				command_buffer.bind_vertex_buffers(input_resource.location, {std::ref(*packed_iter->second.buffer)}, {packed_iter->second.offset});
+				continue;
+			}
+
+			const auto &buffer_iter = sub_mesh.vertex_buffers.find(input_resource.name);
+
+			if (buffer_iter != sub_mesh.vertex_buffers.end())
+			{
+				std::vector<std::reference_wrapper<const core::Buffer>> buffers;
+				buffers.emplace_back(std::ref(buffer_iter->second));
 
-			// Bind vertex buffers only for the attribute locations defined
-			command_buffer.bind_vertex_buffers(input_resource.location, std::move(buffers), {0});
+				// Bind vertex buffers only for the attribute locations defined
+				command_buffer.bind_vertex_buffers(input_resource.location, std::move(buffers), {0});
+			}
 		}
 	}
 
@@ -287,7 +424,14 @@ void GeometrySubpass::draw_submesh_command(CommandBuffer &command_buffer, sg::Su
 	if (sub_mesh.vertex_indices != 0)
 	{
 		// Bind index buffer of submesh
-		command_buffer.bind_index_buffer(*sub_mesh.index_buffer, sub_mesh.index_offset, sub_mesh.index_type);
+		if (sub_mesh.packed_index_buffer.buffer)
+		{
+			command_buffer.bind_index_buffer(*sub_mesh.packed_index_buffer.buffer, sub_mesh.packed_index_buffer.offset + sub_mesh.index_offset, sub_mesh.index_type);
+		}
+		else
+		{
+			command_buffer.bind_index_buffer(*sub_mesh.index_buffer, sub_mesh.index_offset, sub_mesh.index_type);
+		}
 
 		// Draw submesh using indexed data
 		command_buffer.draw_indexed(sub_mesh.vertex_indices, 1, 0, 0, 0);
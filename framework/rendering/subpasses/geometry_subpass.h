@@ -17,12 +17,15 @@
 
 #pragma once
 
+#include <array>
+
 #include "common/error.h"
 
 VKBP_DISABLE_WARNINGS()
 #include "common/glm_common.h"
 VKBP_ENABLE_WARNINGS()
 
+#include "rendering/draw_list.h"
 #include "rendering/subpass.h"
 
 namespace vkb
@@ -90,6 +93,11 @@ class GeometrySubpass : public Subpass
 	 */
 	void set_thread_index(uint32_t index);
 
+	/**
+	 * @brief Enables skipping the meshes whose world bounds are outside the camera frustum
+	 */
+	void set_frustum_culling(bool enable);
+
   protected:
 	virtual void update_uniform(CommandBuffer &command_buffer, sg::Node &node, size_t thread_index = 0);
 
@@ -104,11 +112,16 @@ class GeometrySubpass : public Subpass
 	virtual void draw_submesh_command(CommandBuffer &command_buffer, sg::SubMesh &sub_mesh);
 
 	/**
-	 * @brief Sorts objects based on distance from camera and classifies them
-	 *        into opaque and transparent in the arrays provided
+	 * @brief Sorts objects based on distance from camera and render state,
+	 *        and classifies them into opaque and transparent in the lists provided
 	 */
-	void get_sorted_nodes(std::multimap<float, std::pair<sg::Node *, sg::SubMesh *>> &opaque_nodes,
-	                      std::multimap<float, std::pair<sg::Node *, sg::SubMesh *>> &transparent_nodes);
+	void get_sorted_nodes(DrawList &opaque_draws, DrawList &transparent_draws);
+
+	/**
+	 * @brief Updates the world bounds of the mesh instances whose node moved,
+	 *        and flags the ones which intersect the camera frustum
+	 */
+	void cull_mesh_instances();
 
 	sg::Camera &camera;
 
@@ -117,6 +130,44 @@ class GeometrySubpass : public Subpass
 	sg::Scene &scene;
 
 	uint32_t thread_index{0};
+
+	/**
+	 * @brief A mesh drawn at a node of the scene
+	 */
+	struct MeshInstance
+	{
+		sg::Mesh *mesh;
+
+		sg::Node *node;
+
+		/// Version of the node world matrix the bounds were computed with
+		uint32_t world_matrix_version;
+
+		/// Index in sub_mesh_states of the state of the first submesh of the mesh
+		uint32_t first_sub_mesh_state;
+	};
+
+	/// Every node of every mesh, gathered on the first draw
+	std::vector<MeshInstance> mesh_instances;
+
+	/// World bounds of the mesh instances, as arrays of the x, y and z components of their centers
+	std::array<std::vector<float>, 3> bounds_center;
+
+	/// World bounds of the mesh instances, as arrays of the x, y and z components of their half extents
+	std::array<std::vector<float>, 3> bounds_extent;
+
+	/// Whether each mesh instance intersects the camera frustum in the current draw
+	std::vector<uint8_t> instance_visible;
+
+	bool frustum_culling{true};
+
+	/// Render state of each submesh, with the pipeline in the high bits and the material in the low 16 bits
+	std::vector<uint32_t> sub_mesh_states;
+
+	/// Reused every frame, so that sorting the draws does not allocate
+	DrawList opaque_draws;
+
+	DrawList transparent_draws;
 };
 
 }        // namespace vkb
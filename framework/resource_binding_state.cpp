@@ -17,8 +17,38 @@
 
 #include "resource_binding_state.h"
 
+#include "common/helpers.h"
+
 namespace vkb
 {
+namespace
+{
+size_t hash_resource_info(uint32_t binding, uint32_t array_element, const ResourceInfo &resource_info)
+{
+	size_t hash{0};
+
+	hash_combine(hash, binding);
+	hash_combine(hash, array_element);
+	hash_combine(hash, resource_info.range);
+
+	// Handles rather than pointers, as objects can be recreated at the same address
+	if (resource_info.buffer)
+	{
+		hash_combine(hash, resource_info.buffer->get_handle());
+	}
+	if (resource_info.image_view)
+	{
+		hash_combine(hash, resource_info.image_view->get_handle());
+	}
+	if (resource_info.sampler)
+	{
+		hash_combine(hash, resource_info.sampler->get_handle());
+	}
+
+	return hash;
+}
+}        // namespace
+
 void ResourceBindingState::reset()
 {
 	clear_dirty();
@@ -79,6 +109,8 @@ void ResourceSet::reset()
 	clear_dirty();
 
 	resource_bindings.clear();
+
+	hash = 0;
 }
 
 bool ResourceSet::is_dirty() const
@@ -98,36 +130,52 @@ void ResourceSet::clear_dirty(uint32_t binding, uint32_t array_element)
 
 void ResourceSet::bind_buffer(const core::Buffer &buffer, VkDeviceSize offset, VkDeviceSize range, uint32_t binding, uint32_t array_element)
 {
-	resource_bindings[binding][array_element].dirty  = true;
-	resource_bindings[binding][array_element].buffer = &buffer;
-	resource_bindings[binding][array_element].offset = offset;
-	resource_bindings[binding][array_element].range  = range;
+	auto &resource_info = remove_from_hash(binding, array_element);
+
+	resource_info.dirty  = true;
+	resource_info.buffer = &buffer;
+	resource_info.offset = offset;
+	resource_info.range  = range;
+
+	add_to_hash(binding, array_element, resource_info);
 
 	dirty = true;
 }
 
 void ResourceSet::bind_image(const core::ImageView &image_view, const core::Sampler &sampler, uint32_t binding, uint32_t array_element)
 {
-	resource_bindings[binding][array_element].dirty      = true;
-	resource_bindings[binding][array_element].image_view = &image_view;
-	resource_bindings[binding][array_element].sampler    = &sampler;
+	auto &resource_info = remove_from_hash(binding, array_element);
+
+	resource_info.dirty      = true;
+	resource_info.image_view = &image_view;
+	resource_info.sampler    = &sampler;
+
+	add_to_hash(binding, array_element, resource_info);
 
 	dirty = true;
 }
 
 void ResourceSet::bind_image(const core::ImageView &image_view, uint32_t binding, uint32_t array_element)
 {
-	resource_bindings[binding][array_element].dirty      = true;
-	resource_bindings[binding][array_element].image_view = &image_view;
-	resource_bindings[binding][array_element].sampler    = nullptr;
+	auto &resource_info = remove_from_hash(binding, array_element);
+
+	resource_info.dirty      = true;
+	resource_info.image_view = &image_view;
+	resource_info.sampler    = nullptr;
+
+	add_to_hash(binding, array_element, resource_info);
 
 	dirty = true;
 }
 
 void ResourceSet::bind_input(const core::ImageView &image_view, const uint32_t binding, const uint32_t array_element)
 {
-	resource_bindings[binding][array_element].dirty      = true;
-	resource_bindings[binding][array_element].image_view = &image_view;
+	auto &resource_info = remove_from_hash(binding, array_element);
+
+	resource_info.dirty      = true;
+	resource_info.image_view = &image_view;
+
+	add_to_hash(binding, array_element, resource_info);
 
 	dirty = true;
 }
@@ -137,4 +185,25 @@ const BindingMap<ResourceInfo> &ResourceSet::get_resource_bindings() const
 	return resource_bindings;
 }
 
+size_t ResourceSet::get_hash() const
+{
+	return hash;
+}
+
+ResourceInfo &ResourceSet::remove_from_hash(uint32_t binding, uint32_t array_element)
+{
+	auto &resource_info = resource_bindings[binding][array_element];
+
+	// XOR makes the hash independent of the order of the bindings, and lets
+	// a binding be replaced without hashing the others again
+	hash ^= hash_resource_info(binding, array_element, resource_info);
+
+	return resource_info;
+}
+
+void ResourceSet::add_to_hash(uint32_t binding, uint32_t array_element, const ResourceInfo &resource_info)
+{
+	hash ^= hash_resource_info(binding, array_element, resource_info);
+}
+
 }        // namespace vkb
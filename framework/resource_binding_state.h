@@ -71,10 +71,26 @@ class ResourceSet
 
 	const BindingMap<ResourceInfo> &get_resource_bindings() const;
 
+	/**
+	 * @brief Hash of the Vulkan handles and ranges of all the bindings, updated on every bind
+	 *        Offsets are left out, as dynamic offsets are not part of a descriptor set
+	 */
+	size_t get_hash() const;
+
   private:
 	bool dirty{false};
 
 	BindingMap<ResourceInfo> resource_bindings;
+
+	size_t hash{0};
+
+	/**
+	 * @brief Returns the resource info of a binding, removing its contribution from the hash
+	 *        until the binding is updated and added back with add_to_hash
+	 */
+	ResourceInfo &remove_from_hash(uint32_t binding, uint32_t array_element);
+
+	void add_to_hash(uint32_t binding, uint32_t array_element, const ResourceInfo &resource_info);
 };
 
 /**
@@ -17,6 +17,8 @@
 
 #include "resource_cache.h"
 
+#include <ctpl_stl.h>
+
 #include "common/resource_caching.h"
 #include "core/device.h"
 
@@ -24,14 +26,98 @@ namespace vkb
 {
 namespace
 {
+/**
+ * @brief Returns the resource of the hash, creating it if it is not in the cache yet.
+ *        The creation, which may compile shaders or pipelines, runs without the mutex held,
+ *        so that the other requests of the type are not blocked. Concurrent requests of the
+ *        same resource wait for the thread creating it.
+ * @param hash Hash of the arguments, as computed by hash_param
+ */
 template <class T, class... A>
-T &request_resource(Device &device, ResourceRecord &recorder, std::mutex &resource_mutex, std::unordered_map<std::size_t, T> &resources, A &... args)
+T &request_hashed_resource(Device &device, ResourceRecord &recorder, ResourceCacheMutex &resource_mutex, std::unordered_map<std::size_t, T> &resources, std::size_t hash, A &... args)
 {
-	std::lock_guard<std::mutex> guard(resource_mutex);
+	// Most requests hit, and threads recording command buffers look up in parallel
+	{
+		std::shared_lock<std::shared_timed_mutex> guard(resource_mutex.mutex);
+
+		auto res_it = resources.find(hash);
+		if (res_it != resources.end())
+		{
+			return res_it->second;
+		}
+	}
+
+	std::promise<void>       creation;
+	std::shared_future<void> pending_creation;
+
+	{
+		std::lock_guard<std::shared_timed_mutex> guard(resource_mutex.mutex);
+
+		// Another thread may have created it before the exclusive lock was taken
+		auto res_it = resources.find(hash);
+		if (res_it != resources.end())
+		{
+			return res_it->second;
+		}
+
+		auto creation_it = resource_mutex.creations.find(hash);
+		if (creation_it != resource_mutex.creations.end())
+		{
+			pending_creation = creation_it->second;
+		}
+		else
+		{
+			resource_mutex.creations.emplace(hash, creation.get_future().share());
+		}
+	}
+
+	if (pending_creation.valid())
+	{
+		// Rethrows the error of the thread creating the resource, if any
+		pending_creation.get();
+
+		std::shared_lock<std::shared_timed_mutex> guard(resource_mutex.mutex);
+		return resources.at(hash);
+	}
+
+	LOGD("Building cache object ({})", typeid(T).name());
+
+	try
+	{
+		T resource(device, args...);
+
+		std::lock_guard<std::shared_timed_mutex> guard(resource_mutex.mutex);
+
+		auto &inserted = insert_resource(&recorder, resources, hash, std::move(resource), args...);
+
+		resource_mutex.creations.erase(hash);
+		creation.set_value();
+
+		return inserted;
+	}
+	catch (const std::exception &e)
+	{
+		LOGE("Creation error for cache object ({}): {}", typeid(T).name(), e.what());
+
+		// Let the next request of the resource try again
+		{
+			std::lock_guard<std::shared_timed_mutex> guard(resource_mutex.mutex);
+			resource_mutex.creations.erase(hash);
+		}
 
-	auto &res = request_resource(device, &recorder, resources, args...);
+		creation.set_exception(std::current_exception());
+		throw;
+	}
+}
+
+template <class T, class... A>
+T &request_resource(Device &device, ResourceRecord &recorder, ResourceCacheMutex &resource_mutex, std::unordered_map<std::size_t, T> &resources, A &... args)
+{
+	// Hashing once, outside of the lock, keeps the critical sections to the map lookups
+	std::size_t hash{0U};
+	hash_param(hash, args...);
 
-	return res;
+	return request_hashed_resource(device, recorder, resource_mutex, resources, hash, args...);
 }
 }        // namespace
 
@@ -40,11 +126,20 @@ ResourceCache::ResourceCache(Device &device) :
 {
 }
 
+ResourceCache::~ResourceCache()
+{
+	wait_async_pipelines();
+}
+
 void ResourceCache::warmup(const std::vector<uint8_t> &data)
 {
-	recorder.set_data(data);
+	// Replaying through the cache records the resources again, so the stream
+	// being replayed is kept apart from the one written by the cache
+	ResourceRecord record;
+	record.set_data(data);
 
-	replayer.play(*this, recorder);
+	ResourceReplay replayer;
+	replayer.play(*this, record);
 }
 
 std::vector<uint8_t> ResourceCache::serialize()
@@ -80,6 +175,139 @@ GraphicsPipeline &ResourceCache::request_graphics_pipeline(PipelineState &pipeli
 	return request_resource(device, recorder, graphics_pipeline_mutex, state.graphics_pipelines, pipeline_cache, pipeline_state);
 }
 
+void ResourceCache::set_async_pipelines(bool enabled)
+{
+	if (enabled && !pipeline_thread_pool)
+	{
+		// Leave cores to the render thread and the driver
+		auto thread_count    = std::max(1u, std::thread::hardware_concurrency() / 2);
+		pipeline_thread_pool = std::make_unique<ctpl::thread_pool>(thread_count);
+	}
+
+	async_pipelines = enabled;
+}
+
+bool ResourceCache::is_async_pipelines() const
+{
+	return async_pipelines;
+}
+
+GraphicsPipeline *ResourceCache::request_graphics_pipeline_async(PipelineState &pipeline_state, AsyncGraphicsPipeline **async_pipeline)
+{
+	if (!async_pipelines)
+	{
+		return &request_graphics_pipeline(pipeline_state);
+	}
+
+	// Same hash as request_resource
+	std::size_t hash{0U};
+	hash_param(hash, pipeline_cache, pipeline_state);
+
+	AsyncGraphicsPipeline *entry{nullptr};
+
+	{
+		std::shared_lock<std::shared_timed_mutex> guard(async_pipeline_mutex);
+
+		auto it = async_graphics_pipelines.find(hash);
+		if (it != async_graphics_pipelines.end())
+		{
+			entry = &it->second;
+		}
+	}
+
+	if (!entry)
+	{
+		std::unique_lock<std::shared_timed_mutex> guard(async_pipeline_mutex);
+
+		auto inserted = async_graphics_pipelines.emplace(std::piecewise_construct, std::forward_as_tuple(hash), std::forward_as_tuple());
+		entry         = &inserted.first->second;
+
+		// Unless another thread queued the pipeline in the meantime
+		if (inserted.second)
+		{
+			queue_graphics_pipeline(*entry, hash, pipeline_state);
+		}
+	}
+
+	if (async_pipeline)
+	{
+		*async_pipeline = entry;
+	}
+
+	return poll_graphics_pipeline(*entry, pipeline_state);
+}
+
+GraphicsPipeline *ResourceCache::poll_graphics_pipeline(AsyncGraphicsPipeline &async_pipeline, PipelineState &pipeline_state)
+{
+	auto pipeline = async_pipeline.pipeline.load(std::memory_order_acquire);
+
+	if (!pipeline && async_pipeline.failed.load(std::memory_order_acquire))
+	{
+		pipeline = &request_graphics_pipeline(pipeline_state);
+		async_pipeline.pipeline.store(pipeline, std::memory_order_release);
+	}
+
+	return pipeline;
+}
+
+void ResourceCache::queue_graphics_pipeline(AsyncGraphicsPipeline &async_pipeline, std::size_t hash, const PipelineState &pipeline_state)
+{
+	// Pipelines created synchronously, for example by warmup(), are used straight away
+	{
+		std::shared_lock<std::shared_timed_mutex> pipeline_lock(graphics_pipeline_mutex.mutex);
+
+		auto pipeline_it = state.graphics_pipelines.find(hash);
+		if (pipeline_it != state.graphics_pipelines.end())
+		{
+			async_pipeline.pipeline.store(&pipeline_it->second, std::memory_order_release);
+			return;
+		}
+	}
+
+	// Drop the tasks that completed
+	async_pipeline_tasks.erase(std::remove_if(async_pipeline_tasks.begin(), async_pipeline_tasks.end(),
+	                                          [](std::future<void> &task) { return task.wait_for(std::chrono::seconds(0)) == std::future_status::ready; }),
+	                           async_pipeline_tasks.end());
+
+	async_pipeline_tasks.push_back(pipeline_thread_pool->push([this, &async_pipeline, hash, requested_state = pipeline_state](int) mutable {
+		try
+		{
+			// The pipeline is compiled without the lock of the cache, so the workers compile in parallel
+			auto &pipeline = request_hashed_resource(device, recorder, graphics_pipeline_mutex, state.graphics_pipelines, hash, pipeline_cache, requested_state);
+
+			async_pipeline.pipeline.store(&pipeline, std::memory_order_release);
+		}
+		catch (const std::exception &e)
+		{
+			LOGE("Failed to compile pipeline asynchronously, it will be compiled synchronously: {}", e.what());
+
+			async_pipeline.failed.store(true, std::memory_order_release);
+		}
+	}));
+}
+
+void ResourceCache::wait_async_pipelines()
+{
+	std::lock_guard<std::shared_timed_mutex> guard(async_pipeline_mutex);
+
+	wait_async_pipeline_tasks();
+}
+
+void ResourceCache::wait_async_pipeline_tasks()
+{
+	for (auto &task : async_pipeline_tasks)
+	{
+		task.wait();
+	}
+
+	async_pipeline_tasks.clear();
+}
+
+uint32_t ResourceCache::get_pipeline_generation() const
+{
+	return pipeline_generation.load(std::memory_order_acquire);
+}
+
 ComputePipeline &ResourceCache::request_compute_pipeline(PipelineState &pipeline_state)
 {
 	return request_resource(device, recorder, compute_pipeline_mutex, state.compute_pipelines, pipeline_cache, pipeline_state);
@@ -87,7 +315,7 @@ ComputePipeline &ResourceCache::request_compute_pipeline(PipelineState &pipeline
 
 DescriptorSet &ResourceCache::request_descriptor_set(DescriptorSetLayout &descriptor_set_layout, const BindingMap<VkDescriptorBufferInfo> &buffer_infos, const BindingMap<VkDescriptorImageInfo> &image_infos)
 {
-	auto &descriptor_pool = request_resource(device, recorder, descriptor_set_mutex, state.descriptor_pools, descriptor_set_layout);
+	auto &descriptor_pool = request_resource(device, recorder, descriptor_pool_mutex, state.descriptor_pools, descriptor_set_layout);
 	return request_resource(device, recorder, descriptor_set_mutex, state.descriptor_sets, descriptor_set_layout, descriptor_pool, buffer_infos, image_infos);
 }
 
@@ -103,8 +331,24 @@ Framebuffer &ResourceCache::request_framebuffer(const RenderTarget &render_targe
 
 void ResourceCache::clear_pipelines()
 {
-	state.graphics_pipelines.clear();
-	state.compute_pipelines.clear();
+	// Requests of asynchronous pipelines wait until the entries they could return are cleared
+	std::lock_guard<std::shared_timed_mutex> guard(async_pipeline_mutex);
+
+	wait_async_pipeline_tasks();
+	async_graphics_pipelines.clear();
+
+	{
+		std::lock_guard<std::shared_timed_mutex> graphics_guard(graphics_pipeline_mutex.mutex);
+		state.graphics_pipelines.clear();
+	}
+
+	{
+		std::lock_guard<std::shared_timed_mutex> compute_guard(compute_pipeline_mutex.mutex);
+		state.compute_pipelines.clear();
+	}
+
+	// Command buffers drop the entries of their pending pipelines, which were cleared
+	pipeline_generation.fetch_add(1, std::memory_order_acq_rel);
 }
 
 void ResourceCache::update_descriptor_sets(const std::vector<core::ImageView> &old_views, const std::vector<core::ImageView> &new_views)
@@ -199,12 +443,14 @@ void ResourceCache::clear_framebuffers()
 
 void ResourceCache::clear()
 {
+	// The pipelines compiling asynchronously use the other resources
+	clear_pipelines();
+
 	state.shader_modules.clear();
 	state.pipeline_layouts.clear();
 	state.descriptor_sets.clear();
 	state.descriptor_set_layouts.clear();
 	state.render_passes.clear();
-	clear_pipelines();
 	clear_framebuffers();
 }
 
@@ -17,6 +17,9 @@
 
 #pragma once
 
+#include <atomic>
+#include <future>
+#include <shared_mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -30,6 +33,11 @@
 #include "resource_record.h"
 #include "resource_replay.h"
 
+namespace ctpl
+{
+class thread_pool;
+}
+
 namespace vkb
 {
 class Device;
@@ -39,6 +47,30 @@ namespace core
 class ImageView;
 }
 
+/**
+ * @brief A graphics pipeline requested asynchronously, see ResourceCache::request_graphics_pipeline_async()
+ */
+struct AsyncGraphicsPipeline
+{
+	/// Published by the worker thread once the pipeline is created
+	std::atomic<GraphicsPipeline *> pipeline{nullptr};
+
+	/// Set by the worker thread if the creation failed, the pipeline is then created synchronously when polled
+	std::atomic<bool> failed{false};
+};
+
+/**
+ * @brief Synchronizes the requests of one type of resource in the ResourceCache
+ */
+struct ResourceCacheMutex
+{
+	/// Lookups take it in shared mode, insertions in exclusive mode
+	std::shared_timed_mutex mutex;
+
+	/// Resources being created without the mutex held, which other requests of the same resource wait for
+	std::unordered_map<std::size_t, std::shared_future<void>> creations;
+};
+
 /**
  * @brief Struct to hold the internal state of the Resource Cache
  *
@@ -89,8 +121,18 @@ class ResourceCache
 
 	ResourceCache &operator=(ResourceCache &&) = delete;
 
+	~ResourceCache();
+
+	/**
+	 * @brief Creates the resources recorded in a previous run, see serialize()
+	 *        It can run on a different thread than the one requesting resources
+	 * @param data Recorded stream of resources
+	 */
 	void warmup(const std::vector<uint8_t> &data);
 
+	/**
+	 * @return Recorded stream of the resources created so far, including those of warmup()
+	 */
 	std::vector<uint8_t> serialize();
 
 	void set_pipeline_cache(VkPipelineCache pipeline_cache);
@@ -105,6 +147,45 @@ class ResourceCache
 
 	GraphicsPipeline &request_graphics_pipeline(PipelineState &pipeline_state);
 
+	/**
+	 * @brief Makes request_graphics_pipeline_async() compile the pipelines it misses on worker threads
+	 *        Otherwise it compiles them on the calling thread, as request_graphics_pipeline() does
+	 */
+	void set_async_pipelines(bool enabled);
+
+	bool is_async_pipelines() const;
+
+	/**
+	 * @brief Returns the graphics pipeline for the state if it is ready, without waiting
+	 *        for the pipelines being compiled on the worker threads
+	 * @param pipeline_state The state of the pipeline
+	 * @param[out] async_pipeline If not null, set to the entry of the pipeline when it is requested
+	 *             asynchronously, which poll_graphics_pipeline() checks without hashing the state again
+	 * @return The pipeline, or nullptr if it is being compiled
+	 */
+	GraphicsPipeline *request_graphics_pipeline_async(PipelineState &pipeline_state, AsyncGraphicsPipeline **async_pipeline = nullptr);
+
+	/**
+	 * @brief Returns a graphics pipeline requested asynchronously if it is ready. If its
+	 *        creation failed on the worker thread, creates it synchronously instead, which
+	 *        throws the error if it persists.
+	 * @param async_pipeline The entry of the pipeline, valid until clear_pipelines(), see get_pipeline_generation()
+	 * @param pipeline_state The state the pipeline was requested with
+	 * @return The pipeline, or nullptr if it is still being compiled
+	 */
+	GraphicsPipeline *poll_graphics_pipeline(AsyncGraphicsPipeline &async_pipeline, PipelineState &pipeline_state);
+
+	/**
+	 * @brief Waits for the graphics pipelines queued by request_graphics_pipeline_async()
+	 */
+	void wait_async_pipelines();
+
+	/**
+	 * @return Incremented by clear_pipelines(), after which the entries of the pipelines
+	 *         requested asynchronously before must not be polled
+	 */
+	uint32_t get_pipeline_generation() const;
+
 	ComputePipeline &request_compute_pipeline(PipelineState &pipeline_state);
 
 	DescriptorSet &request_descriptor_set(DescriptorSetLayout &                     descriptor_set_layout,
@@ -136,26 +217,53 @@ class ResourceCache
 
 	ResourceRecord recorder;
 
-	ResourceReplay replayer;
-
 	VkPipelineCache pipeline_cache{VK_NULL_HANDLE};
 
 	ResourceCacheState state;
 
-	std::mutex descriptor_set_mutex;
+	/// Resources are created outside of these, so that a miss does not block the lookups of its type
+	ResourceCacheMutex descriptor_pool_mutex;
+
+	ResourceCacheMutex descriptor_set_mutex;
+
+	ResourceCacheMutex pipeline_layout_mutex;
+
+	ResourceCacheMutex shader_module_mutex;
+
+	ResourceCacheMutex descriptor_set_layout_mutex;
+
+	ResourceCacheMutex graphics_pipeline_mutex;
+
+	ResourceCacheMutex render_pass_mutex;
+
+	ResourceCacheMutex compute_pipeline_mutex;
+
+	ResourceCacheMutex framebuffer_mutex;
+
+	bool async_pipelines{false};
 
-	std::mutex pipeline_layout_mutex;
+	/// Guards async_graphics_pipelines and async_pipeline_tasks, lookups take it in shared mode
+	std::shared_timed_mutex async_pipeline_mutex;
 
-	std::mutex shader_module_mutex;
+	/// Pipelines requested asynchronously, the entries are not moved until clear_pipelines()
+	std::unordered_map<std::size_t, AsyncGraphicsPipeline> async_graphics_pipelines;
 
-	std::mutex descriptor_set_layout_mutex;
+	std::vector<std::future<void>> async_pipeline_tasks;
 
-	std::mutex graphics_pipeline_mutex;
+	std::atomic<uint32_t> pipeline_generation{0};
 
-	std::mutex render_pass_mutex;
+	/// Destroyed first, so that running tasks finish before the pipelines they create
+	std::unique_ptr<ctpl::thread_pool> pipeline_thread_pool;
 
-	std::mutex compute_pipeline_mutex;
+	/**
+	 * @brief Queues the creation of a pipeline on the worker threads, or publishes it straight
+	 *        away if it has already been created synchronously. Requires async_pipeline_mutex.
+	 */
+	void queue_graphics_pipeline(AsyncGraphicsPipeline &async_pipeline, std::size_t hash, const PipelineState &pipeline_state);
 
-	std::mutex framebuffer_mutex;
+	/**
+	 * @brief Waits for the tasks of the worker threads. Requires async_pipeline_mutex.
+	 */
+	void wait_async_pipeline_tasks();
 };
 }        // namespace vkb
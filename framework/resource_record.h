@@ -17,33 +17,53 @@
 
 #pragma once
 
+#include <mutex>
 #include <vector>
 
 #include "rendering/pipeline_state.h"
 
 namespace vkb
 {
+class ComputePipeline;
+class DescriptorSetLayout;
 class GraphicsPipeline;
 class PipelineLayout;
 class RenderPass;
 class ShaderModule;
+struct ShaderResource;
 
 enum class ResourceType
 {
 	ShaderModule,
 	PipelineLayout,
 	RenderPass,
-	GraphicsPipeline
+	GraphicsPipeline,
+	DescriptorSetLayout,
+	ComputePipeline
 };
 
 /**
  * @brief Writes Vulkan objects in a memory stream.
+ *        Resources of different types can be registered from different threads.
  */
 class ResourceRecord
 {
   public:
+	/// Identifies the data returned by get_data()
+	static constexpr uint32_t MAGIC{0x52424b56};
+
+	/// Must be increased whenever the way resources are written changes
+	static constexpr uint32_t VERSION{4};
+
+	/**
+	 * @brief Sets the stream to data previously returned by get_data()
+	 * @throws std::runtime_error if the data was not written by this version of the recorder
+	 */
 	void set_data(const std::vector<uint8_t> &data);
 
+	/**
+	 * @return The stream, preceded by a header with the magic number and the version
+	 */
 	std::vector<uint8_t> get_data();
 
 	const std::ostringstream &get_stream();
@@ -62,6 +82,13 @@ class ResourceRecord
 	size_t register_graphics_pipeline(VkPipelineCache pipeline_cache,
 	                                  PipelineState & pipeline_state);
 
+	size_t register_descriptor_set_layout(const uint32_t                     set_index,
+	                                      const std::vector<ShaderModule *> &shader_modules,
+	                                      const std::vector<ShaderResource> &set_resources);
+
+	size_t register_compute_pipeline(VkPipelineCache pipeline_cache,
+	                                 PipelineState & pipeline_state);
+
 	void set_shader_module(size_t index, const ShaderModule &shader_module);
 
 	void set_pipeline_layout(size_t index, const PipelineLayout &pipeline_layout);
@@ -70,7 +97,13 @@ class ResourceRecord
 
 	void set_graphics_pipeline(size_t index, const GraphicsPipeline &graphics_pipeline);
 
+	void set_descriptor_set_layout(size_t index, const DescriptorSetLayout &descriptor_set_layout);
+
+	void set_compute_pipeline(size_t index, const ComputePipeline &compute_pipeline);
+
   private:
+	std::mutex mutex;
+
 	std::ostringstream stream;
 
 	std::vector<size_t> shader_module_indices;
@@ -81,6 +114,10 @@ class ResourceRecord
 
 	std::vector<size_t> graphics_pipeline_indices;
 
+	std::vector<size_t> descriptor_set_layout_indices;
+
+	std::vector<size_t> compute_pipeline_indices;
+
 	std::unordered_map<const ShaderModule *, size_t> shader_module_to_index;
 
 	std::unordered_map<const PipelineLayout *, size_t> pipeline_layout_to_index;
@@ -88,5 +125,9 @@ class ResourceRecord
 	std::unordered_map<const RenderPass *, size_t> render_pass_to_index;
 
 	std::unordered_map<const GraphicsPipeline *, size_t> graphics_pipeline_to_index;
+
+	std::unordered_map<const DescriptorSetLayout *, size_t> descriptor_set_layout_to_index;
+
+	std::unordered_map<const ComputePipeline *, size_t> compute_pipeline_to_index;
 };
 }        // namespace vkb
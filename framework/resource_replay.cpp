@@ -38,6 +38,53 @@ inline void read_subpass_info(std::istringstream &is, std::vector<SubpassInfo> &
 	}
 }
 
+inline void read_shader_resources(std::istringstream &is, std::vector<ShaderResource> &value)
+{
+	std::size_t size;
+	read(is, size);
+	value.resize(size);
+	for (ShaderResource &item : value)
+	{
+		read(is,
+		     item.stages,
+		     item.type,
+		     item.mode,
+		     item.set,
+		     item.binding,
+		     item.location,
+		     item.input_attachment_index,
+		     item.vec_size,
+		     item.columns,
+		     item.array_size,
+		     item.offset,
+		     item.size,
+		     item.constant_id,
+		     item.qualifiers,
+		     item.name);
+	}
+}
+
+/**
+ * @brief Sets the modes recorded with a pipeline layout on the resources of a shader module
+ */
+inline void set_resource_modes(ShaderModule &shader_module, const std::vector<ShaderResourceMode> &resource_modes)
+{
+	auto &resources = shader_module.get_resources();
+
+	if (resources.size() != resource_modes.size())
+	{
+		throw std::runtime_error("Recorded resource modes do not match the shader module");
+	}
+
+	for (size_t i = 0; i < resources.size(); i++)
+	{
+		if (resources[i].mode != resource_modes[i])
+		{
+			shader_module.set_resource_mode(resources[i].name, resource_modes[i]);
+		}
+	}
+}
+
 inline void read_processes(std::istringstream &is, std::vector<std::string> &value)
 {
 	std::size_t size;
@@ -55,7 +102,9 @@ ResourceReplay::ResourceReplay()
 	stream_resources[ResourceType::ShaderModule]     = std::bind(&ResourceReplay::create_shader_module, this, std::placeholders::_1, std::placeholders::_2);
 	stream_resources[ResourceType::PipelineLayout]   = std::bind(&ResourceReplay::create_pipeline_layout, this, std::placeholders::_1, std::placeholders::_2);
 	stream_resources[ResourceType::RenderPass]       = std::bind(&ResourceReplay::create_render_pass, this, std::placeholders::_1, std::placeholders::_2);
-	stream_resources[ResourceType::GraphicsPipeline] = std::bind(&ResourceReplay::create_graphics_pipeline, this, std::placeholders::_1, std::placeholders::_2);
+	stream_resources[ResourceType::GraphicsPipeline]    = std::bind(&ResourceReplay::create_graphics_pipeline, this, std::placeholders::_1, std::placeholders::_2);
+	stream_resources[ResourceType::DescriptorSetLayout] = std::bind(&ResourceReplay::create_descriptor_set_layout, this, std::placeholders::_1, std::placeholders::_2);
+	stream_resources[ResourceType::ComputePipeline]     = std::bind(&ResourceReplay::create_compute_pipeline, this, std::placeholders::_1, std::placeholders::_2);
 }
 
 void ResourceReplay::play(ResourceCache &resource_cache, ResourceRecord &recorder)
@@ -96,6 +145,7 @@ void ResourceReplay::create_shader_module(ResourceCache &resource_cache, std::is
 	std::string              entry_point;
 	std::string              preamble;
 	std::vector<std::string> processes;
+	uint32_t                 spirv_version{};
 
 	read(stream,
 	     stage,
@@ -105,9 +155,12 @@ void ResourceReplay::create_shader_module(ResourceCache &resource_cache, std::is
 
 	read_processes(stream, processes);
 
+	read(stream, spirv_version);
+
 	ShaderSource shader_source{};
 	shader_source.set_source(std::move(glsl_source));
 	ShaderVariant shader_variant(std::move(preamble), std::move(processes));
+	shader_variant.set_spirv_version(spirv_version);
 
 	auto &shader_module = resource_cache.request_shader_module(stage, shader_source, shader_variant);
 
@@ -125,6 +178,16 @@ void ResourceReplay::create_pipeline_layout(ResourceCache &resource_cache, std::
 	std::transform(shader_indices.begin(), shader_indices.end(), shader_stages.begin(),
 	               [&](size_t shader_index) { return shader_modules.at(shader_index); });
 
+	for (auto shader_module : shader_stages)
+	{
+		std::vector<ShaderResourceMode> resource_modes;
+
+		read(stream,
+		     resource_modes);
+
+		set_resource_modes(*shader_module, resource_modes);
+	}
+
 	auto &pipeline_layout = resource_cache.request_pipeline_layout(shader_stages);
 
 	pipeline_layouts.push_back(&pipeline_layout);
@@ -210,4 +273,49 @@ void ResourceReplay::create_graphics_pipeline(ResourceCache &resource_cache, std
 
 	graphics_pipelines.push_back(&graphics_pipeline);
 }
+
+void ResourceReplay::create_descriptor_set_layout(ResourceCache &resource_cache, std::istringstream &stream)
+{
+	uint32_t                    set_index{};
+	std::vector<size_t>         shader_indices;
+	std::vector<ShaderResource> set_resources;
+
+	read(stream,
+	     set_index,
+	     shader_indices);
+
+	read_shader_resources(stream, set_resources);
+
+	std::vector<ShaderModule *> shader_stages(shader_indices.size());
+	std::transform(shader_indices.begin(), shader_indices.end(), shader_stages.begin(),
+	               [&](size_t shader_index) { return shader_modules.at(shader_index); });
+
+	auto &descriptor_set_layout = resource_cache.request_descriptor_set_layout(set_index, shader_stages, set_resources);
+
+	descriptor_set_layouts.push_back(&descriptor_set_layout);
+}
+
+void ResourceReplay::create_compute_pipeline(ResourceCache &resource_cache, std::istringstream &stream)
+{
+	size_t pipeline_layout_index{};
+
+	read(stream,
+	     pipeline_layout_index);
+
+	std::map<uint32_t, std::vector<uint8_t>> specialization_constant_state{};
+	read(stream,
+	     specialization_constant_state);
+
+	PipelineState pipeline_state{};
+	pipeline_state.set_pipeline_layout(*pipeline_layouts.at(pipeline_layout_index));
+
+	for (auto &item : specialization_constant_state)
+	{
+		pipeline_state.set_specialization_constant(item.first, item.second);
+	}
+
+	auto &compute_pipeline = resource_cache.request_compute_pipeline(pipeline_state);
+
+	compute_pipelines.push_back(&compute_pipeline);
+}
 }        // namespace vkb
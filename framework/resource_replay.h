@@ -42,6 +42,10 @@ class ResourceReplay
 
 	void create_graphics_pipeline(ResourceCache &resource_cache, std::istringstream &stream);
 
+	void create_descriptor_set_layout(ResourceCache &resource_cache, std::istringstream &stream);
+
+	void create_compute_pipeline(ResourceCache &resource_cache, std::istringstream &stream);
+
   private:
 	using ResourceFunc = std::function<void(ResourceCache &, std::istringstream &)>;
 
@@ -54,5 +58,9 @@ class ResourceReplay
 	std::vector<const RenderPass *> render_passes;
 
 	std::vector<const GraphicsPipeline *> graphics_pipelines;
+
+	std::vector<const DescriptorSetLayout *> descriptor_set_layouts;
+
+	std::vector<const ComputePipeline *> compute_pipelines;
 };
 }        // namespace vkb
@@ -0,0 +1,1459 @@
+/* Copyright (c) 2021, Samsung
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "scene_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sys/stat.h>
+
+#include "common/error.h"
+
+VKBP_DISABLE_WARNINGS()
+#include "common/glm_common.h"
+VKBP_ENABLE_WARNINGS()
+
+#include "common/logging.h"
+#include "common/utils.h"
+#include "core/device.h"
+#include "image_uploader.h"
+#include "platform/filesystem.h"
+#include "scene_graph/components/camera.h"
+#include "scene_graph/components/light.h"
+#include "scene_graph/components/mesh.h"
+#include "scene_graph/components/mesh_arena.h"
+#include "scene_graph/components/pbr_material.h"
+#include "scene_graph/components/perspective_camera.h"
+#include "scene_graph/components/sampler.h"
+#include "scene_graph/components/sub_mesh.h"
+#include "scene_graph/components/texture.h"
+#include "scene_graph/components/transform.h"
+#include "scene_graph/node.h"
+#include "scene_graph/scene.h"
+
+namespace vkb
+{
+namespace
+{
+constexpr char magic[8] = {'V', 'K', 'B', 'S', 'C', 'E', 'N', 'E'};
+
+/// Alignment of the data blobs in the file
+constexpr uint64_t blob_alignment = 16;
+
+inline uint64_t align_blob(uint64_t offset)
+{
+	return (offset + blob_alignment - 1) & ~(blob_alignment - 1);
+}
+
+/**
+ * @brief Appends values to the description of a baked scene
+ */
+class Writer
+{
+  public:
+	template <class T>
+	void write(const T &value)
+	{
+		auto bytes = reinterpret_cast<const uint8_t *>(&value);
+		data.insert(data.end(), bytes, bytes + sizeof(T));
+	}
+
+	void write(const std::string &value)
+	{
+		write(to_u32(value.size()));
+		data.insert(data.end(), value.begin(), value.end());
+	}
+
+	std::vector<uint8_t> data;
+};
+
+/**
+ * @brief Reads the values of the description of a baked scene, in the order they were written
+ */
+class Reader
+{
+  public:
+	Reader(const uint8_t *data, size_t size) :
+	    data{data},
+	    size{size}
+	{}
+
+	template <class T>
+	T read()
+	{
+		check(sizeof(T));
+
+		T value;
+		std::memcpy(&value, data + offset, sizeof(T));
+		offset += sizeof(T);
+
+		return value;
+	}
+
+	std::string read_string()
+	{
+		auto length = read<uint32_t>();
+
+		check(length);
+
+		std::string value(reinterpret_cast<const char *>(data + offset), length);
+		offset += length;
+
+		return value;
+	}
+
+	/**
+	 * @brief Reads a number of elements, each of which takes at least a byte of the description,
+	 *        so that a corrupt count cannot allocate more than the file holds
+	 */
+	uint32_t read_count()
+	{
+		auto count = read<uint32_t>();
+
+		check(count);
+
+		return count;
+	}
+
+	size_t get_offset() const
+	{
+		return offset;
+	}
+
+  private:
+	void check(size_t count) const
+	{
+		if (count > size - offset)
+		{
+			throw std::runtime_error("Baked scene is truncated");
+		}
+	}
+
+	const uint8_t *data;
+
+	size_t size;
+
+	size_t offset{0};
+};
+
+/**
+ * @brief The size and modification time of a file which a glTF scene is loaded from,
+ *        to detect a baked scene which is out of date
+ */
+struct SourceStamp
+{
+	uint64_t size{0};
+
+	int64_t time{0};
+};
+
+/**
+ * @param source_file The path of the file, relative to the assets directory
+ */
+SourceStamp get_source_stamp(const std::string &source_file)
+{
+	SourceStamp stamp;
+
+	struct stat info;
+
+	if (stat(fs::path::get(fs::path::Type::Assets, source_file).c_str(), &info) == 0)
+	{
+		stamp.size = static_cast<uint64_t>(info.st_size);
+		stamp.time = static_cast<int64_t>(info.st_mtime);
+	}
+
+	return stamp;
+}
+
+/**
+ * @return The files which a glTF scene is loaded from, relative to the assets directory: the glTF file,
+ *         then the buffers and images it references, except the ones embedded in data URIs
+ */
+std::vector<std::string> get_source_files(const std::string &file_name, const tinygltf::Model &model)
+{
+	auto directory_end = file_name.find_last_of('/');
+	auto directory     = directory_end == std::string::npos ? std::string{} : file_name.substr(0, directory_end + 1);
+
+	std::vector<std::string> source_files{file_name};
+
+	auto add_uri = [&source_files, &directory](const std::string &uri) {
+		if (!uri.empty() && uri.compare(0, 5, "data:") != 0)
+		{
+			source_files.push_back(directory + uri);
+		}
+	};
+
+	for (auto &buffer : model.buffers)
+	{
+		add_uri(buffer.uri);
+	}
+
+	for (auto &image : model.images)
+	{
+		add_uri(image.uri);
+	}
+
+	return source_files;
+}
+
+template <class Key, class T>
+std::unordered_map<const Key *, int32_t> get_indices(const std::vector<T *> &components)
+{
+	std::unordered_map<const Key *, int32_t> indices;
+
+	for (size_t i = 0; i < components.size(); i++)
+	{
+		indices[components[i]] = static_cast<int32_t>(i);
+	}
+
+	return indices;
+}
+
+template <class Key>
+int32_t find_index(const std::unordered_map<const Key *, int32_t> &indices, const Key *component)
+{
+	auto it = indices.find(component);
+
+	return it == indices.end() ? -1 : it->second;
+}
+
+/**
+ * @return Whether the mip levels of an image format can be generated on the CPU, which resizes 8-bit RGBA texels
+ */
+bool is_cpu_mipmap_format(VkFormat format)
+{
+	return format == VK_FORMAT_R8G8B8A8_UNORM || format == VK_FORMAT_R8G8B8A8_SRGB ||
+	       format == VK_FORMAT_B8G8R8A8_UNORM || format == VK_FORMAT_B8G8R8A8_SRGB;
+}
+
+/**
+ * @brief An image whose data stays in the mapped file, only its description is loaded
+ */
+class CachedImage : public sg::Image
+{
+  public:
+	CachedImage(const std::string &name, VkFormat format, uint32_t layers, std::vector<sg::Mipmap> &&mipmaps) :
+	    Image{name, {}, std::move(mipmaps)}
+	{
+		set_format(format);
+		set_layers(layers);
+	}
+
+	virtual ~CachedImage() = default;
+};
+
+struct GeometryRecord
+{
+	VkBufferUsageFlags usage;
+
+	uint64_t data_offset;
+
+	uint64_t data_size;
+};
+
+struct ImageRecord
+{
+	std::string name;
+
+	VkFormat format;
+
+	uint32_t layers;
+
+	std::vector<sg::Mipmap> mipmaps;
+
+	bool gpu_mipmaps;
+
+	uint64_t data_offset;
+
+	uint64_t data_size;
+};
+
+struct TextureRecord
+{
+	std::string name;
+
+	int32_t image_index;
+
+	int32_t sampler_index;
+};
+
+struct MaterialRecord
+{
+	std::unique_ptr<sg::PBRMaterial> material;
+
+	std::vector<std::pair<std::string, int32_t>> texture_indices;
+};
+
+/// A range of a geometry buffer, by the index of the buffer
+struct RangeRecord
+{
+	int32_t buffer_index;
+
+	uint64_t offset;
+};
+
+struct SubMeshRecord
+{
+	std::unique_ptr<sg::SubMesh> submesh;
+
+	RangeRecord interleaved_vertex_buffer;
+
+	std::vector<std::pair<std::string, RangeRecord>> packed_vertex_buffers;
+
+	RangeRecord packed_index_buffer;
+
+	int32_t material_index;
+};
+
+struct MeshRecord
+{
+	std::unique_ptr<sg::Mesh> mesh;
+
+	std::vector<int32_t> submesh_indices;
+};
+
+struct NodeRecord
+{
+	std::unique_ptr<sg::Node> node;
+
+	int32_t mesh_index;
+
+	int32_t camera_index;
+
+	int32_t light_index;
+
+	std::vector<int32_t> child_indices;
+};
+
+/**
+ * @brief Checks an index read from a baked scene
+ * @param index The index, or -1 for none if optional
+ * @param count The number of elements which it indexes
+ */
+void check_index(int32_t index, size_t count, bool optional = true)
+{
+	if (index == -1 && optional)
+	{
+		return;
+	}
+
+	if (index < 0 || static_cast<size_t>(index) >= count)
+	{
+		throw std::runtime_error("Baked scene has an index out of range");
+	}
+}
+
+/**
+ * @brief Checks that the mip levels of an image read from a baked scene lie within its data, in order
+ */
+void check_mipmaps(const ImageRecord &image_record)
+{
+	if (image_record.mipmaps.empty() || image_record.layers == 0)
+	{
+		throw std::runtime_error("Baked scene has an image without data");
+	}
+
+	for (size_t level = 0; level < image_record.mipmaps.size(); level++)
+	{
+		auto &mipmap = image_record.mipmaps[level];
+
+		auto previous_offset = level > 0 ? image_record.mipmaps[level - 1].offset : 0;
+
+		if (mipmap.level != level || mipmap.offset < previous_offset || mipmap.offset > image_record.data_size ||
+		    mipmap.extent.width == 0 || mipmap.extent.height == 0 || mipmap.extent.depth == 0)
+		{
+			throw std::runtime_error("Baked scene has an invalid mip level");
+		}
+	}
+}
+}        // namespace
+
+constexpr uint32_t SceneCache::VERSION;
+
+SceneCache::SceneCache(Device &device) :
+    GLTFLoader{device}
+{
+}
+
+std::string SceneCache::get_cache_file(const std::string &file_name)
+{
+	auto cache_file = file_name;
+
+	std::replace(cache_file.begin(), cache_file.end(), '/', '_');
+
+	return cache_file + ".scene";
+}
+
+std::unique_ptr<sg::Scene> SceneCache::bake(const std::string &file_name, int scene_index)
+{
+	// The images are uploaded while the scene is loaded, the streamer would upload them after
+	assert(!texture_streamer && "Cannot bake a scene whose images are streamed");
+
+	baking = true;
+
+	auto scene = read_scene_from_file(file_name, scene_index);
+
+	baking = false;
+
+	if (scene)
+	{
+		write_scene(*scene, file_name);
+	}
+
+	baked_images.clear();
+	baked_samplers.clear();
+
+	return scene;
+}
+
+std::unique_ptr<sg::Image> SceneCache::parse_image(tinygltf::Image &gltf_image) const
+{
+	auto image = GLTFLoader::parse_image(gltf_image);
+
+	if (!baking)
+	{
+		return image;
+	}
+
+	BakedImage baked_image;
+	baked_image.data        = image->get_data();
+	baked_image.mipmaps     = image->get_mipmaps();
+	baked_image.gpu_mipmaps = image->get_gpu_mip_level_count() > 0;
+
+	// Baking is offline, so the mip levels are generated once on the CPU
+	if (baked_image.gpu_mipmaps && is_cpu_mipmap_format(image->get_format()))
+	{
+		sg::Image mipped_image{image->get_name(), std::move(baked_image.data), std::move(baked_image.mipmaps)};
+		mipped_image.generate_mipmaps();
+
+		baked_image.data    = mipped_image.get_data();
+		baked_image.mipmaps = mipped_image.get_mipmaps();
+	}
+
+	std::lock_guard<std::mutex> lock{baked_images_mutex};
+
+	baked_images[image.get()] = std::move(baked_image);
+
+	return image;
+}
+
+std::unique_ptr<sg::Sampler> SceneCache::parse_sampler(const tinygltf::Sampler &gltf_sampler) const
+{
+	auto sampler = GLTFLoader::parse_sampler(gltf_sampler);
+
+	if (baking)
+	{
+		baked_samplers[sampler.get()] = {gltf_sampler.minFilter, gltf_sampler.magFilter,
+		                                 gltf_sampler.wrapS, gltf_sampler.wrapT, gltf_sampler.wrapR};
+	}
+
+	return sampler;
+}
+
+std::vector<std::vector<uint8_t>> SceneCache::read_back_geometry(sg::Scene &scene)
+{
+	std::vector<std::unique_ptr<core::Buffer>> staging_buffers;
+
+	auto &command_buffer = device.request_command_buffer();
+
+	command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+	for (auto mesh_arena : scene.get_components<sg::MeshArena>())
+	{
+		for (auto &arena_buffer : mesh_arena->get_buffers())
+		{
+			auto size = arena_buffer.buffer->get_size();
+
+			auto staging_buffer = std::make_unique<core::Buffer>(device, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+
+			// Wait for the upload of the arena
+			BufferMemoryBarrier upload_barrier{};
+			upload_barrier.src_stage_mask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+			upload_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+			upload_barrier.src_access_mask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			upload_barrier.dst_access_mask = VK_ACCESS_TRANSFER_READ_BIT;
+
+			command_buffer.buffer_memory_barrier(*arena_buffer.buffer, 0, VK_WHOLE_SIZE, upload_barrier);
+
+			command_buffer.copy_buffer(*arena_buffer.buffer, *staging_buffer, size);
+
+			BufferMemoryBarrier memory_barrier{};
+			memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+			memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_HOST_BIT;
+			memory_barrier.src_access_mask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			memory_barrier.dst_access_mask = VK_ACCESS_HOST_READ_BIT;
+
+			command_buffer.buffer_memory_barrier(*staging_buffer, 0, VK_WHOLE_SIZE, memory_barrier);
+
+			staging_buffers.push_back(std::move(staging_buffer));
+		}
+	}
+
+	command_buffer.end();
+
+	auto &queue = device.get_queue_by_flags(VK_QUEUE_GRAPHICS_BIT, 0);
+
+	queue.submit(command_buffer, device.request_fence());
+
+	device.get_fence_pool().wait();
+	device.get_fence_pool().reset();
+	device.get_command_pool().reset_pool();
+
+	std::vector<std::vector<uint8_t>> geometry;
+
+	for (auto &staging_buffer : staging_buffers)
+	{
+		auto data = staging_buffer->map();
+
+		geometry.emplace_back(data, data + staging_buffer->get_size());
+
+		staging_buffer->unmap();
+	}
+
+	return geometry;
+}
+
+void SceneCache::write_scene(sg::Scene &scene, const std::string &file_name)
+{
+	auto geometry = read_back_geometry(scene);
+
+	// The blobs follow the description, at offsets relative to the first one
+	std::vector<const std::vector<uint8_t> *> blobs;
+	uint64_t                                  blobs_size = 0;
+
+	auto add_blob = [&blobs, &blobs_size](const std::vector<uint8_t> &data) {
+		auto offset = blobs_size;
+
+		blobs.push_back(&data);
+		blobs_size = align_blob(blobs_size + data.size());
+
+		return offset;
+	};
+
+	Writer writer;
+
+	writer.write(scene.get_name());
+
+	// Geometry
+	std::unordered_map<const core::Buffer *, int32_t> buffer_indices;
+
+	std::vector<VkBufferUsageFlags> buffer_usages;
+
+	for (auto mesh_arena : scene.get_components<sg::MeshArena>())
+	{
+		for (auto &arena_buffer : mesh_arena->get_buffers())
+		{
+			buffer_indices[arena_buffer.buffer.get()] = static_cast<int32_t>(buffer_usages.size());
+			buffer_usages.push_back(arena_buffer.usage);
+		}
+	}
+
+	writer.write(to_u32(geometry.size()));
+
+	for (size_t i = 0; i < geometry.size(); i++)
+	{
+		writer.write(buffer_usages[i]);
+		writer.write(add_blob(geometry[i]));
+		writer.write<uint64_t>(geometry[i].size());
+	}
+
+	// Images, with their mip levels
+	auto images = scene.get_components<sg::Image>();
+
+	writer.write(to_u32(images.size()));
+
+	for (auto image : images)
+	{
+		auto &baked_image = baked_images.at(image);
+
+		writer.write(image->get_name());
+		writer.write(image->get_format());
+		writer.write(image->get_layers());
+		writer.write(to_u32(baked_image.mipmaps.size()));
+
+		for (auto &mipmap : baked_image.mipmaps)
+		{
+			writer.write(mipmap);
+		}
+
+		writer.write<uint8_t>(baked_image.gpu_mipmaps);
+		writer.write(add_blob(baked_image.data));
+		writer.write<uint64_t>(baked_image.data.size());
+	}
+
+	// Samplers
+	auto samplers = scene.get_components<sg::Sampler>();
+
+	writer.write(to_u32(samplers.size()));
+
+	for (auto sampler : samplers)
+	{
+		writer.write(sampler->get_name());
+		writer.write(baked_samplers.at(sampler));
+	}
+
+	// Lights
+	auto lights = scene.get_components<sg::Light>();
+
+	writer.write(to_u32(lights.size()));
+
+	for (auto light : lights)
+	{
+		writer.write(light->get_name());
+		writer.write(static_cast<uint32_t>(light->get_light_type()));
+		writer.write(light->get_properties());
+	}
+
+	// Textures
+	auto image_indices   = get_indices<sg::Image>(images);
+	auto sampler_indices = get_indices<sg::Sampler>(samplers);
+	auto textures        = scene.get_components<sg::Texture>();
+
+	writer.write(to_u32(textures.size()));
+
+	for (auto texture : textures)
+	{
+		writer.write(texture->get_name());
+		writer.write(find_index<sg::Image>(image_indices, texture->get_image()));
+		writer.write(find_index<sg::Sampler>(sampler_indices, texture->get_sampler()));
+	}
+
+	// Materials
+	auto texture_indices = get_indices<sg::Texture>(textures);
+	auto materials       = scene.get_components<sg::PBRMaterial>();
+
+	writer.write(to_u32(materials.size()));
+
+	for (auto material : materials)
+	{
+		writer.write(material->get_name());
+		writer.write(material->base_color_factor);
+		writer.write(material->metallic_factor);
+		writer.write(material->roughness_factor);
+		writer.write(material->emissive);
+		writer.write<uint8_t>(material->double_sided);
+		writer.write(material->alpha_cutoff);
+		writer.write(static_cast<uint32_t>(material->alpha_mode));
+
+		writer.write(to_u32(material->textures.size()));
+
+		for (auto &texture : material->textures)
+		{
+			writer.write(texture.first);
+			writer.write(find_index<sg::Texture>(texture_indices, texture.second));
+		}
+	}
+
+	// Submeshes, whose vertex and index data are ranges of the geometry buffers
+	auto material_indices = get_indices<sg::Material>(materials);
+	auto submeshes        = scene.get_components<sg::SubMesh>();
+
+	auto write_range = [&writer, &buffer_indices](const sg::BufferRange &range) {
+		writer.write(find_index<core::Buffer>(buffer_indices, range.buffer));
+		writer.write<uint64_t>(range.offset);
+	};
+
+	writer.write(to_u32(submeshes.size()));
+
+	for (auto submesh : submeshes)
+	{
+		if (submesh->index_buffer || !submesh->vertex_buffers.empty())
+		{
+			throw std::runtime_error("Cannot bake a submesh whose data is not in a mesh arena");
+		}
+
+		writer.write(static_cast<uint32_t>(submesh->index_type));
+		writer.write(submesh->index_offset);
+		writer.write(submesh->vertices_count);
+		writer.write(submesh->vertex_indices);
+
+		writer.write(to_u32(submesh->get_attributes().size()));
+
+		for (auto &attribute : submesh->get_attributes())
+		{
+			writer.write(attribute.first);
+			writer.write(attribute.second);
+		}
+
+		write_range(submesh->interleaved_vertex_buffer);
+
+		writer.write(to_u32(submesh->packed_vertex_buffers.size()));
+
+		for (auto &vertex_buffer : submesh->packed_vertex_buffers)
+		{
+			writer.write(vertex_buffer.first);
+			write_range(vertex_buffer.second);
+		}
+
+		write_range(submesh->packed_index_buffer);
+
+		writer.write(find_index<sg::Material>(material_indices, submesh->get_material()));
+	}
+
+	// Meshes
+	auto submesh_indices = get_indices<sg::SubMesh>(submeshes);
+	auto meshes          = scene.get_components<sg::Mesh>();
+
+	writer.write(to_u32(meshes.size()));
+
+	for (auto mesh : meshes)
+	{
+		writer.write(mesh->get_name());
+		writer.write(mesh->get_bounds().get_min());
+		writer.write(mesh->get_bounds().get_max());
+
+		writer.write(to_u32(mesh->get_submeshes().size()));
+
+		for (auto submesh : mesh->get_submeshes())
+		{
+			writer.write(find_index<sg::SubMesh>(submesh_indices, submesh));
+		}
+	}
+
+	// Cameras
+	auto cameras = scene.get_components<sg::Camera>();
+
+	writer.write(to_u32(cameras.size()));
+
+	for (auto camera : cameras)
+	{
+		auto perspective_camera = dynamic_cast<sg::PerspectiveCamera *>(camera);
+
+		if (!perspective_camera)
+		{
+			throw std::runtime_error("Cannot bake a camera which is not a perspective camera");
+		}
+
+		writer.write(perspective_camera->get_name());
+		writer.write(perspective_camera->get_aspect_ratio());
+		writer.write(perspective_camera->get_field_of_view());
+		writer.write(perspective_camera->get_near_plane());
+		writer.write(perspective_camera->get_far_plane());
+	}
+
+	// Nodes, with the indices of their components and children
+	auto mesh_indices   = get_indices<sg::Mesh>(meshes);
+	auto camera_indices = get_indices<sg::Camera>(cameras);
+	auto light_indices  = get_indices<sg::Light>(lights);
+
+	std::vector<sg::Node *> nodes;
+
+	for (auto &node : scene.get_nodes())
+	{
+		nodes.push_back(node.get());
+	}
+
+	auto node_indices = get_indices<sg::Node>(nodes);
+
+	writer.write(to_u32(nodes.size()));
+
+	for (auto node : nodes)
+	{
+		auto &transform = node->get_transform();
+
+		writer.write<uint64_t>(node->get_id());
+		writer.write(node->get_name());
+		writer.write(transform.get_translation());
+		writer.write(transform.get_rotation());
+		writer.write(transform.get_scale());
+
+		writer.write(node->has_component<sg::Mesh>() ? find_index<sg::Mesh>(mesh_indices, &node->get_component<sg::Mesh>()) : -1);
+		writer.write(node->has_component<sg::Camera>() ? find_index<sg::Camera>(camera_indices, &node->get_component<sg::Camera>()) : -1);
+		writer.write(node->has_component<sg::Light>() ? find_index<sg::Light>(light_indices, &node->get_component<sg::Light>()) : -1);
+
+		writer.write(to_u32(node->get_children().size()));
+
+		for (auto child : node->get_children())
+		{
+			writer.write(find_index<sg::Node>(node_indices, child));
+		}
+	}
+
+	writer.write(find_index<sg::Node>(node_indices, &scene.get_root_node()));
+
+	// Header, with the stamps of the source files, description and blobs
+	auto source_files = get_source_files(file_name, model);
+
+	Writer header;
+	header.data.insert(header.data.end(), std::begin(magic), std::end(magic));
+	header.write(VERSION);
+	header.write(to_u32(source_files.size()));
+
+	for (auto &source_file : source_files)
+	{
+		auto stamp = get_source_stamp(source_file);
+
+		header.write(source_file);
+		header.write(stamp.size);
+		header.write(stamp.time);
+	}
+
+	header.write<uint64_t>(writer.data.size());
+
+	auto cache_file = fs::path::get(fs::path::Type::Cache, get_cache_file(file_name));
+
+	auto description_end = header.data.size() + writer.data.size();
+
+	// Loaders never see a partially written scene, and a failed write keeps the previous one
+	fs::write_file_atomic(cache_file, [&](std::ostream &file) {
+		file.write(reinterpret_cast<const char *>(header.data.data()), header.data.size());
+		file.write(reinterpret_cast<const char *>(writer.data.data()), writer.data.size());
+
+		const char padding[blob_alignment] = {};
+
+		file.write(padding, align_blob(description_end) - description_end);
+
+		for (auto blob : blobs)
+		{
+			file.write(reinterpret_cast<const char *>(blob->data()), blob->size());
+			file.write(padding, align_blob(blob->size()) - blob->size());
+		}
+	});
+
+	LOGI("Baked scene {} into {} ({} bytes)", file_name, cache_file, align_blob(description_end) + blobs_size);
+}
+
+std::unique_ptr<sg::Scene> SceneCache::read_scene_from_cache(const std::string &file_name)
+{
+	auto cache_file = fs::path::get(fs::path::Type::Cache, get_cache_file(file_name));
+
+	if (!fs::is_file(cache_file))
+	{
+		return nullptr;
+	}
+
+	try
+	{
+		return load_baked_scene(cache_file);
+	}
+	catch (const std::exception &e)
+	{
+		LOGW("Ignoring baked scene {}: {}", cache_file, e.what());
+		return nullptr;
+	}
+}
+
+std::unique_ptr<sg::Scene> SceneCache::load_baked_scene(const std::string &cache_file)
+{
+	Timer timer;
+	timer.start();
+
+	fs::MappedFile file{cache_file};
+
+	Reader header{file.get_data(), file.get_size()};
+
+	char file_magic[sizeof(magic)];
+
+	for (auto &c : file_magic)
+	{
+		c = header.read<char>();
+	}
+
+	auto version = header.read<uint32_t>();
+
+	if (std::memcmp(file_magic, magic, sizeof(magic)) != 0 || version != VERSION)
+	{
+		LOGW("Ignoring baked scene {}, which has another version", cache_file);
+		return nullptr;
+	}
+
+	// The scene is out of date if the glTF file or any file it references has changed
+	auto source_count = header.read_count();
+
+	for (uint32_t i = 0; i < source_count; i++)
+	{
+		auto source_file = header.read_string();
+		auto source_size = header.read<uint64_t>();
+		auto source_time = header.read<int64_t>();
+
+		auto stamp = get_source_stamp(source_file);
+
+		if (source_size != stamp.size || source_time != stamp.time)
+		{
+			LOGW("Ignoring baked scene {}, whose source {} is out of date", cache_file, source_file);
+			return nullptr;
+		}
+	}
+
+	auto description_size = header.read<uint64_t>();
+
+	auto description_begin = header.get_offset();
+
+	if (description_size > file.get_size() - description_begin)
+	{
+		throw std::runtime_error("Baked scene is truncated");
+	}
+
+	auto blobs_begin = align_blob(description_begin + description_size);
+
+	if (blobs_begin > file.get_size())
+	{
+		throw std::runtime_error("Baked scene is truncated");
+	}
+
+	auto blobs_size = file.get_size() - blobs_begin;
+
+	auto check_blob = [blobs_size](uint64_t offset, uint64_t size) {
+		if (offset > blobs_size || size > blobs_size - offset)
+		{
+			throw std::runtime_error("Baked scene has a blob out of the file");
+		}
+	};
+
+	auto get_blob = [&file, blobs_begin](uint64_t offset) {
+		return file.get_data() + blobs_begin + offset;
+	};
+
+	// The whole description is read and checked before any Vulkan object is created
+	Reader reader{file.get_data() + description_begin, static_cast<size_t>(description_size)};
+
+	auto scene_name = reader.read_string();
+
+	// Geometry
+	std::vector<GeometryRecord> geometry_records(reader.read_count());
+
+	for (auto &geometry_record : geometry_records)
+	{
+		geometry_record.usage       = static_cast<VkBufferUsageFlags>(reader.read<uint32_t>());
+		geometry_record.data_offset = reader.read<uint64_t>();
+		geometry_record.data_size   = reader.read<uint64_t>();
+
+		check_blob(geometry_record.data_offset, geometry_record.data_size);
+	}
+
+	// Images
+	std::vector<ImageRecord> image_records(reader.read_count());
+
+	for (auto &image_record : image_records)
+	{
+		image_record.name   = reader.read_string();
+		image_record.format = reader.read<VkFormat>();
+		image_record.layers = reader.read<uint32_t>();
+
+		image_record.mipmaps.resize(reader.read_count());
+
+		for (auto &mipmap : image_record.mipmaps)
+		{
+			mipmap = reader.read<sg::Mipmap>();
+		}
+
+		image_record.gpu_mipmaps = reader.read<uint8_t>() != 0;
+		image_record.data_offset = reader.read<uint64_t>();
+		image_record.data_size   = reader.read<uint64_t>();
+
+		check_blob(image_record.data_offset, image_record.data_size);
+		check_mipmaps(image_record);
+
+		if (!device.is_image_format_supported(image_record.format))
+		{
+			LOGW("Ignoring baked scene {}, whose image {} has a format the GPU does not support", cache_file, image_record.name);
+			return nullptr;
+		}
+	}
+
+	// Samplers
+	std::vector<tinygltf::Sampler> gltf_samplers(reader.read_count());
+
+	for (auto &gltf_sampler : gltf_samplers)
+	{
+		gltf_sampler.name = reader.read_string();
+
+		auto baked_sampler = reader.read<BakedSampler>();
+
+		gltf_sampler.minFilter = baked_sampler.min_filter;
+		gltf_sampler.magFilter = baked_sampler.mag_filter;
+		gltf_sampler.wrapS     = baked_sampler.wrap_s;
+		gltf_sampler.wrapT     = baked_sampler.wrap_t;
+		gltf_sampler.wrapR     = baked_sampler.wrap_r;
+	}
+
+	// Lights
+	std::vector<std::unique_ptr<sg::Light>> lights(reader.read_count());
+
+	for (auto &light : lights)
+	{
+		light = std::make_unique<sg::Light>(reader.read_string());
+
+		auto light_type = reader.read<uint32_t>();
+
+		if (light_type >= sg::LightType::Max)
+		{
+			throw std::runtime_error("Baked scene has an invalid light type");
+		}
+
+		light->set_light_type(static_cast<sg::LightType>(light_type));
+		light->set_properties(reader.read<sg::LightProperties>());
+	}
+
+	// Textures
+	std::vector<TextureRecord> texture_records(reader.read_count());
+
+	for (auto &texture_record : texture_records)
+	{
+		texture_record.name          = reader.read_string();
+		texture_record.image_index   = reader.read<int32_t>();
+		texture_record.sampler_index = reader.read<int32_t>();
+
+		check_index(texture_record.image_index, image_records.size());
+		check_index(texture_record.sampler_index, gltf_samplers.size());
+	}
+
+	// Materials
+	std::vector<MaterialRecord> material_records(reader.read_count());
+
+	for (auto &material_record : material_records)
+	{
+		auto material = std::make_unique<sg::PBRMaterial>(reader.read_string());
+
+		material->base_color_factor = reader.read<glm::vec4>();
+		material->metallic_factor   = reader.read<float>();
+		material->roughness_factor  = reader.read<float>();
+		material->emissive          = reader.read<glm::vec3>();
+		material->double_sided      = reader.read<uint8_t>() != 0;
+		material->alpha_cutoff      = reader.read<float>();
+		material->alpha_mode        = static_cast<sg::AlphaMode>(reader.read<uint32_t>());
+
+		material_record.material = std::move(material);
+		material_record.texture_indices.resize(reader.read_count());
+
+		for (auto &texture_index : material_record.texture_indices)
+		{
+			texture_index.first  = reader.read_string();
+			texture_index.second = reader.read<int32_t>();
+
+			check_index(texture_index.second, texture_records.size());
+		}
+	}
+
+	// Submeshes, whose vertex and index data are ranges of the geometry buffers
+	auto read_range = [&reader, &geometry_records]() {
+		RangeRecord range;
+		range.buffer_index = reader.read<int32_t>();
+		range.offset       = reader.read<uint64_t>();
+
+		check_index(range.buffer_index, geometry_records.size());
+
+		if (range.buffer_index >= 0 && range.offset > geometry_records[range.buffer_index].data_size)
+		{
+			throw std::runtime_error("Baked scene has a range out of its geometry buffer");
+		}
+
+		return range;
+	};
+
+	std::vector<SubMeshRecord> submesh_records(reader.read_count());
+
+	for (auto &submesh_record : submesh_records)
+	{
+		auto submesh = std::make_unique<sg::SubMesh>();
+
+		auto index_type = static_cast<VkIndexType>(reader.read<uint32_t>());
+
+		if (index_type != VK_INDEX_TYPE_UINT16 && index_type != VK_INDEX_TYPE_UINT32)
+		{
+			throw std::runtime_error("Baked scene has an invalid index type");
+		}
+
+		submesh->index_type     = index_type;
+		submesh->index_offset   = reader.read<uint32_t>();
+		submesh->vertices_count = reader.read<uint32_t>();
+		submesh->vertex_indices = reader.read<uint32_t>();
+
+		auto attribute_count = reader.read_count();
+
+		for (uint32_t j = 0; j < attribute_count; j++)
+		{
+			auto name = reader.read_string();
+
+			submesh->set_attribute(name, reader.read<sg::VertexAttribute>());
+		}
+
+		submesh_record.interleaved_vertex_buffer = read_range();
+
+		submesh_record.packed_vertex_buffers.resize(reader.read_count());
+
+		for (auto &vertex_buffer : submesh_record.packed_vertex_buffers)
+		{
+			vertex_buffer.first  = reader.read_string();
+			vertex_buffer.second = read_range();
+		}
+
+		submesh_record.packed_index_buffer = read_range();
+
+		submesh_record.material_index = reader.read<int32_t>();
+
+		check_index(submesh_record.material_index, material_records.size());
+
+		submesh_record.submesh = std::move(submesh);
+	}
+
+	// Meshes
+	std::vector<MeshRecord> mesh_records(reader.read_count());
+
+	for (auto &mesh_record : mesh_records)
+	{
+		mesh_record.mesh = std::make_unique<sg::Mesh>(reader.read_string());
+
+		auto bounds_min = reader.read<glm::vec3>();
+		auto bounds_max = reader.read<glm::vec3>();
+
+		// Meshes without vertices keep their empty bounds
+		if (glm::all(glm::lessThanEqual(bounds_min, bounds_max)))
+		{
+			mesh_record.mesh->update_bounds({bounds_min, bounds_max});
+		}
+
+		mesh_record.submesh_indices.resize(reader.read_count());
+
+		for (auto &submesh_index : mesh_record.submesh_indices)
+		{
+			submesh_index = reader.read<int32_t>();
+
+			check_index(submesh_index, submesh_records.size(), false);
+		}
+	}
+
+	// Cameras
+	std::vector<std::unique_ptr<sg::PerspectiveCamera>> cameras(reader.read_count());
+
+	for (auto &camera : cameras)
+	{
+		camera = std::make_unique<sg::PerspectiveCamera>(reader.read_string());
+
+		camera->set_aspect_ratio(reader.read<float>());
+		camera->set_field_of_view(reader.read<float>());
+		camera->set_near_plane(reader.read<float>());
+		camera->set_far_plane(reader.read<float>());
+	}
+
+	// Nodes, which must form a tree from the root node
+	std::vector<NodeRecord> node_records(reader.read_count());
+
+	std::vector<bool> has_parent(node_records.size(), false);
+
+	for (auto &node_record : node_records)
+	{
+		auto id   = reader.read<uint64_t>();
+		auto name = reader.read_string();
+
+		node_record.node = std::make_unique<sg::Node>(static_cast<size_t>(id), name);
+
+		auto &transform = node_record.node->get_transform();
+
+		transform.set_translation(reader.read<glm::vec3>());
+		transform.set_rotation(reader.read<glm::quat>());
+		transform.set_scale(reader.read<glm::vec3>());
+
+		node_record.mesh_index   = reader.read<int32_t>();
+		node_record.camera_index = reader.read<int32_t>();
+		node_record.light_index  = reader.read<int32_t>();
+
+		check_index(node_record.mesh_index, mesh_records.size());
+		check_index(node_record.camera_index, cameras.size());
+		check_index(node_record.light_index, lights.size());
+
+		node_record.child_indices.resize(reader.read_count());
+
+		for (auto &child_index : node_record.child_indices)
+		{
+			child_index = reader.read<int32_t>();
+
+			check_index(child_index, node_records.size(), false);
+
+			if (has_parent[child_index])
+			{
+				throw std::runtime_error("Baked scene has a node with several parents");
+			}
+
+			has_parent[child_index] = true;
+		}
+	}
+
+	auto root_index = reader.read<int32_t>();
+
+	check_index(root_index, node_records.size(), false);
+
+	if (has_parent[root_index])
+	{
+		throw std::runtime_error("Baked scene has a root node with a parent");
+	}
+
+	if (reader.get_offset() != description_size)
+	{
+		throw std::runtime_error("Baked scene has data after its description");
+	}
+
+	// Vulkan objects, created before the copies are submitted
+	auto mesh_arena = std::make_unique<sg::MeshArena>(device);
+
+	std::vector<sg::BufferRange> geometry_ranges(geometry_records.size());
+
+	for (size_t i = 0; i < geometry_records.size(); i++)
+	{
+		auto &geometry_record = geometry_records[i];
+
+		mesh_arena->add(geometry_record.usage, get_blob(geometry_record.data_offset), static_cast<size_t>(geometry_record.data_size), geometry_ranges[i]);
+	}
+
+	std::vector<std::unique_ptr<CachedImage>> images;
+
+	for (auto &image_record : image_records)
+	{
+		auto image = std::make_unique<CachedImage>(image_record.name, image_record.format, image_record.layers, std::move(image_record.mipmaps));
+
+		if (image_record.gpu_mipmaps && device.is_image_format_blittable(image_record.format))
+		{
+			image->add_gpu_mipmaps();
+		}
+
+		image->create_vk_image(device);
+
+		images.push_back(std::move(image));
+	}
+
+	std::vector<std::unique_ptr<sg::Sampler>> samplers;
+
+	for (auto &gltf_sampler : gltf_samplers)
+	{
+		samplers.push_back(parse_sampler(gltf_sampler));
+	}
+
+	auto &queue = device.get_queue_by_flags(VK_QUEUE_GRAPHICS_BIT, 0);
+
+	auto &geometry_command_buffer = device.request_command_buffer();
+
+	geometry_command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, 0);
+
+	auto geometry_staging_buffer = mesh_arena->upload(geometry_command_buffer);
+
+	geometry_command_buffer.end();
+
+	queue.submit(geometry_command_buffer, device.request_fence());
+
+	// The images are uploaded while the geometry is copied. If that fails, the copy must
+	// complete before unwinding destroys the staging buffer and the mesh arena it uses
+	try
+	{
+		ImageUploader image_uploader{device, staging_budget, transfer_queue_uploads};
+
+		for (size_t i = 0; i < images.size(); i++)
+		{
+			auto &image_record = image_records[i];
+
+			image_uploader.upload(*images[i], get_blob(image_record.data_offset), static_cast<size_t>(image_record.data_size));
+		}
+
+		image_uploader.flush();
+	}
+	catch (...)
+	{
+		device.get_fence_pool().wait();
+		device.get_fence_pool().reset();
+		device.get_command_pool().reset_pool();
+
+		throw;
+	}
+
+	device.get_fence_pool().wait();
+	device.get_fence_pool().reset();
+	device.get_command_pool().reset_pool();
+
+	geometry_staging_buffer.reset();
+
+	// Components, linked by the indices checked above
+	auto scene = std::make_unique<sg::Scene>(scene_name);
+
+	std::vector<sg::Image *> scene_images;
+
+	for (auto &image : images)
+	{
+		scene_images.push_back(image.get());
+
+		scene->add_component(std::move(image));
+	}
+
+	std::vector<sg::Sampler *> scene_samplers;
+
+	for (auto &sampler : samplers)
+	{
+		scene_samplers.push_back(sampler.get());
+
+		scene->add_component(std::move(sampler));
+	}
+
+	std::vector<sg::Light *> scene_lights;
+
+	for (auto &light : lights)
+	{
+		scene_lights.push_back(light.get());
+
+		scene->add_component(std::move(light));
+	}
+
+	std::vector<sg::Texture *> textures;
+
+	for (auto &texture_record : texture_records)
+	{
+		auto texture = std::make_unique<sg::Texture>(texture_record.name);
+
+		if (texture_record.image_index >= 0)
+		{
+			texture->set_image(*scene_images[texture_record.image_index]);
+		}
+
+		if (texture_record.sampler_index >= 0)
+		{
+			texture->set_sampler(*scene_samplers[texture_record.sampler_index]);
+		}
+
+		textures.push_back(texture.get());
+
+		scene->add_component(std::move(texture));
+	}
+
+	std::vector<sg::PBRMaterial *> materials;
+
+	for (auto &material_record : material_records)
+	{
+		for (auto &texture_index : material_record.texture_indices)
+		{
+			if (texture_index.second >= 0)
+			{
+				material_record.material->textures[texture_index.first] = textures[texture_index.second];
+			}
+		}
+
+		materials.push_back(material_record.material.get());
+
+		scene->add_component(std::move(material_record.material));
+	}
+
+	auto set_range = [&geometry_ranges](const RangeRecord &range_record, sg::BufferRange &range) {
+		if (range_record.buffer_index >= 0)
+		{
+			auto &geometry_range = geometry_ranges[range_record.buffer_index];
+
+			range.buffer = geometry_range.buffer;
+			range.offset = geometry_range.offset + range_record.offset;
+		}
+	};
+
+	std::vector<sg::SubMesh *> submeshes;
+
+	for (auto &submesh_record : submesh_records)
+	{
+		auto &submesh = *submesh_record.submesh;
+
+		set_range(submesh_record.interleaved_vertex_buffer, submesh.interleaved_vertex_buffer);
+
+		for (auto &vertex_buffer : submesh_record.packed_vertex_buffers)
+		{
+			set_range(vertex_buffer.second, submesh.packed_vertex_buffers[vertex_buffer.first]);
+		}
+
+		set_range(submesh_record.packed_index_buffer, submesh.packed_index_buffer);
+
+		if (submesh_record.material_index >= 0)
+		{
+			submesh.set_material(*materials[submesh_record.material_index]);
+		}
+
+		submeshes.push_back(&submesh);
+
+		scene->add_component(std::move(submesh_record.submesh));
+	}
+
+	std::vector<sg::Mesh *> meshes;
+
+	for (auto &mesh_record : mesh_records)
+	{
+		for (auto submesh_index : mesh_record.submesh_indices)
+		{
+			mesh_record.mesh->add_submesh(*submeshes[submesh_index]);
+		}
+
+		meshes.push_back(mesh_record.mesh.get());
+
+		scene->add_component(std::move(mesh_record.mesh));
+	}
+
+	scene->add_component(std::move(mesh_arena));
+
+	std::vector<sg::Camera *> scene_cameras;
+
+	for (auto &camera : cameras)
+	{
+		scene_cameras.push_back(camera.get());
+
+		scene->add_component(std::move(camera));
+	}
+
+	std::vector<std::unique_ptr<sg::Node>> nodes;
+
+	for (auto &node_record : node_records)
+	{
+		auto &node = *node_record.node;
+
+		if (node_record.mesh_index >= 0)
+		{
+			auto mesh = meshes[node_record.mesh_index];
+
+			node.set_component(*mesh);
+			mesh->add_node(node);
+		}
+
+		if (node_record.camera_index >= 0)
+		{
+			auto camera = scene_cameras[node_record.camera_index];
+
+			node.set_component(*camera);
+			camera->set_node(node);
+		}
+
+		if (node_record.light_index >= 0)
+		{
+			auto light = scene_lights[node_record.light_index];
+
+			node.set_component(*light);
+			light->set_node(node);
+		}
+
+		for (auto child_index : node_record.child_indices)
+		{
+			auto &child = *node_records[child_index].node;
+
+			child.set_parent(node);
+			node.add_child(child);
+		}
+	}
+
+	for (auto &node_record : node_records)
+	{
+		nodes.push_back(std::move(node_record.node));
+	}
+
+	scene->set_root_node(*nodes[root_index]);
+
+	scene->set_nodes(std::move(nodes));
+
+	auto elapsed_time = timer.stop();
+
+	LOGI("Loaded baked scene {} in {} seconds", cache_file, vkb::to_string(elapsed_time));
+
+	return scene;
+}
+}        // namespace vkb
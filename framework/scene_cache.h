@@ -0,0 +1,133 @@
+/* Copyright (c) 2021, Samsung
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "gltf_loader.h"
+#include "scene_graph/components/image.h"
+
+namespace vkb
+{
+namespace sg
+{
+class Scene;
+}        // namespace sg
+
+/**
+ * @brief Bakes glTF scenes into single files in the cache directory, and loads them back.
+ *        A baked scene holds the packed vertex and index buffers and the mip levels of the
+ *        images as they are uploaded, after the description of the scene graph. Loading it
+ *        maps the file and copies the data straight to the staging buffers, without parsing
+ *        the glTF file, decoding the images or converting the geometry.
+ */
+class SceneCache : public GLTFLoader
+{
+  public:
+	/// Version of the baked scene format, a baked scene of another version is ignored
+	static constexpr uint32_t VERSION = 2;
+
+	SceneCache(Device &device);
+
+	virtual ~SceneCache() = default;
+
+	/**
+	 * @param file_name The path of a glTF file, relative to the assets directory
+	 * @return The name of the file baked from a glTF file, relative to the cache directory
+	 */
+	static std::string get_cache_file(const std::string &file_name);
+
+	/**
+	 * @brief Loads a glTF file, and bakes the scene into the cache directory
+	 * @param file_name The path of the glTF file, relative to the assets directory
+	 * @param scene_index The glTF scene to load, -1 for the default one
+	 * @return The loaded scene, nullptr if the glTF file cannot be loaded
+	 */
+	std::unique_ptr<sg::Scene> bake(const std::string &file_name, int scene_index = -1);
+
+	/**
+	 * @brief Loads the baked scene of a glTF file
+	 * @param file_name The path of the glTF file, relative to the assets directory
+	 * @return The scene, nullptr if it has not been baked, has been baked from another version
+	 *         of the glTF file or of the files it references, is malformed, or uses image formats which the GPU does not support
+	 */
+	std::unique_ptr<sg::Scene> read_scene_from_cache(const std::string &file_name);
+
+  protected:
+	virtual std::unique_ptr<sg::Image> parse_image(tinygltf::Image &gltf_image) const override;
+
+	virtual std::unique_ptr<sg::Sampler> parse_sampler(const tinygltf::Sampler &gltf_sampler) const override;
+
+  private:
+	/// The data of an image kept while baking, as the upload clears it
+	struct BakedImage
+	{
+		std::vector<uint8_t> data;
+
+		std::vector<sg::Mipmap> mipmaps;
+
+		/// Whether the levels below the data are generated on the GPU
+		bool gpu_mipmaps{false};
+	};
+
+	/// The glTF parameters of a sampler, which it is created from
+	struct BakedSampler
+	{
+		int32_t min_filter;
+
+		int32_t mag_filter;
+
+		int32_t wrap_s;
+
+		int32_t wrap_t;
+
+		int32_t wrap_r;
+	};
+
+	/**
+	 * @brief Writes the baked scene of a glTF file to the cache directory
+	 */
+	void write_scene(sg::Scene &scene, const std::string &file_name);
+
+	/**
+	 * @brief Loads a baked scene, reading and checking its whole description before creating any Vulkan object
+	 * @param cache_file The full path of the baked scene
+	 * @return The scene, nullptr if it is out of date or cannot be loaded on this GPU
+	 * @throws std::runtime_error if the baked scene is malformed
+	 */
+	std::unique_ptr<sg::Scene> load_baked_scene(const std::string &cache_file);
+
+	/**
+	 * @brief Copies the buffers of the mesh arenas of a scene back from the GPU
+	 */
+	std::vector<std::vector<uint8_t>> read_back_geometry(sg::Scene &scene);
+
+	bool baking{false};
+
+	/// Filled by the image decoding threads while baking
+	mutable std::mutex baked_images_mutex;
+
+	mutable std::unordered_map<const sg::Image *, BakedImage> baked_images;
+
+	mutable std::unordered_map<const sg::Sampler *, BakedSampler> baked_samplers;
+};
+}        // namespace vkb
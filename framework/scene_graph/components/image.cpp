@@ -121,18 +121,27 @@ void Image::create_vk_image(Device &device, VkImageViewType image_view_type, VkI
 {
 	assert(!vk_image && !vk_image_view && "Vulkan image already constructed");
 
+	VkImageUsageFlags image_usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+	// The GPU mip levels are blitted from the previous level
+	if (gpu_mip_level_count > 0)
+	{
+		image_usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	}
+
 	vk_image = std::make_unique<core::Image>(device,
 	                                         get_extent(),
 	                                         format,
-	                                         VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+	                                         image_usage,
 	                                         VMA_MEMORY_USAGE_GPU_ONLY,
 	                                         VK_SAMPLE_COUNT_1_BIT,
-	                                         to_u32(mipmaps.size()),
+	                                         to_u32(mipmaps.size()) + gpu_mip_level_count,
 	                                         layers,
 	                                         VK_IMAGE_TILING_OPTIMAL,
 	                                         flags);
 
-	vk_image_view = std::make_unique<core::ImageView>(*vk_image, image_view_type);
+	vk_image_view      = std::make_unique<core::ImageView>(*vk_image, image_view_type);
+	vk_image_view_type = image_view_type;
 }
 
 const core::Image &Image::get_vk_image() const
@@ -147,6 +156,19 @@ const core::ImageView &Image::get_vk_image_view() const
 	return *vk_image_view;
 }
 
+std::unique_ptr<core::ImageView> Image::set_resident_mip_level(uint32_t base_mip_level)
+{
+	assert(vk_image && "Vulkan image was not created");
+	assert(base_mip_level < vk_image->get_subresource().mipLevel && "Mip level out of range");
+
+	auto previous_vk_image_view = std::move(vk_image_view);
+
+	vk_image_view = std::make_unique<core::ImageView>(*vk_image, vk_image_view_type, VK_FORMAT_UNDEFINED,
+	                                                  base_mip_level, 0, vk_image->get_subresource().mipLevel - base_mip_level);
+
+	return previous_vk_image_view;
+}
+
 Mipmap &Image::get_mipmap(const size_t index)
 {
 	return mipmaps.at(index);
@@ -198,6 +220,25 @@ void Image::generate_mipmaps()
 	}
 }
 
+void Image::add_gpu_mipmaps()
+{
+	assert(!vk_image && "Vulkan image already constructed");
+
+	auto &extent = mipmaps.back().extent;
+
+	gpu_mip_level_count = 0;
+
+	for (auto size = std::max(extent.width, extent.height); size > 1; size /= 2)
+	{
+		gpu_mip_level_count++;
+	}
+}
+
+uint32_t Image::get_gpu_mip_level_count() const
+{
+	return gpu_mip_level_count;
+}
+
 std::vector<Mipmap> &Image::get_mut_mipmaps()
 {
 	return mipmaps;
@@ -80,12 +80,31 @@ class Image : public Component
 
 	void generate_mipmaps();
 
+	/**
+	 * @brief Adds the mip levels below the smallest level of the data, down to 1x1, to the Vulkan image.
+	 *        They are generated on the GPU with blits, once the smallest level is uploaded.
+	 *        It must be called before create_vk_image()
+	 */
+	void add_gpu_mipmaps();
+
+	/**
+	 * @return The number of mip levels generated on the GPU, which follow the levels of the data
+	 */
+	uint32_t get_gpu_mip_level_count() const;
+
 	void create_vk_image(Device &device, VkImageViewType image_view_type = VK_IMAGE_VIEW_TYPE_2D, VkImageCreateFlags flags = 0);
 
 	const core::Image &get_vk_image() const;
 
 	const core::ImageView &get_vk_image_view() const;
 
+	/**
+	 * @brief Restricts the view of the image to the mip levels from base_mip_level,
+	 *        so that only the levels which have been uploaded are sampled
+	 * @return The previous view, to destroy once the frames in flight which may use it have completed
+	 */
+	std::unique_ptr<core::ImageView> set_resident_mip_level(uint32_t base_mip_level);
+
   protected:
 	std::vector<uint8_t> &get_mut_data();
 
@@ -116,12 +135,16 @@ class Image : public Component
 
 	std::vector<Mipmap> mipmaps{{}};
 
+	uint32_t gpu_mip_level_count{0};
+
 	// Offsets stored like offsets[array_layer][mipmap_layer]
 	std::vector<std::vector<VkDeviceSize>> offsets;
 
 	std::unique_ptr<core::Image> vk_image;
 
 	std::unique_ptr<core::ImageView> vk_image_view;
+
+	VkImageViewType vk_image_view_type{VK_IMAGE_VIEW_TYPE_2D};
 };
 
 }        // namespace sg
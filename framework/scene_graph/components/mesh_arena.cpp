@@ -0,0 +1,156 @@
+/* Copyright (c) 2021, Samsung
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "mesh_arena.h"
+
+#include <map>
+
+#include "core/command_buffer.h"
+
+namespace vkb
+{
+namespace sg
+{
+namespace
+{
+/// Alignment of the data in the arena buffers, enough for any index type and vertex format
+constexpr VkDeviceSize data_alignment = 16;
+
+inline VkDeviceSize align_offset(VkDeviceSize offset)
+{
+	return (offset + data_alignment - 1) & ~(data_alignment - 1);
+}
+}        // namespace
+
+MeshArena::MeshArena(Device &device, const std::string &name) :
+    Component{name},
+    device{device}
+{}
+
+std::type_index MeshArena::get_type()
+{
+	return typeid(MeshArena);
+}
+
+void MeshArena::add(VkBufferUsageFlags usage, std::vector<uint8_t> &&data, BufferRange &range)
+{
+	size += data.size();
+
+	PendingData pending_data{usage, std::move(data), nullptr, 0, &range};
+	pending_data.data = pending_data.owned_data.data();
+	pending_data.size = pending_data.owned_data.size();
+
+	pending.push_back(std::move(pending_data));
+}
+
+void MeshArena::add(VkBufferUsageFlags usage, const uint8_t *data, size_t data_size, BufferRange &range)
+{
+	size += data_size;
+
+	pending.push_back({usage, {}, data, data_size, &range});
+}
+
+std::unique_ptr<core::Buffer> MeshArena::upload(CommandBuffer &command_buffer)
+{
+	if (pending.empty())
+	{
+		return nullptr;
+	}
+
+	// Lay out the data of each usage in its own buffer
+	std::map<VkBufferUsageFlags, VkDeviceSize> buffer_sizes;
+	std::vector<VkDeviceSize>                  offsets(pending.size());
+
+	for (size_t i = 0; i < pending.size(); i++)
+	{
+		auto &buffer_size = buffer_sizes[pending[i].usage];
+
+		offsets[i]  = buffer_size;
+		buffer_size = align_offset(buffer_size + pending[i].size);
+	}
+
+	// The staging buffer is the concatenation of the arena buffers,
+	// so that each one is filled with a single copy region
+	std::map<VkBufferUsageFlags, VkDeviceSize>  staging_offsets;
+	std::map<VkBufferUsageFlags, core::Buffer *> usage_buffers;
+	VkDeviceSize                                staging_size = 0;
+
+	for (auto &buffer_size : buffer_sizes)
+	{
+		staging_offsets[buffer_size.first] = staging_size;
+		staging_size += buffer_size.second;
+
+		auto buffer = std::make_unique<core::Buffer>(device,
+		                                             buffer_size.second,
+		                                             VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | buffer_size.first,
+		                                             VMA_MEMORY_USAGE_GPU_ONLY,
+		                                             0);
+
+		usage_buffers[buffer_size.first] = buffer.get();
+
+		buffers.push_back({buffer_size.first, std::move(buffer)});
+	}
+
+	auto staging_buffer = std::make_unique<core::Buffer>(device,
+	                                                     staging_size,
+	                                                     VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+	                                                     VMA_MEMORY_USAGE_CPU_ONLY);
+
+	for (size_t i = 0; i < pending.size(); i++)
+	{
+		auto &data = pending[i];
+
+		staging_buffer->update(data.data, data.size, staging_offsets[data.usage] + offsets[i]);
+
+		data.range->buffer = usage_buffers[data.usage];
+		data.range->offset = offsets[i];
+	}
+
+	for (auto &usage_buffer : usage_buffers)
+	{
+		VkBufferCopy copy_region{};
+		copy_region.srcOffset = staging_offsets[usage_buffer.first];
+		copy_region.size      = buffer_sizes[usage_buffer.first];
+
+		command_buffer.copy_buffer(*staging_buffer, *usage_buffer.second, {copy_region});
+
+		BufferMemoryBarrier memory_barrier{};
+		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+		memory_barrier.src_access_mask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		memory_barrier.dst_access_mask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+
+		command_buffer.buffer_memory_barrier(*usage_buffer.second, 0, VK_WHOLE_SIZE, memory_barrier);
+	}
+
+	pending.clear();
+
+	return staging_buffer;
+}
+
+VkDeviceSize MeshArena::get_size() const
+{
+	return size;
+}
+
+const std::vector<MeshArena::ArenaBuffer> &MeshArena::get_buffers() const
+{
+	return buffers;
+}
+}        // namespace sg
+}        // namespace vkb
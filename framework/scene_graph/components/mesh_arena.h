@@ -0,0 +1,120 @@
+/* Copyright (c) 2021, Samsung
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#include "common/vk_common.h"
+#include "core/buffer.h"
+#include "scene_graph/component.h"
+#include "scene_graph/components/sub_mesh.h"
+
+namespace vkb
+{
+class CommandBuffer;
+
+namespace sg
+{
+/**
+ * @brief Packs the vertex and index data of many submeshes into a few large
+ *        device local buffers, which are filled with a single staging upload
+ */
+class MeshArena : public Component
+{
+  public:
+	MeshArena(Device &device, const std::string &name = {});
+
+	MeshArena(MeshArena &&other) = default;
+
+	virtual ~MeshArena() = default;
+
+	virtual std::type_index get_type() override;
+
+	/**
+	 * @brief Adds data to the arena, which is copied to the GPU by upload()
+	 * @param usage VK_BUFFER_USAGE_VERTEX_BUFFER_BIT or VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+	 *        data of different usages is packed in different buffers
+	 * @param data The data to add
+	 * @param range Set to the location of the data by upload(), it must stay valid until then
+	 */
+	void add(VkBufferUsageFlags usage, std::vector<uint8_t> &&data, BufferRange &range);
+
+	/**
+	 * @brief Adds data which the arena does not own, e.g. mapped from a file, to the arena
+	 * @param usage VK_BUFFER_USAGE_VERTEX_BUFFER_BIT or VK_BUFFER_USAGE_INDEX_BUFFER_BIT
+	 * @param data The data to add, which must stay valid until upload()
+	 * @param data_size The number of bytes of the data
+	 * @param range Set to the location of the data by upload(), it must stay valid until then
+	 */
+	void add(VkBufferUsageFlags usage, const uint8_t *data, size_t data_size, BufferRange &range);
+
+	/**
+	 * @brief Creates a buffer for each usage of the data added since the last upload,
+	 *        and records the copy of all the data from a single staging buffer
+	 * @param command_buffer The command buffer to record the copies in
+	 * @return The staging buffer, to keep until the command buffer has executed,
+	 *         or nullptr if no data was added
+	 */
+	std::unique_ptr<core::Buffer> upload(CommandBuffer &command_buffer);
+
+	/**
+	 * @return The number of bytes of the data added to the arena
+	 */
+	VkDeviceSize get_size() const;
+
+	struct ArenaBuffer
+	{
+		VkBufferUsageFlags usage;
+
+		std::unique_ptr<core::Buffer> buffer;
+	};
+
+	/**
+	 * @return The buffers created by upload(), which can also be copied from, e.g. to read the data back
+	 */
+	const std::vector<ArenaBuffer> &get_buffers() const;
+
+  private:
+	struct PendingData
+	{
+		VkBufferUsageFlags usage;
+
+		/// The data, when owned by the arena
+		std::vector<uint8_t> owned_data;
+
+		const uint8_t *data;
+
+		size_t size;
+
+		BufferRange *range;
+	};
+
+	Device &device;
+
+	std::vector<PendingData> pending;
+
+	std::vector<ArenaBuffer> buffers;
+
+	VkDeviceSize size{0};
+};
+}        // namespace sg
+}        // namespace vkb
@@ -43,6 +43,16 @@ struct VertexAttribute
 	std::uint32_t offset = 0;
 };
 
+/**
+ * @brief A range of a buffer which holds the data of several submeshes, see MeshArena
+ */
+struct BufferRange
+{
+	const core::Buffer *buffer{nullptr};
+
+	VkDeviceSize offset{0};
+};
+
 class SubMesh : public Component
 {
   public:
@@ -62,10 +72,21 @@ class SubMesh : public Component
 
 	std::unique_ptr<core::Buffer> index_buffer;
 
+	/// Vertex data in shared buffers by attribute name, when each attribute has its own stream
+	std::unordered_map<std::string, BufferRange> packed_vertex_buffers;
+
+	/// Vertex data in a shared buffer, when all the attributes are interleaved in a single stream
+	BufferRange interleaved_vertex_buffer;
+
+	/// Index data in a shared buffer, used instead of index_buffer when set
+	BufferRange packed_index_buffer;
+
 	void set_attribute(const std::string &name, const VertexAttribute &attribute);
 
 	bool get_attribute(const std::string &name, VertexAttribute &attribute) const;
 
+	const std::unordered_map<std::string, VertexAttribute> &get_attributes() const;
+
 	void set_material(const Material &material);
 
 	const Material *get_material() const;
@@ -108,6 +108,13 @@ void Transform::invalidate_world_matrix()
 	update_world_matrix = true;
 }
 
+uint32_t Transform::get_world_matrix_version()
+{
+	update_world_transform();
+
+	return world_matrix_version;
+}
+
 void Transform::update_world_transform()
 {
 	if (!update_world_matrix)
@@ -126,6 +133,8 @@ void Transform::update_world_transform()
 	}
 
 	update_world_matrix = false;
+
+	world_matrix_version++;
 }
 
 }        // namespace sg
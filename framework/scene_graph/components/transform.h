@@ -73,6 +73,12 @@ class Transform : public Component
 	 */
 	void invalidate_world_matrix();
 
+	/**
+	 * @brief Returns a number that changes whenever the world matrix
+	 *        is recomputed, to let users cache values derived from it
+	 */
+	uint32_t get_world_matrix_version();
+
   private:
 	Node &node;
 
@@ -86,6 +92,8 @@ class Transform : public Component
 
 	bool update_world_matrix = false;
 
+	uint32_t world_matrix_version = 0;
+
 	void update_world_transform();
 };
 
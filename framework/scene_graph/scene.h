@@ -52,6 +52,8 @@ class Scene
 
 	void add_node(std::unique_ptr<Node> &&node);
 
+	const std::vector<std::unique_ptr<Node>> &get_nodes() const;
+
 	void add_child(Node &child);
 
 	std::unique_ptr<Component> get_model(uint32_t index = 0);
@@ -0,0 +1,88 @@
+/* Copyright (c) 2021, Samsung
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "gpu_time_stats_provider.h"
+
+#include "rendering/render_context.h"
+
+namespace vkb
+{
+namespace
+{
+const std::set<StatIndex> gpu_time_stats{StatIndex::gpu_time_scene,
+                                         StatIndex::gpu_time_postprocessing,
+                                         StatIndex::gpu_time_cmaa_detect,
+                                         StatIndex::gpu_time_cmaa_refine,
+                                         StatIndex::gpu_time_cmaa_combine,
+                                         StatIndex::gpu_time_cmaa_process};
+}        // namespace
+
+GpuTimeStatsProvider::GpuTimeStatsProvider(std::set<StatIndex> &requested_stats, RenderContext &render_context) :
+    render_context{render_context}
+{
+	const auto &limits = render_context.get_device().get_gpu().get_properties().limits;
+	if (!limits.timestampComputeAndGraphics)
+	{
+		return;
+	}
+
+	timestamp_period = limits.timestampPeriod;
+
+	for (auto stat : gpu_time_stats)
+	{
+		if (requested_stats.erase(stat) != 0)
+		{
+			stats.insert(stat);
+		}
+	}
+}
+
+bool GpuTimeStatsProvider::is_available(StatIndex index) const
+{
+	return stats.find(index) != stats.end();
+}
+
+StatsProvider::Counters GpuTimeStatsProvider::sample(float delta_time)
+{
+	Counters res;
+
+	if (stats.empty())
+	{
+		return res;
+	}
+
+	// The fence of the active frame has been waited on, so its previous timers are available
+	for (const auto &time : render_context.get_active_frame().collect_gpu_timers(timestamp_period))
+	{
+		if (is_available(time.first))
+		{
+			res[time.first].result = time.second;
+		}
+	}
+
+	return res;
+}
+
+void GpuTimeStatsProvider::begin_sampling(CommandBuffer &cb)
+{
+	if (!stats.empty())
+	{
+		render_context.get_active_frame().reset_gpu_timers(cb);
+	}
+}
+}        // namespace vkb
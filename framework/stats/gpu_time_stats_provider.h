@@ -0,0 +1,69 @@
+/* Copyright (c) 2021, Samsung
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include "stats_provider.h"
+
+namespace vkb
+{
+class RenderContext;
+
+/**
+ * @brief Provides the GPU time of the scopes timed with CommandBuffer::time_scope(),
+ *        measured with timestamp queries of each vkb::RenderFrame
+ */
+class GpuTimeStatsProvider : public StatsProvider
+{
+  public:
+	/**
+	 * @brief Constructs a GpuTimeStatsProvider
+	 * @param requested_stats Set of stats to be collected. Supported stats will be removed from the set.
+	 * @param render_context The render context
+	 */
+	GpuTimeStatsProvider(std::set<StatIndex> &requested_stats, RenderContext &render_context);
+
+	/**
+	 * @brief Checks if this provider can supply the given enabled stat
+	 * @param index The stat index
+	 * @return True if the stat is available, false otherwise
+	 */
+	bool is_available(StatIndex index) const override;
+
+	/**
+	 * @brief Retrieve the GPU times measured in the last submission of the active frame
+	 * @param delta_time Time since last sample
+	 */
+	Counters sample(float delta_time) override;
+
+	/**
+	 * @brief Resets the GPU timers of the active frame
+	 * @param cb The command buffer
+	 */
+	void begin_sampling(CommandBuffer &cb) override;
+
+  private:
+	RenderContext &render_context;
+
+	/// Nanoseconds per timestamp tick
+	float timestamp_period{1.0f};
+
+	/// The requested GPU time stats, empty if timestamps are not supported
+	std::set<StatIndex> stats;
+};
+}        // namespace vkb
@@ -0,0 +1,72 @@
+/* Copyright (c) 2021, Samsung
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "render_stats_provider.h"
+
+#include "rendering/render_context.h"
+
+namespace vkb
+{
+namespace
+{
+const std::set<StatIndex> render_stats{StatIndex::culled_submeshes};
+}        // namespace
+
+RenderStatsProvider::RenderStatsProvider(std::set<StatIndex> &requested_stats, RenderContext &render_context) :
+    render_context{render_context}
+{
+	for (auto stat : render_stats)
+	{
+		if (requested_stats.erase(stat) != 0)
+		{
+			stats.insert(stat);
+		}
+	}
+}
+
+bool RenderStatsProvider::is_available(StatIndex index) const
+{
+	return stats.find(index) != stats.end();
+}
+
+StatsProvider::Counters RenderStatsProvider::sample(float delta_time)
+{
+	Counters res;
+
+	if (stats.empty())
+	{
+		return res;
+	}
+
+	// Counters that were not added to in the frame read as zero
+	for (auto stat : stats)
+	{
+		res[stat].result = 0.0;
+	}
+
+	for (const auto &counter : render_context.get_active_frame().collect_counters())
+	{
+		if (is_available(counter.first))
+		{
+			res[counter.first].result = counter.second;
+		}
+	}
+
+	return res;
+}
+}        // namespace vkb
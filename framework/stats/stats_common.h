@@ -59,6 +59,15 @@ enum class StatIndex
 	gpu_ext_read_bytes,
 	gpu_ext_write_bytes,
 	gpu_tex_cycles,
+
+	gpu_time_scene,
+	gpu_time_postprocessing,
+	gpu_time_cmaa_detect,
+	gpu_time_cmaa_refine,
+	gpu_time_cmaa_combine,
+	gpu_time_cmaa_process,
+
+	culled_submeshes,
 };
 
 struct StatIndexHash
@@ -54,6 +54,14 @@ std::map<StatIndex, StatGraphData> StatsProvider::default_graph_map{
     {StatIndex::gpu_ext_write_stalls,  {"External Write Stalls",                       "{:4.1f} M/s",   float(1e-6)}},
     {StatIndex::gpu_ext_read_bytes,    {"External Read Bytes",                         "{:4.1f} MiB/s", 1.0f / (1024.0f * 1024.0f)}},
     {StatIndex::gpu_ext_write_bytes,   {"External Write Bytes",                        "{:4.1f} MiB/s", 1.0f / (1024.0f * 1024.0f)}},
+
+    {StatIndex::gpu_time_scene,          {"Scene GPU Time",                            "{:3.2f} ms",    1000.0f}},
+    {StatIndex::gpu_time_postprocessing, {"Post-processing GPU Time",                  "{:3.2f} ms",    1000.0f}},
+    {StatIndex::gpu_time_cmaa_detect,    {"CMAA Detect GPU Time",                      "{:3.2f} ms",    1000.0f}},
+    {StatIndex::gpu_time_cmaa_refine,    {"CMAA Refine GPU Time",                      "{:3.2f} ms",    1000.0f}},
+    {StatIndex::gpu_time_cmaa_combine,   {"CMAA Combine GPU Time",                     "{:3.2f} ms",    1000.0f}},
+    {StatIndex::gpu_time_cmaa_process,   {"CMAA Process GPU Time",                     "{:3.2f} ms",    1000.0f}},
+    {StatIndex::culled_submeshes,        {"Culled Submeshes",                          "{:4.0f}",       1.0f}},
     // clang-format on
 };
 
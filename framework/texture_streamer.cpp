@@ -0,0 +1,274 @@
+/* Copyright (c) 2021, Samsung
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "texture_streamer.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "core/device.h"
+#include "scene_graph/components/image.h"
+#include "scene_graph/components/texture.h"
+#include "scene_graph/scene.h"
+
+namespace vkb
+{
+namespace
+{
+/**
+ * @return The first mip level of the tail of an image, which is uploaded before the larger levels
+ */
+uint32_t get_mip_tail_level(const sg::Image &image)
+{
+	auto &mipmaps = image.get_mipmaps();
+
+	// Arrays and cubemaps are uploaded at once
+	if (image.get_layers() > 1)
+	{
+		return 0;
+	}
+
+	for (uint32_t level = 0; level < mipmaps.size(); level++)
+	{
+		auto &extent = mipmaps[level].extent;
+
+		if (std::max(extent.width, extent.height) <= TextureStreamer::MIP_TAIL_SIZE)
+		{
+			return level;
+		}
+	}
+
+	return to_u32(mipmaps.size()) - 1;
+}
+
+inline uint32_t get_thread_count()
+{
+	auto thread_count = std::thread::hardware_concurrency();
+	return thread_count == 0 ? 1 : thread_count;
+}
+}        // namespace
+
+TextureStreamer::TextureStreamer(Device &device, VkDeviceSize frame_budget) :
+    device{device},
+    frame_budget{frame_budget},
+    uploader{device, ImageUploader::DEFAULT_RING_SIZE, true},
+    thread_pool{static_cast<int>(get_thread_count())}
+{
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	// Images which are not decoded yet are not needed anymore
+	thread_pool.stop(false);
+
+	release_image_views(true);
+}
+
+std::unique_ptr<sg::Image> TextureStreamer::create_placeholder(bool normal_map)
+{
+	sg::Mipmap mipmap{};
+	mipmap.extent = {1u, 1u, 1u};
+
+	// A normal map encodes the normal (0, 0, 1) as the texel (0.5, 0.5, 1)
+	std::vector<uint8_t> texel{255, 255, 255, 255};
+
+	if (normal_map)
+	{
+		texel = {128, 128, 255, 255};
+	}
+
+	auto placeholder = std::make_unique<sg::Image>(normal_map ? "normal_placeholder" : "placeholder", std::move(texel), std::vector<sg::Mipmap>{mipmap});
+
+	placeholder->create_vk_image(device);
+
+	uploader.upload(*placeholder);
+	uploader.flush();
+
+	return placeholder;
+}
+
+void TextureStreamer::request(std::function<std::unique_ptr<sg::Image>()> &&decode, std::vector<sg::Texture *> &&textures)
+{
+	StreamedImage streamed_image;
+
+	streamed_image.decoded = thread_pool.push([decode = std::move(decode)](size_t) {
+		return decode();
+	});
+
+	streamed_image.textures = std::move(textures);
+
+	streamed_images.push_back(std::move(streamed_image));
+}
+
+void TextureStreamer::update(sg::Scene &scene)
+{
+	release_image_views(false);
+
+	for (auto &streamed_image : streamed_images)
+	{
+		make_resident(streamed_image, scene);
+	}
+
+	// The frames submitted until now may sample the replaced views, an empty submission
+	// to the queue which renders them tells when they have completed
+	if (!replaced_image_views.empty())
+	{
+		RetiredImageViews retired;
+
+		retired.image_views = std::move(replaced_image_views);
+		retired.fence_pool  = std::make_unique<FencePool>(device);
+
+		VK_CHECK(device.get_suitable_graphics_queue().submit(std::vector<VkSubmitInfo>{}, retired.fence_pool->request_fence()));
+
+		retired_image_views.push_back(std::move(retired));
+
+		replaced_image_views.clear();
+	}
+
+	VkDeviceSize uploaded_bytes = 0;
+
+	// Upload the mip tails of the decoded images first, so that fewer textures sample the placeholder
+	for (auto &streamed_image : streamed_images)
+	{
+		if (uploaded_bytes >= frame_budget)
+		{
+			break;
+		}
+
+		if (streamed_image.image || streamed_image.decoded.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			continue;
+		}
+
+		streamed_image.owned_image = streamed_image.decoded.get();
+		streamed_image.image       = streamed_image.owned_image.get();
+
+		auto mip_count = to_u32(streamed_image.image->get_mipmaps().size());
+
+		streamed_image.uploaded_mip_level = mip_count;
+		streamed_image.resident_mip_level = mip_count;
+
+		uploaded_bytes += upload(streamed_image, get_mip_tail_level(*streamed_image.image));
+	}
+
+	// Then upload the larger mip levels, one level of each image in turn
+	bool uploading = true;
+
+	while (uploading && uploaded_bytes < frame_budget)
+	{
+		uploading = false;
+
+		for (auto &streamed_image : streamed_images)
+		{
+			if (uploaded_bytes >= frame_budget)
+			{
+				break;
+			}
+
+			if (streamed_image.image && streamed_image.uploaded_mip_level > 0)
+			{
+				uploaded_bytes += upload(streamed_image, streamed_image.uploaded_mip_level - 1);
+				uploading = true;
+			}
+		}
+	}
+
+	uploader.submit();
+
+	// Images copied on the transfer queue are sampled once the graphics queue has acquired them
+	uploader.acquire();
+}
+
+bool TextureStreamer::is_complete() const
+{
+	return std::all_of(streamed_images.begin(), streamed_images.end(), [](const StreamedImage &streamed_image) {
+		return streamed_image.image && streamed_image.resident_mip_level == 0;
+	});
+}
+
+VkDeviceSize TextureStreamer::upload(StreamedImage &streamed_image, uint32_t base_mip_level)
+{
+	auto &image   = *streamed_image.image;
+	auto &mipmaps = image.get_mipmaps();
+
+	auto mip_level_count = streamed_image.uploaded_mip_level - base_mip_level;
+
+	// Measured before the upload, which clears the data with mip level 0
+	size_t data_end   = streamed_image.uploaded_mip_level < mipmaps.size() ? mipmaps[streamed_image.uploaded_mip_level].offset : image.get_data().size();
+	size_t data_bytes = data_end - mipmaps[base_mip_level].offset;
+
+	auto serial = uploader.upload(image, base_mip_level, mip_level_count);
+
+	streamed_image.uploads.emplace_back(serial, base_mip_level);
+	streamed_image.uploaded_mip_level = base_mip_level;
+
+	return data_bytes;
+}
+
+void TextureStreamer::make_resident(StreamedImage &streamed_image, sg::Scene &scene)
+{
+	auto resident_mip_level = streamed_image.resident_mip_level;
+
+	while (!streamed_image.uploads.empty() && uploader.is_complete(streamed_image.uploads.front().first))
+	{
+		resident_mip_level = streamed_image.uploads.front().second;
+		streamed_image.uploads.pop_front();
+	}
+
+	if (resident_mip_level == streamed_image.resident_mip_level)
+	{
+		return;
+	}
+
+	// The view created with the image already covers all the levels
+	if (resident_mip_level > 0 || !streamed_image.owned_image)
+	{
+		replaced_image_views.push_back(streamed_image.image->set_resident_mip_level(resident_mip_level));
+	}
+
+	if (streamed_image.owned_image)
+	{
+		for (auto texture : streamed_image.textures)
+		{
+			texture->set_image(*streamed_image.image);
+		}
+
+		scene.add_component(std::move(streamed_image.owned_image));
+	}
+
+	streamed_image.resident_mip_level = resident_mip_level;
+}
+
+void TextureStreamer::release_image_views(bool wait)
+{
+	while (!retired_image_views.empty())
+	{
+		auto &fence_pool = *retired_image_views.front().fence_pool;
+
+		if (wait)
+		{
+			VK_CHECK(fence_pool.wait());
+		}
+		else if (fence_pool.wait(0) != VK_SUCCESS)
+		{
+			break;
+		}
+
+		retired_image_views.pop_front();
+	}
+}
+}        // namespace vkb
@@ -0,0 +1,165 @@
+/* Copyright (c) 2021, Samsung
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include <ctpl_stl.h>
+
+#include "common/helpers.h"
+#include "common/vk_common.h"
+#include "core/image_view.h"
+#include "fence_pool.h"
+#include "image_uploader.h"
+
+namespace vkb
+{
+class Device;
+
+namespace sg
+{
+class Image;
+class Scene;
+class Texture;
+}        // namespace sg
+
+/**
+ * @brief Loads the images of a scene while it is rendered. Images are decoded on worker
+ *        threads, then uploaded at frame boundaries within a per frame budget, their
+ *        smallest mip levels first, on a dedicated transfer queue if the GPU has one.
+ *        The textures sample a placeholder until the smallest levels of their image
+ *        are resident, and then sample more levels as they arrive.
+ */
+class TextureStreamer
+{
+  public:
+	/// Default number of bytes of image data uploaded per frame
+	static constexpr VkDeviceSize DEFAULT_FRAME_BUDGET = 8 * 1024 * 1024;
+
+	/// The mip levels up to this width and height are uploaded together, before the larger levels
+	static constexpr uint32_t MIP_TAIL_SIZE = 64;
+
+	TextureStreamer(Device &device, VkDeviceSize frame_budget = DEFAULT_FRAME_BUDGET);
+
+	TextureStreamer(const TextureStreamer &) = delete;
+
+	TextureStreamer(TextureStreamer &&) = delete;
+
+	~TextureStreamer();
+
+	TextureStreamer &operator=(const TextureStreamer &) = delete;
+
+	TextureStreamer &operator=(TextureStreamer &&) = delete;
+
+	/**
+	 * @brief Creates a 1x1 image, uploaded before returning, for the textures to sample until their image is resident
+	 * @param normal_map Whether the placeholder stands for normal maps, which get a flat normal instead of white
+	 */
+	std::unique_ptr<sg::Image> create_placeholder(bool normal_map = false);
+
+	/**
+	 * @brief Queues the decoding of an image, which is then streamed to the GPU
+	 * @param decode Returns the image, with its Vulkan image created. It is called on a worker thread
+	 * @param textures The textures to point at the image once its smallest mip levels are resident
+	 */
+	void request(std::function<std::unique_ptr<sg::Image>()> &&decode, std::vector<sg::Texture *> &&textures);
+
+	/**
+	 * @brief Uploads the decoded images within the frame budget, and updates the textures whose
+	 *        image has more mip levels resident. It must be called at a frame boundary, before the
+	 *        frame is recorded. An image is added to the scene once it is first sampled
+	 * @param scene The scene which owns the textures
+	 */
+	void update(sg::Scene &scene);
+
+	/**
+	 * @return Whether all the mip levels of all the requested images are resident
+	 */
+	bool is_complete() const;
+
+  private:
+	struct StreamedImage
+	{
+		std::future<std::unique_ptr<sg::Image>> decoded;
+
+		/// The image, owned until it is added to the scene
+		std::unique_ptr<sg::Image> owned_image;
+
+		sg::Image *image{nullptr};
+
+		std::vector<sg::Texture *> textures;
+
+		/// The lowest mip level whose upload has been recorded
+		uint32_t uploaded_mip_level{0};
+
+		/// The lowest mip level which the textures sample
+		uint32_t resident_mip_level{0};
+
+		/// The uploads in flight, as the serial of their batch and their base mip level
+		std::deque<std::pair<uint64_t, uint32_t>> uploads;
+	};
+
+	/**
+	 * @brief Records the upload of mip levels from base_mip_level until the ones already uploaded
+	 * @return The number of bytes uploaded
+	 */
+	VkDeviceSize upload(StreamedImage &streamed_image, uint32_t base_mip_level);
+
+	/// Image views replaced at a frame boundary, which the frames recorded before may still use
+	struct RetiredImageViews
+	{
+		std::vector<std::unique_ptr<core::ImageView>> image_views;
+
+		/// Signaled once the work submitted to the graphics queue before the views were replaced has completed
+		std::unique_ptr<FencePool> fence_pool;
+	};
+
+	/**
+	 * @brief Points the textures at the mip levels of the image whose upload has completed
+	 */
+	void make_resident(StreamedImage &streamed_image, sg::Scene &scene);
+
+	/**
+	 * @brief Destroys the retired image views which the GPU has stopped using
+	 * @param wait Whether to wait for all of them
+	 */
+	void release_image_views(bool wait);
+
+	Device &device;
+
+	VkDeviceSize frame_budget;
+
+	std::vector<StreamedImage> streamed_images;
+
+	/// Views replaced during the current update
+	std::vector<std::unique_ptr<core::ImageView>> replaced_image_views;
+
+	/// Oldest first
+	std::deque<RetiredImageViews> retired_image_views;
+
+	/// Destroyed before the images it copies to, after waiting for the copies
+	ImageUploader uploader;
+
+	/// Destroyed first, discarding the pending decodes and waiting for the running ones
+	ctpl::thread_pool thread_pool;
+};
+}        // namespace vkb
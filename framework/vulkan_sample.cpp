@@ -31,11 +31,14 @@ VKBP_ENABLE_WARNINGS()
 #include "common/utils.h"
 #include "common/vk_common.h"
 #include "gltf_loader.h"
+#include "platform/filesystem.h"
 #include "platform/platform.h"
 #include "platform/window.h"
 #include "scene_graph/components/camera.h"
 #include "scene_graph/script.h"
 #include "scene_graph/scripts/free_camera.h"
+#include "scene_cache.h"
+#include "texture_streamer.h"
 
 #if defined(VK_USE_PLATFORM_ANDROID_KHR)
 #	include "platform/android/android_platform.h"
@@ -43,18 +46,69 @@ VKBP_ENABLE_WARNINGS()
 
 namespace vkb
 {
+namespace
+{
+/**
+ * @brief Checks that pipeline cache data was saved by the same driver and GPU,
+ *        as the header of VkPipelineCacheHeaderVersionOne describes
+ */
+bool is_pipeline_cache_compatible(const std::vector<uint8_t> &data, const VkPhysicalDeviceProperties &properties)
+{
+	const size_t header_size = 4 * sizeof(uint32_t) + VK_UUID_SIZE;
+	if (data.size() < header_size)
+	{
+		return false;
+	}
+
+	uint32_t header[4];
+	std::memcpy(header, data.data(), sizeof(header));
+
+	return header[0] >= header_size &&
+	       header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+	       header[2] == properties.vendorID &&
+	       header[3] == properties.deviceID &&
+	       std::memcmp(data.data() + sizeof(header), properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+/**
+ * @brief Reads a file from the cache directory, returning no data if it does not exist
+ */
+std::vector<uint8_t> read_cache_if_present(const std::string &filename)
+{
+	if (!fs::is_file(fs::path::get(fs::path::Type::Cache, filename)))
+	{
+		return {};
+	}
+
+	return fs::read_cache(filename);
+}
+}        // namespace
+
+VulkanSample::VulkanSample() = default;
+
 VulkanSample::~VulkanSample()
 {
+	wait_resource_cache_warmup();
+
 	if (device)
 	{
 		device->wait_idle();
 	}
 
+	texture_streamer.reset();
+	scene_loader.reset();
+
 	scene.reset();
 
 	stats.reset();
 	gui.reset();
 	render_context.reset();
+
+	if (resource_pipeline_cache != VK_NULL_HANDLE)
+	{
+		vkDestroyPipelineCache(device->get_handle(), resource_pipeline_cache, nullptr);
+	}
+
 	device.reset();
 
 	if (surface != VK_NULL_HANDLE)
@@ -116,6 +170,18 @@ bool VulkanSample::prepare(Platform &platform)
 
 	device = std::make_unique<vkb::Device>(gpu, surface, get_device_extensions());
 
+	// Resources created in a previous run are created again while the sample is preparing
+	load_resource_caches();
+
+	if (platform.get_app().get_options().contains("--async-pipelines"))
+	{
+		device->get_resource_cache().set_async_pipelines(true);
+	}
+
+	stream_textures = platform.get_app().get_options().contains("--stream-textures");
+
+	bake_scenes = platform.get_app().get_options().contains("--bake-scenes");
+
 	// Preparing render context for rendering
 	render_context = std::make_unique<vkb::RenderContext>(*device, surface, platform.get_window().get_width(), platform.get_window().get_height());
 	render_context->set_present_mode_priority({VK_PRESENT_MODE_FIFO_KHR,
@@ -138,8 +204,91 @@ void VulkanSample::prepare_render_context()
 	render_context->prepare();
 }
 
+void VulkanSample::load_resource_caches()
+{
+	auto pipeline_cache_data = read_cache_if_present(get_name() + "_pipeline_cache.bin");
+	if (!pipeline_cache_data.empty() && !is_pipeline_cache_compatible(pipeline_cache_data, device->get_gpu().get_properties()))
+	{
+		LOGW("Ignoring pipeline cache saved by a different driver or GPU");
+		pipeline_cache_data.clear();
+	}
+
+	VkPipelineCacheCreateInfo create_info{VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
+	create_info.initialDataSize = pipeline_cache_data.size();
+	create_info.pInitialData    = pipeline_cache_data.data();
+
+	VK_CHECK(vkCreatePipelineCache(device->get_handle(), &create_info, nullptr, &resource_pipeline_cache));
+
+	auto &resource_cache = device->get_resource_cache();
+	resource_cache.set_pipeline_cache(resource_pipeline_cache);
+
+	auto resource_data = read_cache_if_present(get_name() + "_resources.bin");
+	if (resource_data.empty())
+	{
+		return;
+	}
+
+	resource_cache_warmup = std::async(std::launch::async, [&resource_cache, resource_data]() {
+		try
+		{
+			resource_cache.warmup(resource_data);
+		}
+		catch (const std::exception &e)
+		{
+			// Resources that could not be replayed are created when first requested
+			LOGW("Failed to warm up the resource cache: {}", e.what());
+		}
+	});
+}
+
+void VulkanSample::wait_resource_cache_warmup()
+{
+	if (resource_cache_warmup.valid())
+	{
+		resource_cache_warmup.get();
+	}
+}
+
+void VulkanSample::save_resource_caches()
+{
+	if (resource_pipeline_cache == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	size_t data_size{0};
+	VK_CHECK(vkGetPipelineCacheData(device->get_handle(), resource_pipeline_cache, &data_size, nullptr));
+
+	std::vector<uint8_t> pipeline_cache_data(data_size);
+	VK_CHECK(vkGetPipelineCacheData(device->get_handle(), resource_pipeline_cache, &data_size, pipeline_cache_data.data()));
+	pipeline_cache_data.resize(data_size);
+
+	try
+	{
+		fs::write_cache(pipeline_cache_data, get_name() + "_pipeline_cache.bin");
+		fs::write_cache(device->get_resource_cache().serialize(), get_name() + "_resources.bin");
+	}
+	catch (const std::exception &e)
+	{
+		LOGW("Failed to save the resource caches: {}", e.what());
+	}
+}
+
 void VulkanSample::update_scene(float delta_time)
 {
+	if (texture_streamer)
+	{
+		texture_streamer->update(*scene);
+
+		if (texture_streamer->is_complete())
+		{
+			LOGI("All the scene images are resident");
+
+			texture_streamer.reset();
+			scene_loader.reset();
+		}
+	}
+
 	if (scene)
 	{
 		//Update scripts
@@ -195,6 +344,9 @@ void VulkanSample::update_gui(float delta_time)
 
 void VulkanSample::update(float delta_time)
 {
+	// Pipelines from the previous run should be ready before the first frame
+	wait_resource_cache_warmup();
+
 	update_scene(delta_time);
 
 	update_gui(delta_time);
@@ -357,9 +509,13 @@ void VulkanSample::finish()
 {
 	Application::finish();
 
+	wait_resource_cache_warmup();
+
 	if (device)
 	{
 		device->wait_idle();
+
+		save_resource_caches();
 	}
 }
 
@@ -420,9 +576,34 @@ void VulkanSample::set_viewport_and_scissor(vkb::CommandBuffer &command_buffer,
 
 void VulkanSample::load_scene(const std::string &path)
 {
-	GLTFLoader loader{*device};
+	if (bake_scenes)
+	{
+		scene = SceneCache{*device}.bake(path);
+	}
+	else
+	{
+		// A baked scene needs no parsing nor decoding, so its images are uploaded at once
+		scene = SceneCache{*device}.read_scene_from_cache(path);
 
-	scene = loader.read_scene_from_file(path);
+		if (!scene)
+		{
+			// The loader decodes the streamed images, so it is kept until they are resident
+			scene_loader = std::make_unique<GLTFLoader>(*device);
+
+			if (stream_textures)
+			{
+				texture_streamer = std::make_unique<TextureStreamer>(*device);
+				scene_loader->set_texture_streamer(texture_streamer.get());
+			}
+
+			scene = scene_loader->read_scene_from_file(path);
+
+			if (!texture_streamer)
+			{
+				scene_loader.reset();
+			}
+		}
+	}
 
 	if (!scene)
 	{
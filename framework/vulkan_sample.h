@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <future>
+
 #include "common/error.h"
 #include "common/utils.h"
 #include "common/vk_common.h"
@@ -32,6 +34,9 @@
 
 namespace vkb
 {
+class GLTFLoader;
+class TextureStreamer;
+
 /**
  * @mainpage Overview of the framework
  *
@@ -103,7 +108,7 @@ namespace vkb
 class VulkanSample : public Application
 {
   public:
-	VulkanSample() = default;
+	VulkanSample();
 
 	virtual ~VulkanSample();
 
@@ -124,7 +129,7 @@ class VulkanSample : public Application
 	virtual void finish() override;
 
 	/** 
-	 * @brief Loads the scene
+	 * @brief Loads the scene, from its baked file in the cache directory if there is one
 	 *
 	 * @param path The path of the glTF file
 	 */
@@ -297,6 +302,40 @@ class VulkanSample : public Application
 	Configuration configuration{};
 
   private:
+	/**
+	 * @brief Creates the pipeline cache from the data saved by a previous run, and starts
+	 *        creating the resources recorded by that run on a background thread
+	 */
+	void load_resource_caches();
+
+	/**
+	 * @brief Waits for the resources of the previous run to be created
+	 */
+	void wait_resource_cache_warmup();
+
+	/**
+	 * @brief Saves the pipeline cache and the recorded resources for the next run
+	 */
+	void save_resource_caches();
+
+	/** @brief Pipeline cache used by the resource cache, persisted across runs */
+	VkPipelineCache resource_pipeline_cache{VK_NULL_HANDLE};
+
+	/** @brief Background creation of the resources recorded by the previous run */
+	std::future<void> resource_cache_warmup;
+
+	/** @brief Whether the images of the scene are streamed while it is rendered, instead of being loaded by load_scene() */
+	bool stream_textures{false};
+
+	/** @brief Whether the scenes are baked into the cache directory when they are loaded */
+	bool bake_scenes{false};
+
+	/** @brief Loader of the scene, kept while its images are streamed */
+	std::unique_ptr<GLTFLoader> scene_loader;
+
+	/** @brief Streams the images of the scene, until they are all resident */
+	std::unique_ptr<TextureStreamer> texture_streamer;
+
 	/** @brief Set of device extensions to be enabled for this example and wether they are optional (must be set in the derived constructor) */
 	std::unordered_map<const char *, bool> device_extensions;
 
@@ -22,9 +22,10 @@
 #include "gui.h"
 #include "platform/filesystem.h"
 #include "platform/platform.h"
+#include "rendering/cmaa_pass.h"
 #include "rendering/postprocessing_renderpass.h"
-#include "rendering/postprocessing_computepass.h"
 #include "rendering/subpasses/forward_subpass.h"
+#include "scene_graph/components/sub_mesh.h"
 #include "stats/stats.h"
 
 namespace
@@ -70,14 +71,36 @@ const std::string to_string(VkResolveModeFlagBits mode)
 			return "Unknown";
 	}
 }
+
+const std::array<vkb::CMAAQuality, 4> cmaa_quality_list{vkb::CMAAQuality::Low, vkb::CMAAQuality::Medium, vkb::CMAAQuality::High, vkb::CMAAQuality::Ultra};
+
+const std::string to_string(vkb::CMAAQuality quality)
+{
+	switch (quality)
+	{
+		case vkb::CMAAQuality::Low:
+			return "Low";
+		case vkb::CMAAQuality::Medium:
+			return "Medium";
+		case vkb::CMAAQuality::High:
+			return "High";
+		case vkb::CMAAQuality::Ultra:
+			return "Ultra";
+		default:
+			return "Unknown";
+	}
+}
 }        // namespace
 
 CMAASample::CMAASample()
 {
+	// Vulkan 1.1 exposes the subgroup properties CMAA uses to pick its compute kernels
+	set_api_version(VK_API_VERSION_1_1);
+
 	// Extension of interest in this sample (optional)
 	add_device_extension(VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME, true);
 
-	// Extension dependency requirements (given that instance API version is 1.0.0)
+	// Extension dependency requirements (given that the GPU may only support API version 1.0.0)
 	add_instance_extension(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME, true);
 	add_device_extension(VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME, true);
 	add_device_extension(VK_KHR_MAINTENANCE2_EXTENSION_NAME, true);
@@ -101,6 +124,32 @@ bool CMAASample::prepare(vkb::Platform &platform)
 
     prepare_supported_sample_count_list();
 
+	// --cmaa-quality starts the sample with CMAA at the given preset
+	const auto &options = platform.get_app().get_options();
+	if (options.contains("--cmaa-quality"))
+	{
+		auto quality_arg = options.get_string("--cmaa-quality");
+		std::transform(quality_arg.begin(), quality_arg.end(), quality_arg.begin(), ::tolower);
+
+		auto quality_it = std::find_if(cmaa_quality_list.begin(), cmaa_quality_list.end(), [&quality_arg](vkb::CMAAQuality quality) {
+			auto name = to_string(quality);
+			std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+			return name == quality_arg;
+		});
+
+		if (quality_it != cmaa_quality_list.end())
+		{
+			gui_CMAA_quality       = *quality_it;
+			gui_CMAA_enabled       = true;
+			gui_sample_count       = VK_SAMPLE_COUNT_1_BIT;
+			gui_run_postprocessing = true;
+		}
+		else
+		{
+			LOGW("Unknown CMAA quality {}, expected low, medium, high or ultra", quality_arg);
+		}
+	}
+
 	depth_writeback_resolve_supported = device->is_enabled(VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME);
 	if (depth_writeback_resolve_supported)
 	{
@@ -110,6 +159,13 @@ bool CMAASample::prepare(vkb::Platform &platform)
 	//load_scene("scenes/bonza/Bonza.gltf");
     load_scene("scenes/space_module/SpaceModule.gltf");
 
+	// The scene shader also writes the luma of its color, which CMAA detects the edges from.
+	// Without CMAA the luma output has no attachment and is discarded.
+	for (auto sub_mesh : scene->get_components<vkb::sg::SubMesh>())
+	{
+		sub_mesh->get_mut_shader_variant().add_define("OUTPUT_LUMA");
+	}
+
 	auto &camera_node = vkb::add_free_camera(*scene, "main_camera", get_render_context().get_surface_extent());
 	camera            = dynamic_cast<vkb::sg::PerspectiveCamera *>(&camera_node.get_component<vkb::sg::Camera>());
 
@@ -120,40 +176,35 @@ bool CMAASample::prepare(vkb::Platform &platform)
 	scene_pipeline->add_subpass(std::move(scene_subpass));
 
 	vkb::ShaderSource postprocessing_vs("postprocessing/postprocessing.vert");
-    vkb::ShaderSource CMAA_vs("postprocessing/CMAA.vert");
 
     postprocessing_pipeline = std::make_unique<vkb::PostProcessingPipeline>(get_render_context(), postprocessing_vs);
 	postprocessing_pipeline->add_pass()
 	    .add_subpass(vkb::ShaderSource("postprocessing/outline.frag"));
 
-    fxaa_pipeline = std::make_unique<vkb::PostProcessingPipeline>(get_render_context(), postprocessing_vs);
+    fxaa_pipeline = std::make_unique<vkb::PostProcessingPipeline>(get_render_context(), std::move(postprocessing_vs));
     fxaa_pipeline->add_pass()
             .add_subpass(vkb::ShaderSource("postprocessing/fxaa.frag"));
 
-    cmaa_detect_pipeline = std::make_unique<vkb::PostProcessingPipeline>(get_render_context(), CMAA_vs);
-	cmaa_detect_pipeline->add_pass()
-			.add_subpass(vkb::ShaderSource("postprocessing/CMAA_Edge_Detect.frag"));
-
-    cmaa_first_intermediary_pipeline = std::make_unique<vkb::PostProcessingPipeline>(get_render_context(), postprocessing_vs);
-    cmaa_first_intermediary_pipeline->add_pass<vkb::PostProcessingComputePass>(vkb::ShaderSource("postprocessing/CMAA_Compute_Dispatch1.comp"));
-
-    cmaa_refine_pipeline = std::make_unique<vkb::PostProcessingPipeline>(get_render_context(), CMAA_vs);
-    cmaa_refine_pipeline->add_pass<vkb::PostProcessingComputePass>(vkb::ShaderSource("postprocessing/CMAA_Edge_Refine.comp"));
+	cmaa_pass = std::make_unique<vkb::CMAAPass>(get_render_context());
 
-    cmaa_combine_pipeline = std::make_unique<vkb::PostProcessingPipeline>(get_render_context(), CMAA_vs);
-    cmaa_combine_pipeline->add_pass<vkb::PostProcessingComputePass>(vkb::ShaderSource("postprocessing/CMAA_Edge_Combine.comp"));
-
-    cmaa_second_intermediary_pipeline = std::make_unique<vkb::PostProcessingPipeline>(get_render_context(), std::move(postprocessing_vs));
-	cmaa_second_intermediary_pipeline->add_pass<vkb::PostProcessingComputePass>(vkb::ShaderSource("postprocessing/CMAA_Compute_Dispatch2.comp"));
-
-	cmaa_process_pipeline = std::make_unique<vkb::PostProcessingPipeline>(get_render_context(), std::move(CMAA_vs));
-	cmaa_process_pipeline->add_pass<vkb::PostProcessingComputePass>(vkb::ShaderSource("postprocessing/CMAA_Process.comp"));
+	// --prebuild-shaders also compiles the CMAA variants that can be switched to in the GUI
+	if (options.contains("--prebuild-shaders"))
+	{
+		cmaa_pass->prebuild_shader_variants();
+	}
 
 	update_pipelines();
 
 	stats->request_stats({vkb::StatIndex::frame_times,
 	                      vkb::StatIndex::gpu_ext_read_bytes,
-	                      vkb::StatIndex::gpu_ext_write_bytes});
+	                      vkb::StatIndex::gpu_ext_write_bytes,
+	                      vkb::StatIndex::gpu_time_scene,
+	                      vkb::StatIndex::gpu_time_postprocessing,
+	                      vkb::StatIndex::gpu_time_cmaa_detect,
+	                      vkb::StatIndex::gpu_time_cmaa_refine,
+	                      vkb::StatIndex::gpu_time_cmaa_combine,
+	                      vkb::StatIndex::gpu_time_cmaa_process,
+	                      vkb::StatIndex::culled_submeshes});
 
 	gui = std::make_unique<vkb::Gui>(*this, platform.get_window(), stats.get());
 
@@ -165,71 +216,6 @@ void CMAASample::prepare_render_context()
 	get_render_context().prepare(1, std::bind(&CMAASample::create_render_target, this, std::placeholders::_1));
 }
 
-void CMAASample::createCMAAResources(vkb::Device &device, const VkExtent3D &extent)
-{
-
-    VkImageUsageFlags imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-    vkb::core::Image potential_edge_image{device,
-                                          VkExtent3D{extent.width/2, extent.height/2, extent.depth},
-                                          VK_FORMAT_R8G8B8A8_UNORM,
-                                          imageUsage,
-                                          VMA_MEMORY_USAGE_GPU_ONLY,
-                                          VK_SAMPLE_COUNT_1_BIT};
-    vkb::core::Image edge_image{device,
-                                VkExtent3D{extent.width/2, extent.height/2, extent.depth},
-                                VK_FORMAT_R8_UINT,
-                                VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
-                                VMA_MEMORY_USAGE_GPU_ONLY,
-                                VK_SAMPLE_COUNT_1_BIT};
-    vkb::core::Image edge_image2{device,
-                                 VkExtent3D{extent.width/2, extent.height, extent.depth},
-                                 VK_FORMAT_R8_UINT,
-                                 VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
-                                 VMA_MEMORY_USAGE_GPU_ONLY,
-                                 VK_SAMPLE_COUNT_1_BIT};
-    vkb::core::Image CMAA_colourImage{device,
-                                      extent,
-                                      VK_FORMAT_R8G8B8A8_UNORM,
-                                      VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-                                      VMA_MEMORY_USAGE_GPU_ONLY,
-                                      VK_SAMPLE_COUNT_1_BIT};
-
-    std::vector<vkb::core::Image> CMAA_Images;
-    CMAA_Images.push_back(std::move(potential_edge_image));
-    CMAA_PotentialEdgeRenderTarget = std::make_unique<vkb::RenderTarget>(std::move(CMAA_Images));
-
-    std::vector<vkb::core::Image> CMAA_EdgeImages;
-    CMAA_EdgeImages.push_back(std::move(edge_image));
-    CMAA_PartialEdgeRenderTarget = std::make_unique<vkb::RenderTarget>(std::move(CMAA_EdgeImages));
-
-    std::vector<vkb::core::Image> CMAA_EdgeImages2;
-    CMAA_EdgeImages2.push_back(std::move(edge_image2));
-    CMAA_FullEdgeRenderTarget = std::make_unique<vkb::RenderTarget>(std::move(CMAA_EdgeImages2));
-
-    std::vector<vkb::core::Image> CMAA_ColourImages;
-    CMAA_ColourImages.push_back(std::move(CMAA_colourImage));
-    CMAA_ColourRenderTarget = std::make_unique<vkb::RenderTarget>(std::move(CMAA_ColourImages));
-
-    VkDeviceSize posBufferSize = sizeof(uint32_t) * (extent.width * extent.height / 4);
-    VkDeviceSize candidateCountSize = sizeof(uint32_t) * 2;
-    VkDeviceSize indirectBufSize = sizeof(VkDispatchIndirectCommand);
-    VkDeviceSize wholeBufferSize = posBufferSize*2;
-	CMAA_edgeCandidateBuffer = std::make_unique<vkb::core::Buffer>(device, wholeBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-                                                      VMA_MEMORY_USAGE_GPU_ONLY, VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT);
-	CMAA_edgePosBuffer = std::make_unique<vkb::core::Buffer>(device, wholeBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-                                                      VMA_MEMORY_USAGE_GPU_ONLY, VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT);
-	CMAA_edgeCandidateAlloc = std::make_unique<vkb::BufferAllocation>(*CMAA_edgeCandidateBuffer, posBufferSize, 0);
-	CMAA_edgePosAlloc = std::make_unique<vkb::BufferAllocation>(*CMAA_edgePosBuffer, posBufferSize, 0);
-
-    CMAA_edgeCountBuffer = std::make_unique<vkb::core::Buffer>(device, candidateCountSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-                                                               VMA_MEMORY_USAGE_GPU_ONLY);
-	CMAA_edgeCountAlloc = std::make_unique<vkb::BufferAllocation>(*CMAA_edgeCountBuffer, candidateCountSize, 0);
-
-    CMAA_indirectBuffer = std::make_unique<vkb::core::Buffer>(device, indirectBufSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
-                                                              VMA_MEMORY_USAGE_GPU_ONLY);
-    CMAA_indirectBufAlloc = std::make_unique<vkb::BufferAllocation>(*CMAA_indirectBuffer, indirectBufSize, 0);
-}
-
 std::unique_ptr<vkb::RenderTarget> CMAASample::create_render_target(vkb::core::Image &&swapchain_image)
 {
 	auto &device = swapchain_image.get_device();
@@ -311,6 +297,12 @@ std::unique_ptr<vkb::RenderTarget> CMAASample::create_render_target(vkb::core::I
 		// The resolved color image will be read by the postprocessing
 		// renderpass
 		color_resolve_usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+
+		if (gui_CMAA_enabled)
+		{
+			// CMAA can blend the edges directly into the resolved color image
+			color_resolve_usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+		}
 	}
 
 	vkb::core::Image color_resolve_image{device,
@@ -320,6 +312,24 @@ std::unique_ptr<vkb::RenderTarget> CMAASample::create_render_target(vkb::core::I
 	                                     VMA_MEMORY_USAGE_GPU_ONLY,
 	                                     VK_SAMPLE_COUNT_1_BIT};
 
+	// CMAA reads the luma of the scene to detect the edges, the attachment is not needed otherwise
+	VkImageUsageFlags luma_usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	if (run_postprocessing && gui_CMAA_enabled)
+	{
+		luma_usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+	}
+	else
+	{
+		luma_usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+	}
+
+	vkb::core::Image luma_image{device,
+	                            extent,
+	                            VK_FORMAT_R8_UNORM,
+	                            luma_usage,
+	                            VMA_MEMORY_USAGE_GPU_ONLY,
+	                            VK_SAMPLE_COUNT_1_BIT};
+
     scene_load_store.clear();
 	std::vector<vkb::core::Image> images;
 
@@ -355,12 +365,17 @@ std::unique_ptr<vkb::RenderTarget> CMAASample::create_render_target(vkb::core::I
 	images.push_back(std::move(depth_resolve_image));
 	scene_load_store.push_back({VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_DONT_CARE});
 
-	color_atts = {i_swapchain, i_color_ms, i_color_resolve};
-	depth_atts = {i_depth, i_depth_resolve};
+	// Attachment 5 - Luma
+	// Used as an output by the scene renderpass if CMAA is enabled
+	// Used as an input by the CMAA edge detection
+	i_luma = 5;
+	images.push_back(std::move(luma_image));
+	scene_load_store.push_back({VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_DONT_CARE});
 
-	createCMAAResources(device, extent);
+	color_atts = {i_swapchain, i_color_ms, i_color_resolve, i_luma};
+	depth_atts = {i_depth, i_depth_resolve};
 
-    return std::make_unique<vkb::RenderTarget>(std::move(images));
+	return std::make_unique<vkb::RenderTarget>(std::move(images));
 }
 
 void CMAASample::update(float delta_time)
@@ -440,8 +455,9 @@ void CMAASample::update_for_scene_only(bool msaa_enabled)
 	scene_load_store[i_depth].store_op = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	disable_depth_writeback_resolve(scene_subpass, scene_load_store);
 
-	// Auxiliary single-sampled color attachment is not used
+	// Auxiliary single-sampled color and luma attachments are not used
 	scene_load_store[i_color_resolve].store_op = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	scene_load_store[i_luma].store_op          = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 
 	// Update the scene renderpass
 	scene_pipeline->set_load_store(scene_load_store);
@@ -472,6 +488,17 @@ void CMAASample::update_for_scene_and_postprocessing(bool msaa_enabled)
 		disable_depth_writeback_resolve(scene_subpass, scene_load_store);
 	}
 
+	// CMAA always runs without MSAA and detects the edges from the luma written alongside the color
+	if (!msaa_enabled && gui_CMAA_enabled)
+	{
+		scene_subpass->set_output_attachments({i_color_resolve, i_luma});
+		scene_load_store[i_luma].store_op = VK_ATTACHMENT_STORE_OP_STORE;
+	}
+	else
+	{
+		scene_load_store[i_luma].store_op = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	}
+
 	// Swapchain is not used in the scene renderpass
 	scene_load_store[i_swapchain].store_op = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 
@@ -661,25 +688,6 @@ void CMAASample::draw(vkb::CommandBuffer &command_buffer, vkb::RenderTarget &ren
 	}
 }
 
-void CMAASample::clearCMAAImages(vkb::CommandBuffer &command_buffer)
-{
-    vkb::ImageMemoryBarrier edgeBarrier = {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_TRANSFER_BIT,VK_ACCESS_SHADER_READ_BIT,VK_ACCESS_TRANSFER_WRITE_BIT ,VK_IMAGE_LAYOUT_UNDEFINED,VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL};
-    command_buffer.image_memory_barrier(CMAA_PartialEdgeRenderTarget->get_views()[0], edgeBarrier);
-    vkb::ImageMemoryBarrier finalEdgeBarrier = {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_TRANSFER_BIT,VK_ACCESS_SHADER_READ_BIT,VK_ACCESS_TRANSFER_WRITE_BIT,VK_IMAGE_LAYOUT_UNDEFINED,VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL};
-    command_buffer.image_memory_barrier(CMAA_FullEdgeRenderTarget->get_views()[0], finalEdgeBarrier);
-
-    VkClearColorValue clearColour = {0, 0, 0, 0};
-    command_buffer.clear_image(CMAA_PartialEdgeRenderTarget->get_views()[0].get_image(), clearColour);
-    command_buffer.clear_image(CMAA_FullEdgeRenderTarget->get_views()[0].get_image(), clearColour);
-
-    edgeBarrier = {VK_PIPELINE_STAGE_TRANSFER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_ACCESS_TRANSFER_WRITE_BIT,VK_ACCESS_SHADER_WRITE_BIT,VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,VK_IMAGE_LAYOUT_GENERAL};
-    command_buffer.image_memory_barrier(CMAA_PartialEdgeRenderTarget->get_views()[0], edgeBarrier);
-    CMAA_PartialEdgeRenderTarget->set_layout(0, VK_IMAGE_LAYOUT_GENERAL);
-    finalEdgeBarrier = {VK_PIPELINE_STAGE_TRANSFER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_ACCESS_TRANSFER_WRITE_BIT,VK_ACCESS_SHADER_WRITE_BIT,VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,VK_IMAGE_LAYOUT_GENERAL};
-    command_buffer.image_memory_barrier(CMAA_FullEdgeRenderTarget->get_views()[0], finalEdgeBarrier);
-    CMAA_FullEdgeRenderTarget->set_layout(0, VK_IMAGE_LAYOUT_GENERAL);
-}
-
 void CMAASample::postprocessing(vkb::CommandBuffer &command_buffer, vkb::RenderTarget &render_target,
                                 VkImageLayout &swapchain_layout, bool msaa_enabled)
 {
@@ -705,116 +713,24 @@ void CMAASample::postprocessing(vkb::CommandBuffer &command_buffer, vkb::RenderT
         fxaa_pipeline->draw(command_buffer, render_target);
 	} else if(gui_CMAA_enabled) {
 
-        clearCMAAImages(command_buffer);
-
-        vkb::BufferMemoryBarrier countBarrier = {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT};
-        command_buffer.buffer_memory_barrier(CMAA_edgeCountAlloc->get_buffer(), CMAA_edgeCountAlloc->get_offset(), CMAA_edgeCountAlloc->get_size(), countBarrier);
-        vkb::BufferMemoryBarrier candidatePosBarrier = {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,VK_ACCESS_SHADER_READ_BIT,VK_ACCESS_SHADER_WRITE_BIT};
-        command_buffer.buffer_memory_barrier(CMAA_edgeCandidateAlloc->get_buffer(), CMAA_edgeCandidateAlloc->get_offset(), CMAA_edgeCandidateAlloc->get_size(), candidatePosBarrier);
-
-		/// First CMAA Pass
-		auto &cmaa_subpass = cmaa_detect_pipeline->get_pass(0).get_subpass(0);
-        cmaa_subpass
-                .bind_sampled_image("inputSceneTexture", vkb::core::SampledImage(i_color_resolve, &render_target))
-                .bind_storage_image("outputSceneImage", vkb::core::SampledImage(0, CMAA_ColourRenderTarget.get()))
-                .bind_storage_buffer("threadCountBuffer", *CMAA_edgeCountAlloc)
-				.bind_storage_buffer("candidatePosBuffer", *CMAA_edgeCandidateAlloc);
-        cmaa_detect_pipeline->draw(command_buffer, *CMAA_PotentialEdgeRenderTarget);
-		command_buffer.end_render_pass();
-
-        countBarrier = {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT};
-        command_buffer.buffer_memory_barrier(CMAA_edgeCountAlloc->get_buffer(), CMAA_edgeCountAlloc->get_offset(), CMAA_edgeCountAlloc->get_size(), countBarrier);
-        vkb::BufferMemoryBarrier indirectBarrier = {VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_ACCESS_INDIRECT_COMMAND_READ_BIT,VK_ACCESS_SHADER_WRITE_BIT};
-        command_buffer.buffer_memory_barrier(CMAA_indirectBufAlloc->get_buffer(), CMAA_indirectBufAlloc->get_offset(), CMAA_indirectBufAlloc->get_size(), indirectBarrier);
-
-		cmaa_first_intermediary_pipeline->get_pass<vkb::PostProcessingComputePass>(0)
-		        .bind_storage_buffer("threadCountBuffer", *CMAA_edgeCountAlloc)
-				.bind_storage_buffer("indirectBuffer", *CMAA_indirectBufAlloc);
-        cmaa_first_intermediary_pipeline->draw(command_buffer, *CMAA_PotentialEdgeRenderTarget);
-
-        indirectBarrier = {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,VK_ACCESS_SHADER_WRITE_BIT,VK_ACCESS_INDIRECT_COMMAND_READ_BIT};
-        command_buffer.buffer_memory_barrier(CMAA_indirectBufAlloc->get_buffer(), CMAA_indirectBufAlloc->get_offset(), CMAA_indirectBufAlloc->get_size(), indirectBarrier);
-        countBarrier = {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT};
-        command_buffer.buffer_memory_barrier(CMAA_edgeCountAlloc->get_buffer(), CMAA_edgeCountAlloc->get_offset(), CMAA_edgeCountAlloc->get_size(), countBarrier);
-		candidatePosBarrier = {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_ACCESS_SHADER_WRITE_BIT,VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT};
-		command_buffer.buffer_memory_barrier(CMAA_edgeCandidateAlloc->get_buffer(), CMAA_edgeCandidateAlloc->get_offset(), CMAA_edgeCandidateAlloc->get_size(), candidatePosBarrier);
-
-		/// Second CMAA Pass
-        cmaa_refine_pipeline->get_pass<vkb::PostProcessingComputePass>(0)
-                .set_dispatch_size(CMAA_indirectBufAlloc.get())
-				.bind_sampled_image("candidateTexture", vkb::core::SampledImage(0, CMAA_PotentialEdgeRenderTarget.get()))
-				.bind_storage_image("partialEdgeImage", vkb::core::SampledImage(0, CMAA_PartialEdgeRenderTarget.get()))
-				.bind_storage_buffer("threadCountBuffer", *CMAA_edgeCountAlloc)
-				.bind_storage_buffer("candidatePosBuffer", *CMAA_edgeCandidateAlloc);
-		cmaa_refine_pipeline->draw(command_buffer, *CMAA_PotentialEdgeRenderTarget);
-
-		indirectBarrier = {VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_ACCESS_INDIRECT_COMMAND_READ_BIT,VK_ACCESS_SHADER_WRITE_BIT};
-		command_buffer.buffer_memory_barrier(CMAA_indirectBufAlloc->get_buffer(), CMAA_indirectBufAlloc->get_offset(), CMAA_indirectBufAlloc->get_size(), indirectBarrier);
-		countBarrier = {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT};
-		command_buffer.buffer_memory_barrier(CMAA_edgeCountAlloc->get_buffer(), CMAA_edgeCountAlloc->get_offset(), CMAA_edgeCountAlloc->get_size(), countBarrier);
-
-        cmaa_first_intermediary_pipeline->get_pass<vkb::PostProcessingComputePass>(0)
-                .bind_storage_buffer("threadCountBuffer", *CMAA_edgeCountAlloc)
-                .bind_storage_buffer("indirectBuffer", *CMAA_indirectBufAlloc);
-        cmaa_first_intermediary_pipeline->draw(command_buffer, *CMAA_PotentialEdgeRenderTarget);
-
-        indirectBarrier = {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,VK_ACCESS_SHADER_WRITE_BIT,VK_ACCESS_INDIRECT_COMMAND_READ_BIT};
-		command_buffer.buffer_memory_barrier(CMAA_indirectBufAlloc->get_buffer(), CMAA_indirectBufAlloc->get_offset(), CMAA_indirectBufAlloc->get_size(), indirectBarrier);
-		countBarrier = {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT};
-		command_buffer.buffer_memory_barrier(CMAA_edgeCountAlloc->get_buffer(), CMAA_edgeCountAlloc->get_offset(), CMAA_edgeCountAlloc->get_size(), countBarrier);
-		candidatePosBarrier = {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,VK_ACCESS_SHADER_READ_BIT};
-		command_buffer.buffer_memory_barrier(CMAA_edgeCandidateAlloc->get_buffer(), CMAA_edgeCandidateAlloc->get_offset(), CMAA_edgeCandidateAlloc->get_size(), candidatePosBarrier);
-		vkb::BufferMemoryBarrier edgePosBarrier = {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_ACCESS_SHADER_READ_BIT,VK_ACCESS_SHADER_WRITE_BIT};
-		command_buffer.buffer_memory_barrier(CMAA_edgePosAlloc->get_buffer(), CMAA_edgePosAlloc->get_offset(), CMAA_edgePosAlloc->get_size(), edgePosBarrier);
-
-		/// Third CMAA Pass
-		cmaa_combine_pipeline->get_pass<vkb::PostProcessingComputePass>(0)
-                .set_dispatch_size(CMAA_indirectBufAlloc.get())
-                .bind_sampled_image("partialEdgeTexture", vkb::core::SampledImage(0, CMAA_PartialEdgeRenderTarget.get()))
-				.bind_sampled_image("inputSceneTexture", vkb::core::SampledImage(i_color_resolve, &render_target))
-                .bind_storage_image("fullEdgeImage", vkb::core::SampledImage(0, CMAA_FullEdgeRenderTarget.get()))
-				.bind_storage_image("outputSceneImage", vkb::core::SampledImage(0, CMAA_ColourRenderTarget.get()))
-				.bind_storage_buffer("threadCountBuffer", *CMAA_edgeCountAlloc)
-                .bind_storage_buffer("candidatePosBuffer", *CMAA_edgeCandidateAlloc)
-                .bind_storage_buffer("edgePosBuffer", *CMAA_edgePosAlloc);
-        cmaa_combine_pipeline->draw(command_buffer, *CMAA_PotentialEdgeRenderTarget);
-
-		indirectBarrier = {VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_ACCESS_INDIRECT_COMMAND_READ_BIT,VK_ACCESS_SHADER_WRITE_BIT};
-		command_buffer.buffer_memory_barrier(CMAA_indirectBufAlloc->get_buffer(), CMAA_indirectBufAlloc->get_offset(), CMAA_indirectBufAlloc->get_size(), indirectBarrier);
-		countBarrier = {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT};
-		command_buffer.buffer_memory_barrier(CMAA_edgeCountAlloc->get_buffer(), CMAA_edgeCountAlloc->get_offset(), CMAA_edgeCountAlloc->get_size(), countBarrier);
-
-		cmaa_second_intermediary_pipeline->get_pass<vkb::PostProcessingComputePass>(0)
-				.bind_storage_buffer("threadCountBuffer", *CMAA_edgeCountAlloc)
-				.bind_storage_buffer("indirectBuffer", *CMAA_indirectBufAlloc);
-		cmaa_second_intermediary_pipeline->draw(command_buffer, *CMAA_PotentialEdgeRenderTarget);
-
-		indirectBarrier = {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,VK_ACCESS_SHADER_WRITE_BIT,VK_ACCESS_INDIRECT_COMMAND_READ_BIT};
-		command_buffer.buffer_memory_barrier(CMAA_indirectBufAlloc->get_buffer(), CMAA_indirectBufAlloc->get_offset(), CMAA_indirectBufAlloc->get_size(), indirectBarrier);
-		countBarrier = {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,VK_ACCESS_SHADER_READ_BIT};
-		command_buffer.buffer_memory_barrier(CMAA_edgeCountAlloc->get_buffer(), CMAA_edgeCountAlloc->get_offset(), CMAA_edgeCountAlloc->get_size(), countBarrier);
-		edgePosBarrier = {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,VK_ACCESS_SHADER_WRITE_BIT,VK_ACCESS_SHADER_READ_BIT};
-		command_buffer.buffer_memory_barrier(CMAA_edgePosAlloc->get_buffer(), CMAA_edgePosAlloc->get_offset(), CMAA_edgePosAlloc->get_size(), edgePosBarrier);
-
-		/// Fourth CMAA Pass
-		glm::vec2 invScreen = 1.f / glm::vec2(render_target.get_extent().width, render_target.get_extent().height);
-		cmaa_process_pipeline->get_pass<vkb::PostProcessingComputePass>(0)
-				.set_dispatch_size(CMAA_indirectBufAlloc.get())
-				.bind_sampled_image("fullEdgeTexture", vkb::core::SampledImage(0, CMAA_FullEdgeRenderTarget.get()))
-				.bind_sampled_image("inputSceneTexture", vkb::core::SampledImage(i_color_resolve, &render_target))
-				.bind_storage_image("outputSceneImage", vkb::core::SampledImage(0, CMAA_ColourRenderTarget.get()))
-				.bind_storage_buffer("threadCountBuffer", *CMAA_edgeCountAlloc)
-				.bind_storage_buffer("edgePosBuffer", *CMAA_edgePosAlloc)
-				.set_uniform_data(invScreen);
-		cmaa_process_pipeline->draw(command_buffer, *CMAA_PotentialEdgeRenderTarget);
+		cmaa_pass->set_compute_detect(gui_CMAA_compute_detect)
+		    .set_in_place(gui_CMAA_in_place)
+		    .set_tile_binning(gui_CMAA_tile_binning)
+		    .set_quality(gui_CMAA_quality)
+		    .set_temporal(gui_CMAA_temporal)
+		    .set_shared_luma(gui_CMAA_shared_luma);
 
+		// Detects and blends the edges, barriers between the CMAA stages are planned by the pass itself
+		auto cmaa_output = cmaa_pass->draw(command_buffer, render_target, i_color_resolve, i_luma);
+
+		glm::vec2 invScreen = 1.f / glm::vec2(render_target.get_extent().width, render_target.get_extent().height);
         auto &fxaa_pass = fxaa_pipeline->get_pass(0);
         fxaa_pass.set_uniform_data(invScreen);
 
         auto &fxaa_subpass = fxaa_pass.get_subpass(0);
         fxaa_subpass.get_fs_variant().clear();
         fxaa_subpass
-                .bind_sampled_image("samplerTexture", vkb::core::SampledImage(0, CMAA_ColourRenderTarget.get()));
+                .bind_sampled_image("samplerTexture", std::move(cmaa_output));
 
         // Second render pass
         // NOTE: Color and depth attachments are automatically transitioned to be bound as textures
@@ -989,6 +905,13 @@ void CMAASample::draw_gui()
 	const bool landscape    = camera->get_aspect_ratio() > 1.0f;
 	uint32_t   lines        = landscape ? 3 : 4;
 
+	if (gui_CMAA_enabled)
+	{
+		// The anti-aliasing selector, a row of CMAA toggles and a row with the quality selector,
+		// then the two resolve rows, in both orientations
+		lines = 5;
+	}
+
 	gui->show_options_window(
 	    [this, msaa_enabled, landscape]() {
 		    ImGui::AlignTextToFramePadding();
@@ -1042,12 +965,43 @@ void CMAASample::draw_gui()
 
                 ImGui::EndCombo();
 		    }
-		    if (landscape)
+		    if (landscape && !gui_CMAA_enabled)
 		    {
 			    ImGui::SameLine();
 		    }
 		    if (!gui_FXAA_enabled && !gui_CMAA_enabled)
 		        ImGui::Checkbox("Post-processing (2 renderpasses)", &gui_run_postprocessing);
+		    else if (gui_CMAA_enabled)
+		    {
+			    ImGui::Checkbox("Compute detect", &gui_CMAA_compute_detect);
+			    ImGui::SameLine();
+			    ImGui::Checkbox("In-place", &gui_CMAA_in_place);
+			    ImGui::SameLine();
+			    ImGui::Checkbox("Tile binning", &gui_CMAA_tile_binning);
+
+			    ImGui::Text("Quality: ");
+			    ImGui::SameLine();
+			    if (ImGui::BeginCombo("##cmaa_quality", to_string(gui_CMAA_quality).c_str()))
+			    {
+				    for (auto quality : cmaa_quality_list)
+				    {
+					    bool is_selected = gui_CMAA_quality == quality;
+					    if (ImGui::Selectable(to_string(quality).c_str(), is_selected))
+					    {
+						    gui_CMAA_quality = quality;
+					    }
+					    if (is_selected)
+					    {
+						    ImGui::SetItemDefaultFocus();
+					    }
+				    }
+				    ImGui::EndCombo();
+			    }
+			    ImGui::SameLine();
+			    ImGui::Checkbox("Temporal", &gui_CMAA_temporal);
+			    ImGui::SameLine();
+			    ImGui::Checkbox("Shared luma", &gui_CMAA_shared_luma);
+		    }
 
             ImGui::Text("Resolve color: ");
 		    ImGui::SameLine();
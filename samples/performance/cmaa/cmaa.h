@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include "rendering/cmaa_pass.h"
 #include "rendering/postprocessing_pipeline.h"
 #include "rendering/render_pipeline.h"
 #include "scene_graph/components/perspective_camera.h"
@@ -96,14 +97,7 @@ class CMAASample : public vkb::VulkanSample
 	std::unique_ptr<vkb::PostProcessingPipeline> postprocessing_pipeline{};
     std::unique_ptr<vkb::PostProcessingPipeline> fxaa_pipeline{};
 
-    std::unique_ptr<vkb::PostProcessingPipeline> cmaa_detect_pipeline{};
-	std::unique_ptr<vkb::PostProcessingPipeline> cmaa_refine_pipeline{};
-    std::unique_ptr<vkb::PostProcessingPipeline> cmaa_combine_pipeline{};
-	std::unique_ptr<vkb::PostProcessingPipeline> cmaa_process_pipeline{};
-
-	/// Intermediary passes divide the detected edges into workgroups for indirect dispatching
-	std::unique_ptr<vkb::PostProcessingPipeline> cmaa_first_intermediary_pipeline{};
-	std::unique_ptr<vkb::PostProcessingPipeline> cmaa_second_intermediary_pipeline{};
+	std::unique_ptr<vkb::CMAAPass> cmaa_pass{};
 
     /**
 	 * @brief Update MSAA options and accordingly set the load/store
@@ -249,22 +243,7 @@ class CMAASample : public vkb::VulkanSample
 
 	uint32_t i_depth_resolve{0};
 
-	std::unique_ptr<vkb::core::Buffer> CMAA_edgeCandidateBuffer;
-	std::unique_ptr<vkb::core::Buffer> CMAA_edgePosBuffer;
-	std::unique_ptr<vkb::core::Buffer> CMAA_edgeCountBuffer;
-	std::unique_ptr<vkb::core::Buffer> CMAA_indirectBuffer;
-    std::unique_ptr<vkb::BufferAllocation> CMAA_edgePosAlloc;
-    std::unique_ptr<vkb::BufferAllocation> CMAA_edgeCandidateAlloc;
-    std::unique_ptr<vkb::BufferAllocation> CMAA_edgeCountAlloc;
-    std::unique_ptr<vkb::BufferAllocation> CMAA_indirectBufAlloc;
-
-    std::unique_ptr<vkb::RenderTarget> CMAA_PotentialEdgeRenderTarget;
-    std::unique_ptr<vkb::RenderTarget> CMAA_PartialEdgeRenderTarget;
-    std::unique_ptr<vkb::RenderTarget> CMAA_FullEdgeRenderTarget;
-    std::unique_ptr<vkb::RenderTarget> CMAA_ColourRenderTarget;
-
-    void createCMAAResources(vkb::Device &device, const VkExtent3D &extent);
-    void clearCMAAImages(vkb::CommandBuffer &command_buffer);
+	uint32_t i_luma{0};
 
     std::vector<uint32_t> color_atts{};
 
@@ -301,6 +280,18 @@ class CMAASample : public vkb::VulkanSample
     bool gui_CMAA_enabled{false};
 
     bool last_gui_CMAA_enabled{false};
+
+	bool gui_CMAA_compute_detect{true};
+
+	bool gui_CMAA_in_place{false};
+
+	bool gui_CMAA_tile_binning{false};
+
+	vkb::CMAAQuality gui_CMAA_quality{vkb::CMAAQuality::High};
+
+	bool gui_CMAA_temporal{false};
+
+	bool gui_CMAA_shared_luma{false};
 };
 
 std::unique_ptr<vkb::VulkanSample> create_cmaa();
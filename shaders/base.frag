@@ -28,6 +28,11 @@ layout(location = 2) in vec3 in_normal;
 
 layout(location = 0) out vec4 o_color;
 
+// OUTPUT_LUMA: the luma of the color is also written, for post-processing that only needs the luma
+#ifdef OUTPUT_LUMA
+layout(location = 1) out float o_luma;
+#endif
+
 layout(set = 0, binding = 1) uniform GlobalUniform
 {
 	mat4 model;
@@ -92,4 +97,9 @@ void main(void)
 	vec3 ambient_color = vec3(0.2) * base_color.xyz;
 
 	o_color = vec4(ambient_color + light_contribution * base_color.xyz, base_color.w);
+
+#ifdef OUTPUT_LUMA
+	// Clamped as the color attachment would be, with the weights of the CMAA edge detection
+	o_luma = dot(clamp(o_color.rgb, 0.0, 1.0), vec3(0.299, 0.587, 0.114));
+#endif
 }
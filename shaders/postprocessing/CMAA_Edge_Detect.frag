@@ -21,7 +21,16 @@ precision mediump int;
 
 layout (set = 0, binding = 1) uniform sampler2D inputSceneTexture;
 
+// CMAA_LUMA_INPUT: the luma is read from an R8 image written by the scene pass alongside its
+// colour, so the scene is only fetched for the copy to the output
+#ifdef CMAA_LUMA_INPUT
+layout (set = 0, binding = 5) uniform sampler2D inputLumaTexture;
+#endif
+
+// CMAA_IN_PLACE: the scene image is the CMAA output, so it does not need to be copied
+#ifndef CMAA_IN_PLACE
 restrict layout (set = 0, binding = 2) writeonly uniform image2D outputSceneImage;
+#endif
 
 restrict layout (set = 0, binding = 3) buffer threadCountBuffer
 {
@@ -34,10 +43,14 @@ restrict layout (set = 0, binding = 4) writeonly buffer candidatePosBuffer
 
 layout (location = 0) out vec4 outEdges;
 
-float EdgeDetectColorCalcDiff( vec3 colorA, vec3 colorB )
+// Luma difference above which neighbouring pixels are considered to have an edge between them, set by the quality preset
+layout (constant_id = 0) const float colourThreshold = 0.08;
+
+const vec3 cLumaConsts = vec3(0.299, 0.587, 0.114);                     // this matches FXAA (http://en.wikipedia.org/wiki/CCIR_601); above code uses http://en.wikipedia.org/wiki/Rec._709 
+
+float EdgeDetectColorCalcDiff( float lumaA, float lumaB )
 {
-    const vec3 cLumaConsts = vec3(0.299, 0.587, 0.114);                     // this matches FXAA (http://en.wikipedia.org/wiki/CCIR_601); above code uses http://en.wikipedia.org/wiki/Rec._709 
-    return abs( dot( colorA, cLumaConsts ) - dot( colorB, cLumaConsts ) );
+    return abs( lumaA - lumaB );
 }
 
 void main()
@@ -55,8 +68,17 @@ void main()
     float storeFlagFrag12 = 0;
 
     vec2 et;
-	const float colourThreshold = 0.08;
 	
+#ifdef CMAA_LUMA_INPUT
+	float luma00 = texelFetch(inputLumaTexture, screenPosI, 0).r;
+	float luma10 = texelFetch(inputLumaTexture, screenPosI + ivec2(1,0), 0).r;
+	float luma01 = texelFetch(inputLumaTexture, screenPosI + ivec2(0,1), 0).r;
+	float luma20 = texelFetch(inputLumaTexture, screenPosI + ivec2(2,0), 0).r;
+	float luma11 = texelFetch(inputLumaTexture, screenPosI + ivec2(1,1), 0).r;
+	float luma02 = texelFetch(inputLumaTexture, screenPosI + ivec2(0,2), 0).r;
+	float luma21 = texelFetch(inputLumaTexture, screenPosI + ivec2(2,1), 0).r;
+	float luma12 = texelFetch(inputLumaTexture, screenPosI + ivec2(1,2), 0).r;
+#else
 	vec3 frag00 = texelFetch(inputSceneTexture, screenPosI, 0).rgb;
 	vec3 frag10 = texelFetch(inputSceneTexture, screenPosI + ivec2(1,0), 0).rgb;
 	vec3 frag01 = texelFetch(inputSceneTexture, screenPosI + ivec2(0,1), 0).rgb;
@@ -66,9 +88,19 @@ void main()
 	vec3 frag21 = texelFetch(inputSceneTexture, screenPosI + ivec2(2,1), 0).rgb;
 	vec3 frag12 = texelFetch(inputSceneTexture, screenPosI + ivec2(1,2), 0).rgb;
 
+	float luma00 = dot( frag00, cLumaConsts );
+	float luma10 = dot( frag10, cLumaConsts );
+	float luma01 = dot( frag01, cLumaConsts );
+	float luma20 = dot( frag20, cLumaConsts );
+	float luma11 = dot( frag11, cLumaConsts );
+	float luma02 = dot( frag02, cLumaConsts );
+	float luma21 = dot( frag21, cLumaConsts );
+	float luma12 = dot( frag12, cLumaConsts );
+#endif
+
 	{
-        et.x = EdgeDetectColorCalcDiff( frag00, frag10 );
-        et.y = EdgeDetectColorCalcDiff( frag00, frag01 );
+        et.x = EdgeDetectColorCalcDiff( luma00, luma10 );
+        et.y = EdgeDetectColorCalcDiff( luma00, luma01 );
         et = clamp( et - colourThreshold, 0.0, 1.0 );
         uvec2 eti = uvec2( et * 15 + 0.99 );
         outEdges.x = float(eti.x | (eti.y << 4)) / 255.0;
@@ -80,8 +112,8 @@ void main()
     }
 		
     {
-        et.x = EdgeDetectColorCalcDiff( frag10, frag20 );
-        et.y = EdgeDetectColorCalcDiff( frag10, frag11 );
+        et.x = EdgeDetectColorCalcDiff( luma10, luma20 );
+        et.y = EdgeDetectColorCalcDiff( luma10, luma11 );
         et = clamp( et - colourThreshold, 0.0, 1.0 );
         uvec2 eti = uvec2( et * 15 + 0.99 );
         outEdges.y = float(eti.x | (eti.y << 4)) / 255.0;
@@ -93,8 +125,8 @@ void main()
 	}
 	
     {
-        et.x = EdgeDetectColorCalcDiff( frag01, frag11 );
-        et.y = EdgeDetectColorCalcDiff( frag01, frag02 );
+        et.x = EdgeDetectColorCalcDiff( luma01, luma11 );
+        et.y = EdgeDetectColorCalcDiff( luma01, luma02 );
         et = clamp( et - colourThreshold, 0.0, 1.0 );
         uvec2 eti = uvec2( et * 15 + 0.99 );
         outEdges.z = float(eti.x | (eti.y << 4)) / 255.0;
@@ -106,8 +138,8 @@ void main()
 	}
 	
     {
-        et.x = EdgeDetectColorCalcDiff( frag11, frag21 );
-        et.y = EdgeDetectColorCalcDiff( frag11, frag12 );
+        et.x = EdgeDetectColorCalcDiff( luma11, luma21 );
+        et.y = EdgeDetectColorCalcDiff( luma11, luma12 );
         et = clamp( et - colourThreshold, 0.0, 1.0 );
         uvec2 eti = uvec2( et * 15 + 0.99 );
         outEdges.w = float(eti.x | (eti.y << 4)) / 255.0;
@@ -118,10 +150,18 @@ void main()
         storeFlagFrag12 += et.y;
     }
 	
+#ifndef CMAA_IN_PLACE
+#ifdef CMAA_LUMA_INPUT
+	vec3 frag00 = texelFetch(inputSceneTexture, screenPosI, 0).rgb;
+	vec3 frag10 = texelFetch(inputSceneTexture, screenPosI + ivec2(1,0), 0).rgb;
+	vec3 frag01 = texelFetch(inputSceneTexture, screenPosI + ivec2(0,1), 0).rgb;
+	vec3 frag11 = texelFetch(inputSceneTexture, screenPosI + ivec2(1,1), 0).rgb;
+#endif
 	imageStore(outputSceneImage, screenPosI.xy + ivec2( 0, 0 ), vec4(frag00, 1.0));
 	imageStore(outputSceneImage, screenPosI.xy + ivec2( 1, 0 ), vec4(frag10, 1.0));
 	imageStore(outputSceneImage, screenPosI.xy + ivec2( 0, 1 ), vec4(frag01, 1.0));
 	imageStore(outputSceneImage, screenPosI.xy + ivec2( 1, 1 ), vec4(frag11, 1.0));
+#endif
 	
 	if(any(bvec4(outEdges)))
     {		
@@ -0,0 +1,126 @@
+/* Copyright (c) 2021, Samsung
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures how ResourceCache lookups scale with the number of threads requesting
+// resources at the same time, as the threads recording command buffers do.
+// Run it from the root of the repository, where the shaders directory is.
+
+#include <algorithm>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "common/logging.h"
+#include "core/buffer.h"
+#include "core/device.h"
+#include "core/instance.h"
+#include "resource_cache.h"
+#include "timer.h"
+
+namespace
+{
+/// Requests per thread, enough for the timings to dwarf the cost of starting the threads
+constexpr uint32_t REQUEST_COUNT{100000};
+
+/**
+ * @brief Requests the resources a command buffer needs to dispatch a compute shader,
+ *        both of whose storage buffers are bound to the same buffer
+ */
+void request_dispatch_resources(vkb::ResourceCache &resource_cache, const vkb::ShaderSource &shader_source, const vkb::core::Buffer &buffer)
+{
+	auto &shader_module   = resource_cache.request_shader_module(VK_SHADER_STAGE_COMPUTE_BIT, shader_source);
+	auto &pipeline_layout = resource_cache.request_pipeline_layout({&shader_module});
+
+	vkb::PipelineState pipeline_state;
+	pipeline_state.set_pipeline_layout(pipeline_layout);
+
+	resource_cache.request_compute_pipeline(pipeline_state);
+
+	VkDescriptorBufferInfo buffer_info{buffer.get_handle(), 0, VK_WHOLE_SIZE};
+
+	BindingMap<VkDescriptorBufferInfo> buffer_infos{{0, {{0, buffer_info}}},
+	                                                {1, {{0, buffer_info}}}};
+
+	resource_cache.request_descriptor_set(pipeline_layout.get_descriptor_set_layout(0), buffer_infos, {});
+}
+
+/**
+ * @brief Logs the request rate from 1 to hardware_concurrency() threads, against the rate of a single thread
+ */
+void measure_scaling(vkb::Device &device)
+{
+	auto &resource_cache = device.get_resource_cache();
+
+	vkb::ShaderSource shader_source{"postprocessing/CMAA_Bin_Scan.comp"};
+	vkb::core::Buffer buffer{device, 256, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY};
+
+	// Create the resources up front, so that only lookups are measured
+	request_dispatch_resources(resource_cache, shader_source, buffer);
+
+	uint32_t max_thread_count = std::max(1u, std::thread::hardware_concurrency());
+	double   single_thread_rate{0.0};
+
+	for (uint32_t thread_count = 1; thread_count <= max_thread_count; thread_count *= 2)
+	{
+		vkb::Timer timer;
+		timer.start();
+
+		std::vector<std::thread> threads;
+		for (uint32_t i = 0; i < thread_count; i++)
+		{
+			threads.emplace_back([&resource_cache, &shader_source, &buffer]() {
+				for (uint32_t j = 0; j < REQUEST_COUNT; j++)
+				{
+					request_dispatch_resources(resource_cache, shader_source, buffer);
+				}
+			});
+		}
+
+		for (auto &thread : threads)
+		{
+			thread.join();
+		}
+
+		auto rate = thread_count * REQUEST_COUNT / timer.stop();
+		if (thread_count == 1)
+		{
+			single_thread_rate = rate;
+		}
+
+		LOGI("{} thread(s): {:.2f}M requests/s, {:.2f}x the rate of a single thread", thread_count, rate / 1e6, rate / single_thread_rate);
+	}
+}
+}        // namespace
+
+int main()
+{
+	try
+	{
+		// No window is needed, only a device
+		vkb::Instance instance{"resource_cache_scaling", {}, {}, true};
+		vkb::Device   device{instance.get_suitable_gpu(), VK_NULL_HANDLE, {}};
+
+		measure_scaling(device);
+	}
+	catch (const std::exception &e)
+	{
+		LOGE("Resource cache scaling benchmark failed: {}", e.what());
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,82 @@
+/* Copyright (c) 2021, Samsung
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdlib>
+#include <functional>
+#include <stdexcept>
+#include <string>
+
+#include "common/logging.h"
+#include "core/device.h"
+#include "core/instance.h"
+
+namespace vkbtest
+{
+/// Exit code of a test which cannot run, which ctest reports as skipped
+constexpr int SKIP_RETURN_CODE{77};
+
+/**
+ * @brief Fails the running test unless a condition holds
+ */
+inline void check(bool condition, const std::string &message)
+{
+	if (!condition)
+	{
+		throw std::runtime_error(message);
+	}
+}
+
+/**
+ * @brief Runs a test against a headless device
+ * @param name The name of the test
+ * @param test Checks the framework with the instance and the device, throwing if it fails
+ * @return The exit code of the test executable, SKIP_RETURN_CODE if no device can be created
+ */
+inline int run_device_test(const std::string &name, const std::function<void(vkb::Instance &, vkb::Device &)> &test)
+{
+	std::unique_ptr<vkb::Instance> instance;
+	std::unique_ptr<vkb::Device>   device;
+
+	try
+	{
+		// No window is needed, only a device
+		instance = std::make_unique<vkb::Instance>(name, std::unordered_map<const char *, bool>{}, std::vector<const char *>{}, true);
+		device   = std::make_unique<vkb::Device>(instance->get_suitable_gpu(), static_cast<VkSurfaceKHR>(VK_NULL_HANDLE), std::unordered_map<const char *, bool>{});
+	}
+	catch (const std::exception &e)
+	{
+		LOGW("Skipping {}, no device: {}", name, e.what());
+		return SKIP_RETURN_CODE;
+	}
+
+	try
+	{
+		test(*instance, *device);
+	}
+	catch (const std::exception &e)
+	{
+		LOGE("{} failed: {}", name, e.what());
+		return EXIT_FAILURE;
+	}
+
+	LOGI("{} passed", name);
+
+	return EXIT_SUCCESS;
+}
+}        // namespace vkbtest
@@ -0,0 +1,92 @@
+/* Copyright (c) 2021, Samsung
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Streams several times the size of the staging ring through an ImageUploader, so that the
+// uploads wrap around the ring and wait for older batches to make space while others are in flight
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "framework_test.h"
+#include "image_uploader.h"
+#include "scene_graph/components/image.h"
+
+namespace
+{
+/// Small enough for the uploads to go round it several times
+constexpr VkDeviceSize RING_SIZE{4 * 1024 * 1024};
+
+void test_ring_wrap(vkb::Instance & /*instance*/, vkb::Device &device)
+{
+	vkb::ImageUploader uploader{device, RING_SIZE};
+
+	std::vector<std::unique_ptr<vkb::sg::Image>> images;
+	std::vector<uint64_t>                        serials;
+
+	VkDeviceSize streamed_size{0};
+
+	while (streamed_size < 8 * RING_SIZE)
+	{
+		// Sizes which do not divide the ring, so that some uploads skip its end
+		uint32_t extent = images.size() % 3 == 0 ? 512 : 384;
+
+		vkb::sg::Mipmap mipmap{};
+		mipmap.extent = {extent, extent, 1};
+
+		std::vector<uint8_t> data(extent * extent * 4, static_cast<uint8_t>(images.size()));
+
+		streamed_size += data.size();
+
+		auto image = std::make_unique<vkb::sg::Image>("image_" + std::to_string(images.size()), std::move(data), std::vector<vkb::sg::Mipmap>{mipmap});
+
+		image->create_vk_image(device);
+
+		serials.push_back(uploader.upload(*image));
+
+		vkbtest::check(serials.size() < 2 || serials[serials.size() - 2] <= serials.back(), "Serials are not in upload order");
+
+		images.push_back(std::move(image));
+	}
+
+	uploader.flush();
+
+	for (auto serial : serials)
+	{
+		vkbtest::check(uploader.is_complete(serial), "Upload " + std::to_string(serial) + " has not completed after flush()");
+	}
+
+	// The ring is fully reusable once everything has retired
+	vkb::sg::Mipmap mipmap{};
+	mipmap.extent = {1024, 1024, 1};
+
+	vkb::sg::Image ring_sized_image{"ring_sized_image", std::vector<uint8_t>(RING_SIZE, 0), std::vector<vkb::sg::Mipmap>{mipmap}};
+
+	ring_sized_image.create_vk_image(device);
+
+	auto serial = uploader.upload(ring_sized_image);
+
+	uploader.flush();
+
+	vkbtest::check(uploader.is_complete(serial), "The upload of the whole ring has not completed after flush()");
+}
+}        // namespace
+
+int main()
+{
+	return vkbtest::run_device_test("image_uploader_ring", test_ring_wrap);
+}
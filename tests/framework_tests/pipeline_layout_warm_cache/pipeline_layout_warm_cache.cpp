@@ -0,0 +1,85 @@
+/* Copyright (c) 2021, Samsung
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Checks that a pipeline layout replayed from a recorded resource cache keeps the resource modes
+// which a subpass set on its shader modules, as the geometry subpass makes GlobalUniform dynamic
+
+#include <vector>
+
+#include "core/pipeline_layout.h"
+#include "core/shader_module.h"
+#include "framework_test.h"
+#include "resource_cache.h"
+
+namespace
+{
+/**
+ * @brief Requests the layout of the base vertex shader the way the geometry subpass does
+ */
+vkb::PipelineLayout &request_layout(vkb::ResourceCache &resource_cache, vkb::ShaderResourceMode global_uniform_mode)
+{
+	vkb::ShaderSource vertex_source{"base.vert"};
+
+	auto &vertex_module = resource_cache.request_shader_module(VK_SHADER_STAGE_VERTEX_BIT, vertex_source);
+
+	vertex_module.set_resource_mode("GlobalUniform", global_uniform_mode);
+
+	return resource_cache.request_pipeline_layout({&vertex_module});
+}
+
+VkDescriptorType get_global_uniform_type(const vkb::PipelineLayout &pipeline_layout)
+{
+	auto binding = pipeline_layout.get_descriptor_set_layout(0).get_layout_binding("GlobalUniform");
+
+	vkbtest::check(binding != nullptr, "The layout has no GlobalUniform binding");
+
+	return binding->descriptorType;
+}
+
+void test_warm_cache(vkb::Instance &instance, vkb::Device &device)
+{
+	// A cold start records the layout
+	auto &cold_layout = request_layout(device.get_resource_cache(), vkb::ShaderResourceMode::Dynamic);
+
+	vkbtest::check(get_global_uniform_type(cold_layout) == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, "The cold layout has a static GlobalUniform");
+
+	auto resource_data = device.get_resource_cache().serialize();
+
+	// A warm start replays the record before any subpass has set the modes
+	vkb::Device warm_device{instance.get_suitable_gpu(), VK_NULL_HANDLE, {}};
+
+	auto &warm_cache = warm_device.get_resource_cache();
+
+	warm_cache.warmup(resource_data);
+
+	auto &warm_layout = request_layout(warm_cache, vkb::ShaderResourceMode::Dynamic);
+
+	vkbtest::check(get_global_uniform_type(warm_layout) == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, "The warm layout has a static GlobalUniform");
+
+	// The same shader module with other modes gets another layout
+	auto &static_layout = request_layout(warm_cache, vkb::ShaderResourceMode::Static);
+
+	vkbtest::check(&static_layout != &warm_layout, "Layouts with different resource modes are the same");
+
+	vkbtest::check(get_global_uniform_type(static_layout) == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, "The static layout has a dynamic GlobalUniform");
+}
+}        // namespace
+
+int main()
+{
+	return vkbtest::run_device_test("pipeline_layout_warm_cache", test_warm_cache);
+}